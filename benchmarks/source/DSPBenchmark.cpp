@@ -0,0 +1,156 @@
+#include <CX11Synth/Envelope.h>
+#include <CX11Synth/Filter.h>
+#include <CX11Synth/NoiseGenerator.h>
+#include <CX11Synth/OutputGuard.h>
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// The per-voice building blocks, one sample (or one coefficient update) at a time the way
+// Voice::render calls them.
+
+namespace {
+    constexpr int BLOCK_SIZE = 512;
+
+    void BM_FilterRender(benchmark::State& state) {
+        Filter filter;
+        filter.sample_rate = 48000.0f;
+        filter.reset();
+        filter.updateCoefficients(2000.0f, 2.0f);
+
+        NoiseGenerator noise;
+        noise.reset();
+        float block[BLOCK_SIZE];
+        for (float& x : block) {
+            x = noise.next_value();
+        }
+
+        for (auto _ : state) {
+            for (int i = 0; i < BLOCK_SIZE; ++i) {
+                block[i] = filter.render(block[i]);
+            }
+            benchmark::DoNotOptimize(block);
+            benchmark::ClobberMemory();
+        }
+
+        state.SetItemsProcessed(state.iterations() * BLOCK_SIZE);
+    }
+
+    // Called once per voice per LFO tick, with the cutoff sweeping.
+    void BM_FilterUpdateCoefficients(benchmark::State& state) {
+        Filter filter;
+        filter.sample_rate = 48000.0f;
+        filter.reset();
+
+        float cutoffs[BLOCK_SIZE];
+        for (int i = 0; i < BLOCK_SIZE; ++i) {
+            cutoffs[i] = 30.0f * std::exp(6.5f * float(i) / float(BLOCK_SIZE));
+        }
+
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(cutoffs);
+            for (int i = 0; i < BLOCK_SIZE; ++i) {
+                filter.updateCoefficients(cutoffs[i], 1.5f);
+                benchmark::DoNotOptimize(filter);
+            }
+        }
+
+        state.SetItemsProcessed(state.iterations() * BLOCK_SIZE);
+    }
+
+    void BM_EnvelopeNextValue(benchmark::State& state) {
+        Envelope env;
+        env.reset();
+        env.attack_multiplier = std::exp(-1.0f / (0.01f * 48000.0f));
+        env.decay_multiplier = std::exp(-1.0f / (0.5f * 48000.0f));
+        env.sustain_level = 0.5f;
+        env.release_multiplier = std::exp(-1.0f / (0.5f * 48000.0f));
+        env.attack();
+
+        float block[BLOCK_SIZE];
+
+        for (auto _ : state) {
+            for (int i = 0; i < BLOCK_SIZE; ++i) {
+                block[i] = env.nextValue();
+            }
+            benchmark::DoNotOptimize(block);
+            benchmark::ClobberMemory();
+        }
+
+        state.SetItemsProcessed(state.iterations() * BLOCK_SIZE);
+    }
+
+    void BM_NoiseNextValue(benchmark::State& state) {
+        NoiseGenerator noise;
+        noise.reset();
+
+        float block[BLOCK_SIZE];
+
+        for (auto _ : state) {
+            for (int i = 0; i < BLOCK_SIZE; ++i) {
+                block[i] = noise.next_value();
+            }
+            benchmark::DoNotOptimize(block);
+            benchmark::ClobberMemory();
+        }
+
+        state.SetItemsProcessed(state.iterations() * BLOCK_SIZE);
+    }
+
+    // The common case: nothing out of range, so it's only the check. Stereo, like Synth::render.
+    void BM_OutputGuard(benchmark::State& state) {
+        const int block_size = int(state.range(0));
+
+        NoiseGenerator noise;
+        noise.reset();
+        std::vector<float> left(static_cast<size_t>(block_size));
+        std::vector<float> right(static_cast<size_t>(block_size));
+        for (size_t i = 0; i < left.size(); ++i) {
+            left[i] = 0.5f * noise.next_value();
+            right[i] = 0.5f * noise.next_value();
+        }
+
+        OutputGuard guard;
+        for (auto _ : state) {
+            guard.process(left.data(), right.data(), block_size);
+            benchmark::DoNotOptimize(left.data());
+            benchmark::ClobberMemory();
+        }
+
+        state.SetItemsProcessed(state.iterations() * block_size);
+    }
+
+    // A block that's too loud all the way through, so the policy has work to do on every sample.
+    void BM_OutputGuardLoud(benchmark::State& state) {
+        const int block_size = 512;
+        const OutputGuard::Policy policy = OutputGuard::Policy(state.range(0));
+
+        NoiseGenerator noise;
+        noise.reset();
+        std::vector<float> loud(static_cast<size_t>(block_size));
+        for (float& x : loud) {
+            x = 1.5f * noise.next_value();
+        }
+
+        std::vector<float> block(loud.size());
+        OutputGuard guard;
+        guard.setPolicy(policy);
+        for (auto _ : state) {
+            std::copy(loud.begin(), loud.end(), block.begin());
+            guard.process(block.data(), nullptr, block_size);
+            benchmark::DoNotOptimize(block.data());
+            benchmark::ClobberMemory();
+        }
+
+        state.SetItemsProcessed(state.iterations() * block_size);
+    }
+}
+
+BENCHMARK(BM_FilterRender);
+BENCHMARK(BM_FilterUpdateCoefficients);
+BENCHMARK(BM_EnvelopeNextValue);
+BENCHMARK(BM_NoiseNextValue);
+BENCHMARK(BM_OutputGuard)->RangeMultiplier(4)->Range(32, 4096);
+BENCHMARK(BM_OutputGuardLoud)->Arg(OutputGuard::MUTE)->Arg(OutputGuard::CLAMP)->Arg(OutputGuard::SOFT_CLIP);
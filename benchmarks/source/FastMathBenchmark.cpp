@@ -0,0 +1,45 @@
+#include <CX11Synth/FastMath.h>
+#include <benchmark/benchmark.h>
+
+#include <cmath>
+
+namespace {
+    constexpr int BLOCK_SIZE = 512;
+
+    // Runs `function` over a block of inputs spread across [from, to), the way a loop over the
+    // voices or lanes would call it.
+    template <typename Function>
+    void evaluate(benchmark::State& state, Function function, float from, float to) {
+        float input[BLOCK_SIZE];
+        float output[BLOCK_SIZE];
+        for (int i = 0; i < BLOCK_SIZE; ++i) {
+            input[i] = from + (to - from) * float(i) / float(BLOCK_SIZE);
+        }
+
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(input);
+            for (int i = 0; i < BLOCK_SIZE; ++i) {
+                output[i] = function(input[i]);
+            }
+            benchmark::DoNotOptimize(output);
+            benchmark::ClobberMemory();
+        }
+
+        state.SetItemsProcessed(state.iterations() * BLOCK_SIZE);
+    }
+
+    // The ranges are the ones the synth uses: filter modulation, LFO phase, filter cutoff.
+    void BM_StdExp(benchmark::State& state) { evaluate(state, [](float x) { return std::exp(x); }, -8.0f, 8.0f); }
+    void BM_FastExp(benchmark::State& state) { evaluate(state, [](float x) { return FastMath::exp(x); }, -8.0f, 8.0f); }
+    void BM_StdSin(benchmark::State& state) { evaluate(state, [](float x) { return std::sin(x); }, -FastMath::PI, FastMath::PI); }
+    void BM_FastSin(benchmark::State& state) { evaluate(state, [](float x) { return FastMath::sin(x); }, -FastMath::PI, FastMath::PI); }
+    void BM_StdTan(benchmark::State& state) { evaluate(state, [](float x) { return std::tan(x); }, 0.001f, 1.4f); }
+    void BM_FastTan(benchmark::State& state) { evaluate(state, [](float x) { return FastMath::tan(x); }, 0.001f, 1.4f); }
+}
+
+BENCHMARK(BM_StdExp);
+BENCHMARK(BM_FastExp);
+BENCHMARK(BM_StdSin);
+BENCHMARK(BM_FastSin);
+BENCHMARK(BM_StdTan);
+BENCHMARK(BM_FastTan);
@@ -0,0 +1,104 @@
+#include <CX11Synth/OutputGuard.h>
+#include <CX11Synth/PresetMorph.h>
+#include <CX11Synth/Synth.h>
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+// The preset morph the way the processor runs it while the morph moves: the settings worked out
+// and applied every LFO_MAX samples, the synth rendered in steps of that size and the output
+// guard run once over the block. Compare
+// ns_per_sample with BM_SynthRender at the same voice count and rate for what continuous morph
+// automation costs on top of playing.
+
+namespace {
+    const std::vector<Preset> presets = {
+        Preset("Dark", 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 20.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 30.0f, 0.0f, 30.0f,
+               0.0f, 50.0f, 100.0f, 30.0f, 0.3f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f),
+        Preset("Bright", 100.0f, 7.0f, 0.0f, 0.0f, 0.0f, 0.0f, 90.0f, 80.0f, 40.0f, 20.0f, 0.0f, 0.0f, 30.0f, 0.0f,
+               30.0f, 0.0f, 50.0f, 100.0f, 30.0f, 0.8f, 40.0f, 10.0f, 1.0f, 0.0f, -3.0f, 1.0f),
+    };
+
+    void BM_MorphEvaluate(benchmark::State& state) {
+        PresetMorph morph;
+        morph.setPresets(presets.data(), int(presets.size()));
+        morph.prepare(48000.0f);
+
+        SynthParameters params;
+        float position = 0.0f;
+        for (auto _ : state) {
+            position = position < 1.0f ? position + 0.001f : 0.0f;
+            morph.evaluate(position, params);
+            benchmark::DoNotOptimize(params);
+        }
+    }
+
+    void BM_MorphRender(benchmark::State& state) {
+        const int num_voices = int(state.range(0));
+        const float sample_rate = float(state.range(1));
+        constexpr int block_size = 512;
+
+        PresetMorph morph;
+        morph.setPresets(presets.data(), int(presets.size()));
+        morph.prepare(sample_rate);
+
+        SynthParameters params;
+        morph.evaluate(0.0f, params);
+
+        Synth synth;
+        synth.voice_capacity = num_voices;
+        synth.allocate_resources(sample_rate, block_size);
+        synth.reset();
+        params.applyTo(synth);
+        synth.output_level_smoother.setCurrentAndTargetValue(1.0f / float(num_voices));
+
+        for (int voice = 0; voice < num_voices; ++voice) {
+            synth.midi_message(0x90, uint8_t(36 + voice % 64), 100);
+        }
+
+        std::vector<float> left(static_cast<size_t>(block_size));
+        std::vector<float> right(static_cast<size_t>(block_size));
+        OutputGuard guard;
+
+        // Back and forth once a second.
+        const float step = 2.0f * float(Synth::LFO_MAX) / sample_rate;
+        float position = 0.0f;
+        float direction = 1.0f;
+
+        for (auto _ : state) {
+            for (int offset = 0; offset < block_size; offset += Synth::LFO_MAX) {
+                position += direction * step;
+                if (position >= 1.0f || position <= 0.0f) {
+                    direction = -direction;
+                }
+
+                morph.evaluate(position, params);
+                params.output_level = 1.0f / float(num_voices); // keeps the sum out of the output guard's clamp
+                params.applyTo(synth);
+
+                float* outputs[2] = { left.data() + offset, right.data() + offset };
+                synth.render(outputs, Synth::LFO_MAX);
+            }
+            guard.process(left.data(), right.data(), block_size);
+            benchmark::DoNotOptimize(left.data());
+            benchmark::DoNotOptimize(right.data());
+            benchmark::ClobberMemory();
+        }
+
+        synth.deallocate_resources();
+
+        state.SetItemsProcessed(state.iterations() * block_size);
+        state.counters["ns_per_sample"] = benchmark::Counter(double(block_size) * 1e-9,
+            benchmark::Counter::kIsIterationInvariantRate | benchmark::Counter::kInvert);
+    }
+}
+
+BENCHMARK(BM_MorphEvaluate);
+
+BENCHMARK(BM_MorphRender)
+    ->ArgNames({ "voices", "rate" })
+    ->ArgsProduct({
+        { 8, Synth::MAX_VOICES },
+        { 48000, 192000 },
+    })
+    ->Unit(benchmark::kMicrosecond);
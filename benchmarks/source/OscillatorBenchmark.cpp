@@ -0,0 +1,47 @@
+#include <CX11Synth/Oscillator.h>
+#include <CX11Synth/WavetableOscillator.h>
+#include <benchmark/benchmark.h>
+
+namespace {
+    constexpr int BLOCK_SIZE = 512;
+
+    // One argument per wavetable octave, i.e. per range calcPeriod() can land in: from 6 samples
+    // (the shortest period calcPeriod() allows) up to the last table.
+    void periodRanges(benchmark::internal::Benchmark* b) {
+        for (int period = 6; period <= 6 << (WavetableBank::NUM_TABLES - 1); period *= 2) {
+            b->Arg(period);
+        }
+    }
+
+    template <typename Osc>
+    void renderOscillator(benchmark::State& state) {
+        Osc osc;
+        osc.reset();
+        osc.amplitude = 0.5f;
+        // A little off the octave boundary so the wavetable stays in the table being measured.
+        osc.period = float(state.range(0)) * 1.2f;
+
+        float block[BLOCK_SIZE];
+
+        for (auto _ : state) {
+            for (int i = 0; i < BLOCK_SIZE; ++i) {
+                block[i] = osc.next_sample();
+            }
+            benchmark::DoNotOptimize(block);
+            benchmark::ClobberMemory();
+        }
+
+        state.SetItemsProcessed(state.iterations() * BLOCK_SIZE);
+    }
+
+    void BM_BlitOscillator(benchmark::State& state) {
+        renderOscillator<Oscillator>(state);
+    }
+
+    void BM_WavetableOscillator(benchmark::State& state) {
+        renderOscillator<WavetableOscillator>(state);
+    }
+}
+
+BENCHMARK(BM_BlitOscillator)->Apply(periodRanges);
+BENCHMARK(BM_WavetableOscillator)->Apply(periodRanges);
@@ -0,0 +1,58 @@
+#include <CX11Synth/PluginProcessor.h>
+#include <benchmark/benchmark.h>
+
+// Saving and loading one instance's state, the part of opening or saving a project that grows
+// with the number of CX11 instances in it. Binary is what getStateInformation writes, Xml is the
+// state of earlier versions that setStateInformation still reads.
+
+namespace {
+    // The state the way versions before the binary one saved it.
+    juce::MemoryBlock xmlState(audio_plugin::CX11SynthAudioProcessor& processor) {
+        juce::XmlElement xml("PLUGIN");
+        xml.addChildElement(processor.apvts.copyState().createXml().release());
+        xml.createNewChildElement("EXTRA")->setAttribute("midCC", 1);
+
+        juce::MemoryBlock state;
+        juce::AudioProcessor::copyXmlToBinary(xml, state);
+        return state;
+    }
+
+    void BM_GetStateBinary(benchmark::State& state) {
+        audio_plugin::CX11SynthAudioProcessor processor;
+        juce::MemoryBlock data;
+
+        for (auto _ : state) {
+            processor.getStateInformation(data);
+            benchmark::DoNotOptimize(data.getData());
+        }
+
+        state.counters["bytes"] = double(data.getSize());
+    }
+
+    void BM_SetStateBinary(benchmark::State& state) {
+        audio_plugin::CX11SynthAudioProcessor processor;
+        juce::MemoryBlock data;
+        processor.getStateInformation(data);
+
+        for (auto _ : state) {
+            processor.setStateInformation(data.getData(), int(data.getSize()));
+        }
+
+        state.counters["bytes"] = double(data.getSize());
+    }
+
+    void BM_SetStateXml(benchmark::State& state) {
+        audio_plugin::CX11SynthAudioProcessor processor;
+        const juce::MemoryBlock data = xmlState(processor);
+
+        for (auto _ : state) {
+            processor.setStateInformation(data.getData(), int(data.getSize()));
+        }
+
+        state.counters["bytes"] = double(data.getSize());
+    }
+}
+
+BENCHMARK(BM_GetStateBinary)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_SetStateBinary)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_SetStateXml)->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,87 @@
+#include <CX11Synth/OutputGuard.h>
+#include <CX11Synth/Synth.h>
+#include <CX11Synth/SynthParameters.h>
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+// Synth::render with every voice playing, followed by the output guard like in the processor,
+// across voice counts, block sizes and sample rates, and for the larger voice counts with helper
+// threads (Synth::render_threads) as well. Besides items_per_second each run reports
+// ns_per_sample (per output sample, all voices together), which is the number to track from
+// release to release.
+
+namespace {
+    // Two detuned oscillators through a resonant filter with an envelope on it, about the most
+    // work a voice can do. Full sustain, so no voice ever goes quiet.
+    SynthParameters patch(float sample_rate, int num_voices) {
+        Preset preset("Benchmark", 100.0f, 0.0f, 7.0f, 0.0f, 0.0f, 0.0f, 60.0f, 40.0f, 50.0f, 20.0f, 0.0f, 20.0f, 60.0f,
+                      55.0f, 40.0f, 0.0f, 50.0f, 100.0f, 30.0f, 0.8f, 45.0f, 40.0f, 0.0f, 0.0f, 0.0f, 1.0f);
+        preset.param[Preset::POLY_MODE] = num_voices > 1 ? 1.0f : 0.0f;
+        // Keeps the sum out of the output guard's clamp.
+        preset.param[Preset::OUTPUT_LEVEL] = juce::Decibels::gainToDecibels(1.0f / float(num_voices));
+        return SynthParameters::fromPreset(preset, sample_rate);
+    }
+
+    void BM_SynthRender(benchmark::State& state) {
+        const int num_voices = int(state.range(0));
+        const int block_size = int(state.range(1));
+        const float sample_rate = float(state.range(2));
+        const int render_threads = int(state.range(3));
+
+        Synth synth;
+        synth.voice_capacity = num_voices;
+        synth.render_threads = render_threads;
+        synth.allocate_resources(sample_rate, block_size);
+        synth.reset();
+        const SynthParameters params = patch(sample_rate, num_voices);
+        params.applyTo(synth);
+        synth.output_level_smoother.setCurrentAndTargetValue(params.output_level);
+
+        // Held for the whole run, the sustain is at full level so no voice ever goes quiet.
+        for (int voice = 0; voice < num_voices; ++voice) {
+            synth.midi_message(0x90, uint8_t(36 + voice % 64), 100);
+        }
+
+        std::vector<float> left(static_cast<size_t>(block_size));
+        std::vector<float> right(static_cast<size_t>(block_size));
+        float* outputs[2] = { left.data(), right.data() };
+        OutputGuard guard;
+
+        for (auto _ : state) {
+            synth.render(outputs, block_size);
+            guard.process(left.data(), right.data(), block_size);
+            benchmark::DoNotOptimize(left.data());
+            benchmark::DoNotOptimize(right.data());
+            benchmark::ClobberMemory();
+        }
+
+        synth.deallocate_resources();
+
+        state.SetItemsProcessed(state.iterations() * block_size);
+        state.counters["ns_per_sample"] = benchmark::Counter(double(block_size) * 1e-9,
+            benchmark::Counter::kIsIterationInvariantRate | benchmark::Counter::kInvert);
+    }
+}
+
+BENCHMARK(BM_SynthRender)
+    ->ArgNames({ "voices", "block", "rate", "threads" })
+    ->ArgsProduct({
+        { 1, 4, 8, Synth::MAX_VOICES },
+        benchmark::CreateRange(32, 4096, 2),
+        { 44100, 48000, 96000, 192000 },
+        { 0 },
+    })
+    ->Unit(benchmark::kMicrosecond);
+
+// The helpers' time doesn't show up in the audio thread's CPU time, so these go by the clock.
+BENCHMARK(BM_SynthRender)
+    ->ArgNames({ "voices", "block", "rate", "threads" })
+    ->ArgsProduct({
+        { 32, Synth::MAX_VOICES },
+        { 128, 512 },
+        { 48000 },
+        { 0, 1, 3 },
+    })
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,324 @@
+#include "OfflineRender.h"
+#include "CX11Synth/PresetLibrary.h"
+#include "CX11Synth/Profiler.h"
+
+#include <juce_events/juce_events.h>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+// Renders a Standard MIDI File to WAV or FLAC without an audio device, e.g. on a build server.
+// Runs as fast as the CPU allows and reports how much faster than real time that was. With a
+// manifest it renders a whole batch of jobs, one per core at a time.
+
+namespace {
+  void printUsage() {
+    std::cerr << "usage: CX11SynthRender [options] <input.mid> <output.wav|output.flac>\n"
+                 "       CX11SynthRender [options] --manifest <jobs.txt>\n"
+                 "\n"
+                 "  --sample-rate <hz>    default 48000\n"
+                 "  --block-size <n>      samples per processBlock call, default 512\n"
+                 "  --preset <index>      default 0, see --list-presets\n"
+                 "  --bank <file>         presets come from this bank instead of the ones\n"
+                 "                        that come with the plugin\n"
+                 "  --voices <n>          polyphony, up to 128, default 8\n"
+                 "  --bits <n>            16, 24 or 32 (WAV only), default 24\n"
+                 "  --tail <seconds>      rendered after the last MIDI event, default 2\n"
+                 "  --guard <policy>      what happens to output past full scale: mute,\n"
+                 "                        clamp or soft-clip, default mute\n"
+                 "  --list-presets        prints the preset indices and names\n"
+                 "  --import-text <file>  presets come from a text file (as written by\n"
+                 "                        --export-text), for the two options below\n"
+                 "  --export-bank <file>  writes the presets as a bank and exits\n"
+                 "  --export-text <file>  writes them as tab-separated text and exits, one\n"
+                 "                        line per preset, for editing\n"
+                 "  --library <dir>       with --list-presets or --find: every preset in the\n"
+                 "                        banks under dir, as bank, index and name (the\n"
+                 "                        index of the library is kept in dir/.cx11library)\n"
+                 "  --find <prefix>       lists the library presets whose name starts with\n"
+                 "                        prefix\n"
+                 "  --manifest <file>     renders every job in the file, one per line:\n"
+                 "                        <input.mid> <preset|*> <sample rate> <output>\n"
+                 "                        with * every preset is rendered, {preset} in the\n"
+                 "                        output path is replaced by the preset index\n"
+                 "  --threads <n>         jobs rendered at the same time with --manifest,\n"
+                 "                        default one per core\n"
+                 "  --render-threads <n>  extra threads rendering the voices of each job,\n"
+                 "                        default 0; pays off for dense files on few jobs\n"
+                 "  --trace <file.json>   writes the profiling zones as a Chrome trace, for\n"
+                 "                        chrome://tracing or ui.perfetto.dev (needs a build\n"
+                 "                        with -DCX11_PROFILING=ON)\n";
+  }
+
+  bool writeTrace(const juce::File& file) {
+    std::ofstream stream(file.getFullPathName().toStdString());
+    const uint64_t dropped = Profiler::writeChromeTrace(stream);
+    if (!stream) {
+      std::cerr << "error: can't write " << file.getFullPathName() << "\n";
+      return false;
+    }
+
+    std::cout << "trace written to " << file.getFullPathName();
+    if (dropped > 0) {
+      std::cout << " (" << dropped << " zones dropped)";
+    }
+    std::cout << "\n";
+    return true;
+  }
+
+  juce::String describe(const offline_render::RenderResult& result) {
+    juce::String text = juce::String(result.audio_seconds, 2) + " s of audio rendered in "
+         + juce::String(result.render_seconds, 3) + " s (" + juce::String(result.realTimeFactor(), 1)
+         + "x real time), " + juce::String(result.total_seconds, 3) + " s with file I/O, slowest block "
+         + juce::String(juce::roundToInt(result.load.peak_load * 100.0f)) + "% of its real-time budget";
+
+    if (result.output.muted_blocks > 0 || result.output.clipped_blocks > 0) {
+      text << ", output guard muted " << juce::String(result.output.muted_blocks) << " and clipped "
+           << juce::String(result.output.clipped_blocks) << " blocks";
+    }
+    return text;
+  }
+
+  bool parsePolicy(const juce::String& name, OutputGuard::Policy& policy) {
+    if (name == "mute") {
+      policy = OutputGuard::MUTE;
+    } else if (name == "clamp") {
+      policy = OutputGuard::CLAMP;
+    } else if (name == "soft-clip") {
+      policy = OutputGuard::SOFT_CLIP;
+    } else {
+      return false;
+    }
+    return true;
+  }
+
+  // --list-presets and the bank import/export.
+  int presetCommand(const juce::File& bank_file, const juce::File& text_file, bool list,
+                    const juce::File& export_bank, const juce::File& export_text) {
+    juce::String error;
+    std::vector<Preset> presets;
+    std::shared_ptr<const PresetBank> bank;
+
+    if (text_file != juce::File()) {
+      if (!PresetBank::readText(text_file, presets, error)) {
+        std::cerr << "error: " << error << "\n";
+        return 1;
+      }
+      bank = PresetBank::fromPresets(presets);
+    } else {
+      bank = offline_render::openPresetBank(bank_file, error);
+      if (bank == nullptr) {
+        std::cerr << "error: " << error << "\n";
+        return 1;
+      }
+    }
+
+    if (list) {
+      for (int preset = 0; preset < bank->size(); ++preset) {
+        std::cout << preset << "\t" << bank->name(preset) << "\n";
+      }
+    }
+
+    if (export_bank != juce::File() || export_text != juce::File()) {
+      if (presets.empty()) {
+        presets = bank->presets();
+      }
+      if ((export_bank != juce::File() && !PresetBank::write(presets, export_bank, error))
+          || (export_text != juce::File() && !PresetBank::writeText(presets, export_text, error))) {
+        std::cerr << "error: " << error << "\n";
+        return 1;
+      }
+      std::cout << presets.size() << " presets written\n";
+    }
+    return 0;
+  }
+
+  int libraryCommand(const juce::File& directory, const juce::String& prefix) {
+    PresetLibrary library(directory.getChildFile(".cx11library"));
+    library.setDirectories({ directory });
+    if (!library.waitForScan(10 * 60 * 1000)) {
+      std::cerr << "error: scanning " << directory.getFullPathName() << " took too long\n";
+      return 1;
+    }
+
+    const auto snapshot = library.snapshot();
+    const std::vector<int> found = snapshot->findPrefix(prefix, snapshot->size());
+    for (int index : found) {
+      const PresetLibrary::Entry& entry = (*snapshot)[index];
+      std::cout << entry.bank.getFullPathName() << "\t" << entry.index << "\t" << entry.name << "\n";
+    }
+    return 0;
+  }
+
+  int renderManifest(const juce::File& manifest, const offline_render::RenderJob& defaults, int num_threads) {
+    std::vector<offline_render::RenderJob> jobs;
+    juce::String error;
+    if (!offline_render::readManifest(manifest, defaults, jobs, error)) {
+      std::cerr << "error: " << error << "\n";
+      return 1;
+    }
+
+    const auto start = juce::Time::getHighResolutionTicks();
+
+    const auto results = offline_render::renderBatch(jobs, num_threads,
+        [&jobs](size_t job, const offline_render::RenderResult& result) {
+          if (result.ok) {
+            std::cout << jobs[job].output_file.getFullPathName() << ": " << describe(result) << std::endl;
+          } else {
+            std::cerr << jobs[job].midi_file.getFullPathName() << ": error: " << result.error << std::endl;
+          }
+        });
+
+    const double seconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+
+    int failed = 0;
+    double audio_seconds = 0.0;
+    for (const auto& result : results) {
+      failed += result.ok ? 0 : 1;
+      audio_seconds += result.audio_seconds;
+    }
+
+    std::cout << int(results.size()) - failed << " of " << results.size() << " jobs rendered, "
+              << juce::String(audio_seconds, 1) << " s of audio in " << juce::String(seconds, 2) << " s ("
+              << juce::String(seconds > 0.0 ? audio_seconds / seconds : 0.0, 1) << "x real time on "
+              << num_threads << " threads)\n";
+    return failed == 0 ? 0 : 1;
+  }
+}
+
+int main(int argc, char* argv[]) {
+  juce::ScopedJuceInitialiser_GUI juce_initialiser;
+
+  offline_render::RenderJob job;
+  juce::StringArray files;
+  juce::String manifest;
+  juce::String trace;
+  juce::String import_text;
+  juce::String export_bank;
+  juce::String export_text;
+  juce::String library;
+  juce::String find;
+  bool list_presets = false;
+  int num_threads = std::max(int(std::thread::hardware_concurrency()), 1);
+
+  for (int i = 1; i < argc; ++i) {
+    const juce::String arg(argv[i]);
+
+    if (arg == "--list-presets") {
+      list_presets = true;
+      continue;
+    }
+
+    if (arg == "--help" || arg == "-h") {
+      printUsage();
+      return 0;
+    }
+
+    if (!arg.startsWith("--")) {
+      files.add(arg);
+      continue;
+    }
+
+    if (i + 1 == argc) {
+      std::cerr << arg << " needs a value\n";
+      return 1;
+    }
+
+    const juce::String value(argv[++i]);
+    if (arg == "--sample-rate") {
+      job.sample_rate = value.getDoubleValue();
+    } else if (arg == "--block-size") {
+      job.block_size = value.getIntValue();
+    } else if (arg == "--preset") {
+      job.preset = value.getIntValue();
+    } else if (arg == "--bank") {
+      job.preset_bank = juce::File::getCurrentWorkingDirectory().getChildFile(value);
+    } else if (arg == "--import-text") {
+      import_text = value;
+    } else if (arg == "--export-bank") {
+      export_bank = value;
+    } else if (arg == "--export-text") {
+      export_text = value;
+    } else if (arg == "--library") {
+      library = value;
+    } else if (arg == "--find") {
+      find = value;
+    } else if (arg == "--voices") {
+      job.voices = std::clamp(value.getIntValue(), 1, 128);
+    } else if (arg == "--bits") {
+      job.bits_per_sample = value.getIntValue();
+    } else if (arg == "--tail") {
+      job.tail_seconds = std::max(value.getDoubleValue(), 0.0);
+    } else if (arg == "--guard") {
+      if (!parsePolicy(value, job.output_policy)) {
+        std::cerr << "unknown output guard policy " << value << "\n";
+        return 1;
+      }
+    } else if (arg == "--manifest") {
+      manifest = value;
+    } else if (arg == "--threads") {
+      num_threads = std::max(value.getIntValue(), 1);
+    } else if (arg == "--render-threads") {
+      job.render_threads = std::max(value.getIntValue(), 0);
+    } else if (arg == "--trace") {
+      trace = value;
+    } else {
+      std::cerr << "unknown option " << arg << "\n";
+      printUsage();
+      return 1;
+    }
+  }
+
+  if (trace.isNotEmpty() && !Profiler::ENABLED) {
+    std::cerr << "--trace needs a build with profiling zones, configure with -DCX11_PROFILING=ON\n";
+    return 1;
+  }
+
+  const juce::File cwd = juce::File::getCurrentWorkingDirectory();
+  const auto fileOrNone = [&cwd](const juce::String& path) { return path.isEmpty() ? juce::File() : cwd.getChildFile(path); };
+
+  if (library.isNotEmpty() && (list_presets || find.isNotEmpty())) {
+    return libraryCommand(cwd.getChildFile(library), find);
+  }
+  if (library.isNotEmpty() || find.isNotEmpty()) {
+    std::cerr << "--library and --find go together, or --library with --list-presets\n";
+    return 1;
+  }
+
+  if (list_presets || export_bank.isNotEmpty() || export_text.isNotEmpty()) {
+    return presetCommand(job.preset_bank, fileOrNone(import_text), list_presets, fileOrNone(export_bank),
+                         fileOrNone(export_text));
+  }
+  if (import_text.isNotEmpty()) {
+    std::cerr << "--import-text goes with --export-bank, --export-text or --list-presets\n";
+    return 1;
+  }
+
+  if (manifest.isNotEmpty() && files.isEmpty()) {
+    const int status = renderManifest(cwd.getChildFile(manifest), job, num_threads);
+    if (trace.isNotEmpty() && !writeTrace(cwd.getChildFile(trace))) {
+      return 1;
+    }
+    return status;
+  }
+
+  if (files.size() != 2 || manifest.isNotEmpty()) {
+    printUsage();
+    return 1;
+  }
+
+  job.midi_file = cwd.getChildFile(files[0]);
+  job.output_file = cwd.getChildFile(files[1]);
+
+  const offline_render::RenderResult result = offline_render::render(job);
+  if (!result.ok) {
+    std::cerr << "error: " << result.error << "\n";
+    return 1;
+  }
+
+  std::cout << job.output_file.getFullPathName() << ": " << describe(result) << "\n";
+  if (trace.isNotEmpty() && !writeTrace(cwd.getChildFile(trace))) {
+    return 1;
+  }
+  return 0;
+}
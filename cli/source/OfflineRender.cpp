@@ -0,0 +1,279 @@
+#include "OfflineRender.h"
+#include "CX11Synth/PluginProcessor.h"
+#include "CX11Synth/Profiler.h"
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+namespace offline_render {
+
+namespace {
+  // All tracks merged into one sequence, timestamps in seconds.
+  bool readMidiFile(const juce::File& file, juce::MidiMessageSequence& sequence, juce::String& error) {
+    juce::FileInputStream stream(file);
+    if (!stream.openedOk()) {
+      error = "can't open " + file.getFullPathName();
+      return false;
+    }
+
+    juce::MidiFile midi_file;
+    if (!midi_file.readFrom(stream)) {
+      error = file.getFullPathName() + " isn't a Standard MIDI File";
+      return false;
+    }
+
+    // Takes the tempo map into account.
+    midi_file.convertTimestampTicksToSeconds();
+
+    for (int track = 0; track < midi_file.getNumTracks(); ++track) {
+      sequence.addSequence(*midi_file.getTrack(track), 0.0);
+    }
+
+    return true;
+  }
+
+  std::unique_ptr<juce::AudioFormatWriter> createWriter(const RenderJob& job, juce::String& error) {
+    std::unique_ptr<juce::AudioFormat> format;
+    if (job.output_file.hasFileExtension("wav")) {
+      format = std::make_unique<juce::WavAudioFormat>();
+    } else if (job.output_file.hasFileExtension("flac")) {
+      format = std::make_unique<juce::FlacAudioFormat>();
+    } else {
+      error = "don't know how to write " + job.output_file.getFileName() + ", use .wav or .flac";
+      return nullptr;
+    }
+
+    if (!format->getPossibleBitDepths().contains(job.bits_per_sample)) {
+      error = format->getFormatName() + " can't be written with " + juce::String(job.bits_per_sample) + " bits";
+      return nullptr;
+    }
+
+    job.output_file.getParentDirectory().createDirectory();
+    job.output_file.deleteFile();
+    std::unique_ptr<juce::OutputStream> stream = job.output_file.createOutputStream();
+    if (stream == nullptr) {
+      error = "can't write to " + job.output_file.getFullPathName();
+      return nullptr;
+    }
+
+    // The writer owns the stream once it's been created.
+    std::unique_ptr<juce::AudioFormatWriter> writer(format->createWriterFor(
+        stream.get(), job.sample_rate, 2, job.bits_per_sample, {}, 0));
+    if (writer == nullptr) {
+      error = "can't write " + format->getFormatName() + " at " + juce::String(job.sample_rate) + " Hz";
+      return nullptr;
+    }
+
+    stream.release();
+    return writer;
+  }
+}
+
+RenderResult render(const RenderJob& job) {
+  const auto job_start = juce::Time::getHighResolutionTicks();
+
+  RenderResult result;
+  auto fail = [&result](const juce::String& error) {
+    result.error = error;
+    return result;
+  };
+
+  if (job.sample_rate < 8000.0 || job.sample_rate > 384000.0) {
+    return fail("sample rate has to be between 8000 and 384000 Hz");
+  }
+  if (job.block_size < 1) {
+    return fail("block size has to be at least 1");
+  }
+
+  juce::MidiMessageSequence events;
+  juce::String error;
+  if (!readMidiFile(job.midi_file, events, error)) {
+    return fail(error);
+  }
+
+  audio_plugin::CX11SynthAudioProcessor processor;
+  if (job.preset_bank != juce::File() && !processor.loadPresetBank(job.preset_bank, error)) {
+    return fail(error);
+  }
+  if (job.preset < 0 || job.preset >= processor.getNumPrograms()) {
+    return fail("there's no preset " + juce::String(job.preset));
+  }
+
+  auto writer = createWriter(job, error);
+  if (writer == nullptr) {
+    return fail(error);
+  }
+
+  processor.setCurrentProgram(job.preset);
+  processor.polyphony = job.voices;
+  processor.render_threads = job.render_threads;
+  processor.setNonRealtime(true);
+  processor.setRateAndBufferSizeDetails(job.sample_rate, job.block_size);
+  processor.prepareToPlay(job.sample_rate, job.block_size);
+  processor.getOutputGuard().setPolicy(job.output_policy);
+
+  const auto toSamples = [&job](double seconds) { return juce::roundToInt64(seconds * job.sample_rate); };
+  const juce::int64 length = toSamples(events.getEndTime()) + toSamples(job.tail_seconds);
+
+  juce::AudioBuffer<float> buffer(2, job.block_size);
+  juce::MidiBuffer midi;
+  juce::int64 render_ticks = 0;
+  int next_event = 0;
+
+  for (juce::int64 position = 0; position < length; position += job.block_size) {
+    const int sample_count = int(std::min<juce::int64>(job.block_size, length - position));
+
+    midi.clear();
+    for (; next_event < events.getNumEvents(); ++next_event) {
+      const juce::MidiMessage& message = events.getEventPointer(next_event)->message;
+      const juce::int64 sample = toSamples(message.getTimeStamp());
+      if (sample >= position + sample_count) {
+        break;
+      }
+      if (message.isMetaEvent() || message.isSysEx()) {
+        continue;
+      }
+      midi.addEvent(message, int(std::max<juce::int64>(sample - position, 0)));
+    }
+
+    buffer.setSize(2, sample_count, false, false, true);
+    buffer.clear();
+
+    const auto start = juce::Time::getHighResolutionTicks();
+    processor.processBlock(buffer, midi);
+    render_ticks += juce::Time::getHighResolutionTicks() - start;
+
+    // Keeps the zone logs from filling up, outside the timed part.
+    if (Profiler::ENABLED) {
+      Profiler::collect();
+    }
+
+    if (!writer->writeFromAudioSampleBuffer(buffer, 0, sample_count)) {
+      return fail("can't write to " + job.output_file.getFullPathName());
+    }
+  }
+
+  result.load = processor.load_monitor.getStats();
+  result.output = processor.getOutputGuard().getCounts();
+  processor.releaseResources();
+  if (!writer->flush()) {
+    return fail("can't write to " + job.output_file.getFullPathName());
+  }
+  writer.reset();
+
+  result.ok = true;
+  result.audio_seconds = double(length) / job.sample_rate;
+  result.render_seconds = juce::Time::highResolutionTicksToSeconds(render_ticks);
+  result.total_seconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - job_start);
+  return result;
+}
+
+std::shared_ptr<const PresetBank> openPresetBank(const juce::File& file, juce::String& error) {
+  if (file == juce::File()) {
+    return PresetBank::factory();
+  }
+  return PresetBank::open(file, error);
+}
+
+bool readManifest(const juce::File& manifest, const RenderJob& defaults, std::vector<RenderJob>& jobs,
+                  juce::String& error) {
+  if (!manifest.existsAsFile()) {
+    error = "can't open " + manifest.getFullPathName();
+    return false;
+  }
+
+  const auto bank = openPresetBank(defaults.preset_bank, error);
+  if (bank == nullptr) {
+    return false;
+  }
+
+  const juce::File directory = manifest.getParentDirectory();
+  const int num_presets = bank->size();
+
+  juce::StringArray lines;
+  manifest.readLines(lines);
+
+  for (int line_index = 0; line_index < lines.size(); ++line_index) {
+    const juce::String line = lines[line_index].trim();
+    if (line.isEmpty() || line.startsWithChar('#')) {
+      continue;
+    }
+
+    const juce::String where = manifest.getFileName() + ":" + juce::String(line_index + 1) + ": ";
+
+    juce::StringArray fields;
+    fields.addTokens(line, " \t", "\"");
+    fields.removeEmptyStrings();
+    if (fields.size() != 4) {
+      error = where + "expected <input.mid> <preset> <sample rate> <output>";
+      return false;
+    }
+
+    RenderJob job = defaults;
+    job.midi_file = directory.getChildFile(fields[0].unquoted());
+    job.sample_rate = fields[2].getDoubleValue();
+    const juce::String output = fields[3].unquoted();
+
+    if (fields[1] == "*") {
+      if (!output.contains("{preset}")) {
+        error = where + "rendering every preset needs {preset} in the output path";
+        return false;
+      }
+
+      for (int preset = 0; preset < num_presets; ++preset) {
+        job.preset = preset;
+        job.output_file = directory.getChildFile(output.replace("{preset}", juce::String(preset).paddedLeft('0', 2)));
+        jobs.push_back(job);
+      }
+      continue;
+    }
+
+    if (!fields[1].containsOnly("0123456789")) {
+      error = where + "preset has to be an index or *";
+      return false;
+    }
+
+    job.preset = fields[1].getIntValue();
+    job.output_file = directory.getChildFile(output.replace("{preset}", juce::String(job.preset).paddedLeft('0', 2)));
+    jobs.push_back(job);
+  }
+
+  return true;
+}
+
+std::vector<RenderResult> renderBatch(const std::vector<RenderJob>& jobs, int num_threads,
+                                      const std::function<void(size_t, const RenderResult&)>& finished) {
+  std::vector<RenderResult> results(jobs.size());
+
+  // Jobs are claimed one at a time, so a thread that gets a long file doesn't hold up the rest.
+  std::atomic<size_t> next_job { 0 };
+  std::mutex finished_lock;
+
+  auto worker = [&] {
+    for (size_t job = next_job++; job < jobs.size(); job = next_job++) {
+      results[job] = render(jobs[job]);
+
+      if (finished) {
+        const std::lock_guard<std::mutex> lock(finished_lock);
+        finished(job, results[job]);
+      }
+    }
+  };
+
+  num_threads = std::clamp(num_threads, 1, std::max(int(jobs.size()), 1));
+
+  std::vector<std::thread> threads;
+  for (int i = 1; i < num_threads; ++i) {
+    threads.emplace_back(worker);
+  }
+  worker();
+
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  return results;
+}
+
+}  // namespace offline_render
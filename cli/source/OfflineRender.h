@@ -0,0 +1,68 @@
+#pragma once
+
+#include <juce_audio_formats/juce_audio_formats.h>
+#include "CX11Synth/LoadMonitor.h"
+#include "CX11Synth/OutputGuard.h"
+#include "CX11Synth/PresetBank.h"
+#include <functional>
+#include <vector>
+
+namespace offline_render {
+  // One MIDI file to render to one audio file. The format goes by the output file's extension
+  // (.wav or .flac).
+  struct RenderJob {
+    juce::File midi_file;
+    juce::File output_file;
+    double sample_rate = 48000.0;
+    int block_size = 512;
+    int preset = 0;
+    juce::File preset_bank; // a bank file, or empty for the presets that come with the plugin
+    int bits_per_sample = 24;
+    double tail_seconds = 2.0; // rendered after the last MIDI event, for the release tails
+    OutputGuard::Policy output_policy = OutputGuard::MUTE;
+    int voices = 8;         // polyphony, see Synth::voice_capacity
+    int render_threads = 0; // helper threads rendering voice banks for this job, see Synth.h
+  };
+
+  struct RenderResult {
+    bool ok = false;
+    juce::String error;
+    double audio_seconds = 0.0;  // length of the rendered audio
+    double render_seconds = 0.0; // wall clock time spent in processBlock
+    double total_seconds = 0.0;  // wall clock time for the whole job, file I/O included
+    LoadMonitor::Stats load;     // processBlock against the real-time budget of each block
+    OutputGuard::Counts output;  // blocks the output guard muted or clipped
+
+    // How many seconds of audio one second of rendering makes.
+    double realTimeFactor() const {
+      return render_seconds > 0.0 ? audio_seconds / render_seconds : 0.0;
+    }
+  };
+
+  // Renders the job with a processor of its own, as fast as the CPU goes. The processor runs in
+  // non-realtime mode, so parameter changes are picked up on every block instead of by the
+  // timer. Call it with the message manager initialised (a ScopedJuceInitialiser_GUI).
+  RenderResult render(const RenderJob& job);
+
+  // The presets RenderJob::preset picks from: the bank in `file`, or the ones that come with the
+  // plugin if `file` is empty. Returns nullptr and sets `error` if the bank can't be opened.
+  std::shared_ptr<const PresetBank> openPresetBank(const juce::File& file, juce::String& error);
+
+  // Reads a batch manifest, one job per line:
+  //
+  //   <input.mid> <preset> <sample rate> <output.wav|output.flac>
+  //
+  // Fields are separated by spaces or tabs, paths with spaces go in double quotes and relative
+  // paths are relative to the manifest. Empty lines and lines starting with # are skipped. A
+  // preset of * renders every preset, with {preset} in the output path replaced by the preset
+  // index. Block size, bit depth, tail, preset bank, output guard policy, voices and render threads come from `defaults`.
+  bool readManifest(const juce::File& manifest, const RenderJob& defaults, std::vector<RenderJob>& jobs,
+                    juce::String& error);
+
+  // Renders the jobs on `num_threads` threads, each job with a processor of its own. A thread
+  // only ever holds one job's processor and one block of audio, the rest goes straight to disk,
+  // so memory doesn't grow with the number of jobs. `finished` is called from the render
+  // threads (one at a time) as jobs complete. The results are in job order.
+  std::vector<RenderResult> renderBatch(const std::vector<RenderJob>& jobs, int num_threads,
+                                        const std::function<void(size_t, const RenderResult&)>& finished);
+}
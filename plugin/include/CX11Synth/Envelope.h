@@ -50,6 +50,8 @@ class Envelope {
         float release_multiplier;
         
     private:
+        friend struct VoiceBank;
+
         float multiplier;
         float target;
 };
\ No newline at end of file
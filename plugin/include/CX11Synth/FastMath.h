@@ -0,0 +1,95 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <stdint.h>
+
+// Polynomial stand-ins for the libm functions the synth calls per voice per LFO tick. They are
+// branchless (min/max only, no tables, no calls), so they inline into the caller and GCC/Clang
+// can vectorize a loop that uses them. The coefficients are minimax fits; the error bounds below
+// are measured over the whole stated range in float and checked by test/source/FastMathTest.cpp.
+//
+//   exp2(x)  relative error < 3e-7    for -126 <= x <= 127
+//   exp(x)   relative error < 1.5e-6  for |x| <= 20 (mostly the rounding of x * log2(e))
+//   sin(x)   absolute error < 3e-7    for |x| <= 1000 (grows with |x| from the range reduction)
+//   tan(x)   relative error < 1e-6    for |x| <= 1.5 (tan(1.5) ~= 14, the filter stays well below)
+//
+// Outside of those ranges the results are garbage, there's no clamping or NaN/inf handling: a clamp
+// against a constant is enough for GCC to split the loop into branches and stop vectorizing it,
+// and the synth's own inputs never get anywhere near the limits.
+namespace FastMath {
+    constexpr float PI = 3.1415926535897932f;
+    constexpr float HALF_PI = 1.5707963267948966f;
+
+    inline float exp2(float x) {
+        // Split into integer and fraction, the integer part goes straight into the exponent.
+        // x + 127 is positive so the cast rounds down, which saves a floor() (SSE4.1) or a compare
+        // (stops the vectorizer). When the add rounds up to the next integer, f comes out a hair
+        // below 0, which the polynomial doesn't mind.
+        const int e = int(x + 127.0f);
+        const float f = x - float(e - 127);
+
+        // 2^f on [0, 1). The constant term is pinned to 1 so whole octaves come out exact.
+        float p = 0.00189510729f;
+        p = p * f + 0.00895988811f;
+        p = p * f + 0.05583602036f;
+        p = p * f + 0.24015773548f;
+        p = p * f + 0.69315124876f;
+        p = p * f + 1.0f;
+
+        return p * std::bit_cast<float>(uint32_t(e) << 23);
+    }
+
+    inline float exp(float x) {
+        return exp2(x * 1.4426950408889634f);
+    }
+
+    // sin(x) for |x| <= pi / 2, the core of sin() and tan().
+    inline float sinQuadrant(float x) {
+        const float x2 = x * x;
+        float p = 2.60190307e-06f;
+        p = p * x2 - 1.98074187e-04f;
+        p = p * x2 + 8.33302514e-03f;
+        p = p * x2 - 1.66666567e-01f;
+        p = p * x2 + 9.99999995e-01f;
+        return x * p;
+    }
+
+    inline float sin(float x) {
+        // Bring x into [-pi, pi]. 2 pi is split in two so the reduction doesn't lose the low bits.
+        const float k = float(int(x * 0.15915494309189535f + std::copysign(0.5f, x)));
+        x = (x - k * 6.28125f) - k * 1.9353071795864769e-3f;
+
+        // sin(pi - x) == sin(x) folds it into [-pi/2, pi/2]
+        x = std::min(x, PI - x);
+        x = std::max(x, -PI - x);
+        return sinQuadrant(x);
+    }
+
+    // |x| < pi / 2
+    inline float tan(float x) {
+        return sinQuadrant(x) / sinQuadrant(HALF_PI - std::abs(x));
+    }
+}
+
+// What the synthesis code calls. Plain libm unless the project is configured with
+// CX11_FAST_MATH=ON, so the default build renders exactly what it always did.
+namespace SynthMath {
+#if CX11_FAST_MATH
+    inline float exp(float x) { return FastMath::exp(x); }
+    inline float exp2(float x) { return FastMath::exp2(x); }
+    inline float sin(float x) { return FastMath::sin(x); }
+    inline float tan(float x) { return FastMath::tan(x); }
+
+    // Frequency ratio of `semitones` equal tempered semitones.
+    inline float semitoneRatio(float semitones) { return FastMath::exp2(semitones * (1.0f / 12.0f)); }
+#else
+    inline float exp(float x) { return std::exp(x); }
+    inline float exp2(float x) { return std::exp2(x); }
+    inline float sin(float x) { return std::sin(x); }
+    inline float tan(float x) { return std::tan(x); }
+
+    inline float semitoneRatio(float semitones) { return std::pow(1.059463094359f, semitones); }
+#endif
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cmath>
+#include "FastMath.h"
 
 // state variable filter
 class Filter {
@@ -8,7 +9,7 @@ class Filter {
         float sample_rate;
 
         void updateCoefficients(float cutoff, float q) {
-            g = std::tan(PI * cutoff / sample_rate); // cutoff frequency
+            g = SynthMath::tan(PI * cutoff / sample_rate); // cutoff frequency
             k = 1.0f / q; // resonance
             a1 = 1.0f / (1.0f + g * (g + k));
             a2 = g * a1;
@@ -38,6 +39,8 @@ class Filter {
         }
 
     private:
+        friend struct VoiceBank;
+
         const float PI = 3.1415926535897932f;
         float g, k, a1, a2, a3; // coefficients
         float ic1eq, ic2eq;     // internal state;
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <stdint.h>
+
+// Times every processBlock against its real-time budget (the block's length at the sample rate)
+// and keeps a few statistics about it: a histogram of the load, the worst block, the deadline
+// misses and what was going on in the blocks that came close. Load 1.0 means the block took as
+// long as it lasts, anything over that is a dropout waiting to happen.
+//
+// The audio thread is the only writer and only does relaxed atomic stores, so it never waits on
+// anything. Any thread can read the statistics at any time: every number is consistent on its
+// own, but a read that races a block can see some numbers from before it and some from after.
+class LoadMonitor {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        static constexpr int NUM_BUCKETS = 12;    // 10% of the budget each, the last one is 110% and up
+        static constexpr int NUM_SPIKES = 16;     // most recent blocks at SPIKE_LOAD or over
+        static constexpr float SPIKE_LOAD = 0.8f;
+
+        // What else happened in a block, for endBlock().
+        enum Flags : uint32_t {
+            PARAMETERS_CHANGED = 1, // a new parameter snapshot came in (automation, a preset)
+            PROGRAM_CHANGED = 2,
+        };
+
+        struct Spike {
+            uint64_t block;         // Stats::blocks when it happened (the low 32 bits of it)
+            float load;
+            int note_ons;           // note-ons in the block, saturates at 255
+            uint32_t flags;
+        };
+
+        struct Stats {
+            uint64_t blocks = 0;
+            uint64_t deadline_misses = 0;
+            float load = 0.0f;          // last block
+            float average_load = 0.0f;  // over roughly the last 64 blocks
+            float peak_load = 0.0f;
+            double worst_block_seconds = 0.0;
+            std::array<uint64_t, NUM_BUCKETS> histogram {};
+            int num_spikes = 0;         // valid entries in spikes, newest first
+            std::array<Spike, NUM_SPIKES> spikes {};
+        };
+
+        // Audio thread, at the start of the block.
+        static Clock::time_point beginBlock() { return Clock::now(); }
+
+        // Audio thread, at the end of the block.
+        void endBlock(Clock::time_point start, int num_samples, double sample_rate, int note_ons, uint32_t flags) {
+            if (num_samples <= 0 || sample_rate <= 0.0) {
+                return;
+            }
+
+            const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+            const float load = float(seconds * sample_rate / double(num_samples));
+
+            if (reset_requested_.exchange(false, std::memory_order_relaxed)) {
+                clear();
+            }
+
+            const uint64_t block = blocks_.load(std::memory_order_relaxed) + 1;
+            blocks_.store(block, std::memory_order_relaxed);
+
+            if (load > 1.0f) {
+                deadline_misses_.store(deadline_misses_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            }
+
+            const int bucket = std::min(int(load * 10.0f), NUM_BUCKETS - 1);
+            histogram_[size_t(bucket)].store(histogram_[size_t(bucket)].load(std::memory_order_relaxed) + 1,
+                                             std::memory_order_relaxed);
+
+            const float average = average_load_.load(std::memory_order_relaxed);
+            average_load_.store(block == 1 ? load : average + (load - average) / 64.0f, std::memory_order_relaxed);
+            load_.store(load, std::memory_order_relaxed);
+
+            if (load > peak_load_.load(std::memory_order_relaxed)) {
+                peak_load_.store(load, std::memory_order_relaxed);
+                worst_block_seconds_.store(seconds, std::memory_order_relaxed);
+            }
+
+            if (load >= SPIKE_LOAD) {
+                const uint32_t index = next_spike_.load(std::memory_order_relaxed);
+                spikes_[index % NUM_SPIKES].store(packSpike(block, load, note_ons, flags), std::memory_order_relaxed);
+                next_spike_.store(index + 1, std::memory_order_release);
+            }
+        }
+
+        // Any thread.
+        Stats getStats() const {
+            Stats stats;
+            stats.blocks = blocks_.load(std::memory_order_relaxed);
+            stats.deadline_misses = deadline_misses_.load(std::memory_order_relaxed);
+            stats.load = load_.load(std::memory_order_relaxed);
+            stats.average_load = average_load_.load(std::memory_order_relaxed);
+            stats.peak_load = peak_load_.load(std::memory_order_relaxed);
+            stats.worst_block_seconds = worst_block_seconds_.load(std::memory_order_relaxed);
+
+            for (size_t i = 0; i < histogram_.size(); ++i) {
+                stats.histogram[i] = histogram_[i].load(std::memory_order_relaxed);
+            }
+
+            const uint32_t next = next_spike_.load(std::memory_order_acquire);
+            stats.num_spikes = int(std::min(next, uint32_t(NUM_SPIKES)));
+            for (int i = 0; i < stats.num_spikes; ++i) {
+                stats.spikes[size_t(i)] = unpackSpike(spikes_[(next - 1 - uint32_t(i)) % NUM_SPIKES].load(std::memory_order_relaxed));
+            }
+
+            return stats;
+        }
+
+        // Any thread. The statistics start over with the next block.
+        void reset() {
+            reset_requested_.store(true, std::memory_order_relaxed);
+        }
+
+    private:
+        std::atomic<bool> reset_requested_ { false };
+
+        std::atomic<uint64_t> blocks_ { 0 };
+        std::atomic<uint64_t> deadline_misses_ { 0 };
+        std::atomic<float> load_ { 0.0f };
+        std::atomic<float> average_load_ { 0.0f };
+        std::atomic<float> peak_load_ { 0.0f };
+        std::atomic<double> worst_block_seconds_ { 0.0 };
+        std::array<std::atomic<uint64_t>, NUM_BUCKETS> histogram_ {};
+
+        // A spike fits in one word so a reader never sees half of one: the block number in the
+        // low 32 bits, then the load in 0.1% steps, the note-ons and the flags.
+        std::array<std::atomic<uint64_t>, NUM_SPIKES> spikes_ {};
+        std::atomic<uint32_t> next_spike_ { 0 };
+
+        void clear() {
+            blocks_.store(0, std::memory_order_relaxed);
+            deadline_misses_.store(0, std::memory_order_relaxed);
+            load_.store(0.0f, std::memory_order_relaxed);
+            average_load_.store(0.0f, std::memory_order_relaxed);
+            peak_load_.store(0.0f, std::memory_order_relaxed);
+            worst_block_seconds_.store(0.0, std::memory_order_relaxed);
+            for (auto& bucket : histogram_) {
+                bucket.store(0, std::memory_order_relaxed);
+            }
+            next_spike_.store(0, std::memory_order_release);
+        }
+
+        static uint64_t packSpike(uint64_t block, float load, int note_ons, uint32_t flags) {
+            const uint64_t permille = uint64_t(std::clamp(load * 1000.0f, 0.0f, 65535.0f));
+            return (block & 0xFFFFFFFF) | (permille << 32) | (uint64_t(std::clamp(note_ons, 0, 255)) << 48)
+                 | (uint64_t(flags & 0xFF) << 56);
+        }
+
+        static Spike unpackSpike(uint64_t packed) {
+            return { packed & 0xFFFFFFFF, float((packed >> 32) & 0xFFFF) / 1000.0f, int((packed >> 48) & 0xFF),
+                     uint32_t(packed >> 56) };
+        }
+};
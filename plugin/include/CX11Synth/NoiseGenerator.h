@@ -14,6 +14,26 @@
                 return float(temp) / 16777216.0f;
             }
 
+            // Same as calling next_value() sample_count times, but in O(log n). Stepping the LCG
+            // n times is again an LCG, so square the step until all bits of n are used up.
+            void skip(int sample_count) {
+                unsigned int mul = 1;
+                unsigned int add = 0;
+                unsigned int step_mul = 196314165;
+                unsigned int step_add = 907633515;
+
+                for (unsigned int n = unsigned(sample_count); n > 0; n >>= 1) {
+                    if (n & 1) {
+                        mul *= step_mul;
+                        add = add * step_mul + step_add;
+                    }
+                    step_add = (step_mul + 1) * step_add;
+                    step_mul *= step_mul;
+                }
+
+                noise_seed = noise_seed * mul + add;
+            }
+
         private:
             unsigned int noise_seed;
     };
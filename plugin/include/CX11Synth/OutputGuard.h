@@ -0,0 +1,180 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <stdint.h>
+
+#include <juce_audio_processors/juce_audio_processors.h>
+
+#if JUCE_INTEL
+    #include <immintrin.h>
+#elif JUCE_ARM && defined(__ARM_NEON)
+    #include <arm_neon.h>
+#endif
+
+// Last stage before the host gets the audio: keeps a broken patch (or a bug) from sending NaNs,
+// infinities or screaming feedback to somebody's speakers.
+//
+// The check is one SIMD pass over each channel that finds the lowest and highest sample and
+// whether there's a NaN anywhere. Only a block that fails it is touched again, so the usual case
+// costs a few instructions per 4 samples and no branches per sample.
+//
+// Each channel is checked and fixed on its own, so a channel that goes bad doesn't take the other
+// one with it. NaN or infinity always silences the channel for the block. What happens to samples
+// outside -1..1 is up to the policy:
+//   MUTE       silences the channel when a sample goes past MUTE_LEVEL, clamps it otherwise
+//   CLAMP      always clamps to -1..1
+//   SOFT_CLIP  bends everything above KNEE smoothly towards 1, so nothing reaches it
+//
+// Nothing is printed. Muted and clipped blocks are counted in atomics that any thread can read
+// with getCounts().
+class OutputGuard {
+    public:
+        enum Policy : int { MUTE, CLAMP, SOFT_CLIP };
+
+        static constexpr float MUTE_LEVEL = 2.0f;  // screaming feedback
+        static constexpr float KNEE = 0.8f;        // SOFT_CLIP leaves everything below alone
+
+        struct Counts {
+            uint64_t muted_blocks = 0;   // a channel silenced, for NaN/infinity or (MUTE) past MUTE_LEVEL
+            uint64_t clipped_blocks = 0; // a channel clamped or soft-clipped
+        };
+
+        // Any thread, takes effect with the next block.
+        void setPolicy(Policy new_policy) { policy_.store(new_policy, std::memory_order_relaxed); }
+        Policy getPolicy() const { return policy_.load(std::memory_order_relaxed); }
+
+        Counts getCounts() const {
+            return { muted_blocks_.load(std::memory_order_relaxed), clipped_blocks_.load(std::memory_order_relaxed) };
+        }
+
+        // Audio thread. `right` can be nullptr for mono. A block counts once however many
+        // channels were touched.
+        void process(float* left, float* right, int sample_count) {
+            if (sample_count <= 0) {
+                return;
+            }
+
+            const Policy policy = getPolicy();
+            const Action left_action = processChannel(left, sample_count, policy);
+            const Action right_action = right != nullptr ? processChannel(right, sample_count, policy) : NONE;
+
+            if (left_action == MUTED || right_action == MUTED) {
+                count(muted_blocks_);
+            }
+            if (left_action == CLIPPED || right_action == CLIPPED) {
+                count(clipped_blocks_);
+            }
+        }
+
+        // The curve SOFT_CLIP applies to a sample: straight up to KNEE, then x / (1 + x) scaled
+        // to meet the line with the same slope and approach 1.
+        static float softClip(float x) {
+            const float magnitude = std::abs(x);
+            if (magnitude <= KNEE) {
+                return x;
+            }
+            const float over = (magnitude - KNEE) / (1.0f - KNEE);
+            return std::copysign(KNEE + (1.0f - KNEE) * over / (1.0f + over), x);
+        }
+
+    private:
+        struct Range {
+            float min = 0.0f;
+            float max = 0.0f;
+            bool nan = false;
+        };
+
+        enum Action { NONE, MUTED, CLIPPED };
+
+        std::atomic<Policy> policy_ { MUTE };
+        std::atomic<uint64_t> muted_blocks_ { 0 };
+        std::atomic<uint64_t> clipped_blocks_ { 0 };
+
+        // Only the audio thread writes, so a load and a store will do.
+        static void count(std::atomic<uint64_t>& counter) {
+            counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+
+        static Action processChannel(float* buffer, int sample_count, Policy policy) {
+            const Range range = scan(buffer, sample_count);
+            const float peak = std::max(-range.min, range.max);
+
+            if (range.nan || std::isinf(peak) || (policy == MUTE && peak > MUTE_LEVEL)) {
+                juce::FloatVectorOperations::clear(buffer, sample_count);
+                return MUTED;
+            }
+
+            if (policy == SOFT_CLIP) {
+                if (peak > KNEE) {
+                    softClip(buffer, sample_count);
+                    return CLIPPED;
+                }
+            } else if (peak > 1.0f) {
+                juce::FloatVectorOperations::clip(buffer, buffer, -1.0f, 1.0f, sample_count);
+                return CLIPPED;
+            }
+            return NONE;
+        }
+
+        static void softClip(float* buffer, int sample_count) {
+            for (int i = 0; i < sample_count; ++i) {
+                buffer[i] = softClip(buffer[i]);
+            }
+        }
+
+        // min/max can't be trusted to see a NaN (SSE returns the other operand), so NaNs are
+        // looked for separately: a NaN is the only value that isn't equal to itself.
+        static Range scan(const float* buffer, int sample_count) {
+            Range range;
+            int i = 0;
+
+#if JUCE_INTEL
+            __m128 min = _mm_setzero_ps();
+            __m128 max = _mm_setzero_ps();
+            __m128 nan = _mm_setzero_ps();
+            for (; i + 4 <= sample_count; i += 4) {
+                const __m128 x = _mm_loadu_ps(buffer + i);
+                min = _mm_min_ps(min, x);
+                max = _mm_max_ps(max, x);
+                nan = _mm_or_ps(nan, _mm_cmpunord_ps(x, x));
+            }
+
+            alignas(16) float mins[4], maxs[4];
+            _mm_store_ps(mins, min);
+            _mm_store_ps(maxs, max);
+            range.min = std::min(std::min(mins[0], mins[1]), std::min(mins[2], mins[3]));
+            range.max = std::max(std::max(maxs[0], maxs[1]), std::max(maxs[2], maxs[3]));
+            range.nan = _mm_movemask_ps(nan) != 0;
+#elif JUCE_ARM && defined(__ARM_NEON)
+            float32x4_t min = vdupq_n_f32(0.0f);
+            float32x4_t max = vdupq_n_f32(0.0f);
+            uint32x4_t equal = vdupq_n_u32(0xFFFFFFFF);
+            for (; i + 4 <= sample_count; i += 4) {
+                const float32x4_t x = vld1q_f32(buffer + i);
+                min = vminq_f32(min, x);
+                max = vmaxq_f32(max, x);
+                equal = vandq_u32(equal, vceqq_f32(x, x));
+            }
+
+            float mins[4], maxs[4];
+            uint32_t equals[4];
+            vst1q_f32(mins, min);
+            vst1q_f32(maxs, max);
+            vst1q_u32(equals, equal);
+            range.min = std::min(std::min(mins[0], mins[1]), std::min(mins[2], mins[3]));
+            range.max = std::max(std::max(maxs[0], maxs[1]), std::max(maxs[2], maxs[3]));
+            range.nan = (equals[0] & equals[1] & equals[2] & equals[3]) == 0;
+#endif
+
+            for (; i < sample_count; ++i) {
+                const float x = buffer[i];
+                range.min = std::min(range.min, x);
+                range.max = std::max(range.max, x);
+                range.nan = range.nan || x != x;
+            }
+
+            return range;
+        }
+};
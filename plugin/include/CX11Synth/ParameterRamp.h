@@ -0,0 +1,115 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include "FastMath.h"
+
+// Takes a parameter from its old value to a new one in a fixed number of steps instead of
+// jumping, so automating it doesn't zipper. A step is whatever the caller advances it by: one
+// sample, or one LFO tick for the parameters that are only read on a tick.
+//
+// Linear ramps are for parameters that are additive or already on a log scale, exponential
+// ones for ratios (resonance, detune), which then move at an even rate by ear.
+//
+// While the ramp isn't moving, next() and fill() are a compare and a copy, so the synth can run
+// every parameter through one without paying for the ones that aren't automated.
+class ParameterRamp {
+    public:
+        enum Shape { LINEAR, EXPONENTIAL };
+
+        void prepare(Shape new_shape, int num_steps) {
+            shape = new_shape;
+            steps = std::max(num_steps, 1);
+            jump(target);
+        }
+
+        // No ramp, e.g. for the first value after a reset.
+        void jump(float value) {
+            current = value;
+            target = value;
+            remaining = 0;
+        }
+
+        void setTarget(float new_target) {
+            if (new_target == target) {
+                return;
+            }
+
+            target = new_target;
+            remaining = steps;
+
+            // An exponential ramp can't cross or touch zero, those go in a straight line.
+            exponential = shape == EXPONENTIAL && current > 0.0f && target > 0.0f;
+            increment = exponential ? std::log2(target / current) / float(steps)
+                                    : (target - current) / float(steps);
+            start = current;
+            step = 0;
+        }
+
+        bool isMoving() const { return remaining > 0; }
+        float getValue() const { return current; }
+        float getTarget() const { return target; }
+
+        float next() {
+            if (remaining > 0) {
+                advance(1);
+            }
+            return current;
+        }
+
+        // The next `count` values, one per step. Computed from the start of the ramp rather than
+        // from the previous value so the loop has no dependency from one sample to the next (and
+        // vectorizes with CX11_FAST_MATH).
+        void fill(float* dest, int count) {
+            const int ramp = std::min(count, remaining);
+            const float base = float(step + 1);
+
+            if (exponential) {
+                for (int i = 0; i < ramp; ++i) {
+                    dest[i] = start * SynthMath::exp2(increment * (base + float(i)));
+                }
+            } else {
+                for (int i = 0; i < ramp; ++i) {
+                    dest[i] = start + increment * (base + float(i));
+                }
+            }
+
+            // Same as advance(): the last step lands on the target itself.
+            if (ramp > 0 && ramp == remaining) {
+                dest[ramp - 1] = target;
+            }
+
+            advance(ramp);
+            std::fill(dest + ramp, dest + count, target);
+        }
+
+        void skip(int count) {
+            advance(std::min(count, remaining));
+        }
+
+    private:
+        Shape shape = LINEAR;
+        int steps = 1;
+
+        float current = 0.0f;
+        float target = 0.0f;
+        int remaining = 0;
+
+        bool exponential = false;
+        float start = 0.0f;
+        float increment = 0.0f; // per step, in log2 for exponential ramps
+        int step = 0;           // steps taken since start
+
+        void advance(int count) {
+            step += count;
+            remaining -= count;
+
+            if (remaining == 0) {
+                current = target; // no rounding error left over at the end
+            } else if (exponential) {
+                current = start * SynthMath::exp2(increment * float(step));
+            } else {
+                current = start + increment * float(step);
+            }
+        }
+};
@@ -40,8 +40,12 @@ namespace audio_plugin {
     juce::TextButton poly_mode_button;
     ButtonAttachment poly_mode_attachment { audioProcessor.apvts, ParameterId::poly_mode.getParamID(), poly_mode_button };
 
+    // CPU load of the audio thread, see LoadMonitor.
+    juce::Label load_label;
+
     void buttonClicked(juce::Button* button);
     void timerCallback() override;
+    void updateLoadLabel();
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(CX11SynthAudioProcessorEditor)
   };
@@ -2,44 +2,22 @@
 
 #include <juce_audio_processors/juce_audio_processors.h>
 #include "Synth.h"
-#include "Preset.h"
-
-namespace ParameterId {
-  #define PARAMETER_ID(str) const juce::ParameterID str(#str, 1);
-
-  PARAMETER_ID(osc_mix)
-  PARAMETER_ID(osc_tune)
-  PARAMETER_ID(osc_fine)
-  PARAMETER_ID(glide_mode)
-  PARAMETER_ID(glide_rate)
-  PARAMETER_ID(glide_bend)
-  PARAMETER_ID(filter_freq)
-  PARAMETER_ID(filter_reso)
-  PARAMETER_ID(filter_env)
-  PARAMETER_ID(filter_lfo)
-  PARAMETER_ID(filter_velocity)
-  PARAMETER_ID(filter_attack)
-  PARAMETER_ID(filter_decay)
-  PARAMETER_ID(filter_sustain)
-  PARAMETER_ID(filter_release)
-  PARAMETER_ID(env_attack)
-  PARAMETER_ID(env_decay)
-  PARAMETER_ID(env_sustain)
-  PARAMETER_ID(env_release)
-  PARAMETER_ID(lfo_rate)
-  PARAMETER_ID(vibrato)
-  PARAMETER_ID(noise)
-  PARAMETER_ID(octave)
-  PARAMETER_ID(tuning)
-  PARAMETER_ID(output_level)
-  PARAMETER_ID(poly_mode)
-
-  #undef PARAMETER_ID
-}
+#include "SynthParameters.h"
+#include "TripleBuffer.h"
+#include "LoadMonitor.h"
+#include "OutputGuard.h"
+#include "RealtimeLog.h"
+#include "PresetBank.h"
+#include "PresetLibrary.h"
+#include "PresetMorph.h"
+#include "ParameterRamp.h"
+#include "ParameterId.h"
 
 namespace audio_plugin {
   class CX11SynthAudioProcessor : public juce::AudioProcessor,
-                                  private juce::ValueTree::Listener {
+                                  private juce::AudioProcessorParameter::Listener,
+                                  private juce::ChangeListener,
+                                  private juce::Timer {
   public:
       juce::AudioProcessorValueTreeState apvts { *this, nullptr, "Parameters", createParameterLayout() };
 
@@ -49,6 +27,28 @@ namespace audio_plugin {
       std::atomic<bool> midi_learn;
       std::atomic<uint8_t> midi_learn_cc;
 
+      // Voices to allocate in prepareToPlay (see Synth::voice_capacity). Saved with the state.
+      // Changing it only takes effect the next time the host prepares the plugin.
+      int polyphony = Synth::DEFAULT_VOICES;
+
+      // Helper threads rendering voice banks next to the audio thread (see
+      // Synth::render_threads), 0 for none. Read in prepareToPlay.
+      int render_threads = 0;
+
+      // How long a program change fades out whatever is playing before the voices are reset and
+      // the new program takes over, 0 to cut straight away. Read in prepareToPlay.
+      double program_fade_seconds = 0.01;
+
+      // How long the sound takes to follow the morph parameter. Read in prepareToPlay.
+      double morph_glide_seconds = 0.02;
+
+      // How long processBlock takes against the time it has. Written by the audio thread, read
+      // by the editor (or anything else) whenever it likes.
+      LoadMonitor load_monitor;
+
+      // The safety stage at the end of the synth: its policy, and how often it stepped in.
+      OutputGuard& getOutputGuard() { return outputGuard; }
+
       void prepareToPlay(double sampleRate, int samplesPerBlock) override;
       void releaseResources() override;
       void reset() override;
@@ -74,14 +74,85 @@ namespace audio_plugin {
       const juce::String getProgramName(int index) override;
       void changeProgramName(int index, const juce::String& newName) override;
 
+      // Swaps the presets the host and MIDI program changes pick from for the bank in `file`
+      // (see PresetBank). Message thread. Returns false and keeps the presets it had if the
+      // file can't be opened. The bank is remembered in the plugin state.
+      bool loadPresetBank(const juce::File& file, juce::String& error);
+
+      // Programs come from `library` instead of the preset bank for as long as it has any,
+      // nullptr goes back to the bank. The host pages through the names in the library's index,
+      // a preset's bank is only opened when it's picked. Message thread.
+      void usePresetLibrary(std::shared_ptr<PresetLibrary> library);
+
+      // Plays a morph between `presets` (up to PresetMorph::MAX_PRESETS) instead of the
+      // parameters, from the next block on and without resetting the voices. The "morph"
+      // parameter goes from the first preset at 0% to the last at 100%. Fewer than two presets
+      // end the morph and the parameters take over again. Saved with the state. Message thread.
+      void setMorphPresets(const std::vector<Preset>& presets);
+
       void getStateInformation(juce::MemoryBlock& destData) override;
       void setStateInformation(const void* data, int sizeInBytes) override;
   private:
       Synth synth;
 
-      std::atomic<bool> parametersChanged { false };
-      std::vector<Preset> presets;
-      int currentProgram;
+      // Runs over each host block once it's finished, however many renders it took.
+      OutputGuard outputGuard;
+
+      // Keeps the thread that writes out the real-time log running while any instance is alive.
+      juce::SharedResourcePointer<RealtimeLog::Writer> logWriter;
+
+      // Parameter changes reach the audio thread as a snapshot of the derived synth settings.
+      // The listeners only flag the parameter (bit n = parameter index n) from whatever thread
+      // changed it; the timer works out what depends on the flagged ones and publishes the
+      // snapshot, and processBlock swaps the newest one in.
+      static constexpr uint32_t ALL_PARAMETERS = 0xFFFFFFFF;
+      std::atomic<uint32_t> dirtyParameters { ALL_PARAMETERS };
+      juce::SpinLock parameterLock;      // one updateParameters() at a time
+      SynthParameters synthParameters;   // updateParameters() only
+      float parameterSampleRate = 44100.0f;
+      TripleBuffer<SynthParameters> parameterSnapshot;
+      std::shared_ptr<const PresetBank> presetBank = PresetBank::factory(); // message thread
+      std::shared_ptr<PresetLibrary> presetLibrary;                    // message thread
+      std::shared_ptr<const PresetLibrary::Snapshot> libraryPrograms; // the library as the host sees it
+      int currentProgram = 0;
+
+      // Program changes. A MIDI program change only leaves the program number in pendingProgram
+      // and the timer takes it from there (applyPendingProgram()). setCurrentProgram() sets the
+      // parameters and publishes the whole snapshot with program_changes bumped; when the audio
+      // thread sees that, it holds the snapshot back, fades out what's playing and then resets
+      // the voices and applies it at the start of a block (switchProgram()).
+      std::atomic<int> pendingProgram { -1 };
+
+      // Notes that come after a program change belong to the new program. The audio thread
+      // counts the MIDI program changes it sees in programRequests, the timer sets
+      // handledProgramRequests to the count it has dealt with (applied or ignored), and until
+      // the two match and the switch is done, note-ons and note-offs wait in heldNotes.
+      std::atomic<uint32_t> programRequests { 0 };
+      std::atomic<uint32_t> handledProgramRequests { 0 };
+
+      uint32_t appliedProgramChanges = 0; // audio thread from here on
+      uint32_t handledRequests = 0;       // handledProgramRequests as of the start of the block
+      SynthParameters programParameters;  // the snapshot waiting for the fade to finish
+      bool programPending = false;
+      int programFadeSamples = 0;
+      int programFadeRemaining = 0;
+
+      struct MidiEvent {
+        uint8_t data0, data1, data2;
+      };
+      static constexpr int MAX_HELD_NOTES = 256;
+      std::array<MidiEvent, MAX_HELD_NOTES> heldNotes;
+      int numHeldNotes = 0;
+
+      // Morphing. setMorphPresets() hands a prepared PresetMorph over through morphSnapshot.
+      // While the morph's position moves, the audio thread renders MORPH_STEP samples at a time
+      // and applies the morph's settings before each step (renderUpTo()). Parameter changes
+      // are ignored while it plays, program changes still go through.
+      static constexpr int MORPH_STEP = Synth::LFO_MAX;
+      TripleBuffer<PresetMorph> morphSnapshot;
+      PresetMorph morph;       // audio thread
+      ParameterRamp morphRamp; // the position, one step per MORPH_STEP
+      std::vector<Preset> morphPresets; // message thread, for the state
 
       juce::AudioParameterFloat* osc_mix_param;
       juce::AudioParameterFloat* osc_tune_param;
@@ -109,16 +180,45 @@ namespace audio_plugin {
       juce::AudioParameterFloat* tuning_param;
       juce::AudioParameterFloat* output_level_param;
       juce::AudioParameterChoice* poly_mode_param;
+      juce::AudioParameterChoice* osc_engine_param;
+      juce::AudioParameterFloat* morph_param;
 
       juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
-      void createPrograms();
-      void update();
-      void splitBufferByEvents(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages);
-      void handleMIDI(uint8_t data0, uint8_t data1, uint8_t data2);
+      void updateParameters();
+      void update(uint32_t dirty);
+      // The parameters a Preset sets, in Preset::param order.
+      std::array<juce::RangedAudioParameter*, NUM_PARAMS> presetParameters() const;
+      void applyPendingProgram();
+      bool usesLibrary() const;
+      void changeListenerCallback(juce::ChangeBroadcaster*) override;
+      void setBinaryState(const void* data, int sizeInBytes);
+      // The XML state of earlier versions.
+      void setXmlState(const void* data, int sizeInBytes);
+      void beginProgramChange(const SynthParameters& parameters);
+      void fadeOutProgram(juce::AudioBuffer<float>& buffer);
+      void switchProgram();
+      bool holdingNotes() const;
+      void releaseHeldNotes();
+      bool morphing() const { return morph.size() > 0; }
+      void startMorph(const PresetMorph& next);
+      void applyMorph();
+      float morphTarget() const;
+      // Returns the number of note-ons, for the load monitor.
+      int renderWithEvents(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages);
+      // Handles the MIDI the processor cares about itself, returns false if the synth shouldn't get it.
+      bool handleMIDI(uint8_t data0, uint8_t data1, uint8_t data2);
       void render(juce::AudioBuffer<float>& buffer, int sampleCount, int bufferOffset);
+      void renderUpTo(juce::AudioBuffer<float>& buffer, int end, int& bufferOffset);
+
+      void parameterValueChanged(int parameterIndex, float) override {
+        dirtyParameters.fetch_or(1u << parameterIndex);
+      }
+
+      void parameterGestureChanged(int, bool) override {}
 
-      void valueTreePropertyChanged(juce::ValueTree&, const juce::Identifier&) override {
-        parametersChanged.store(true);
+      void timerCallback() override {
+        applyPendingProgram();
+        updateParameters();
       }
 
       JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(CX11SynthAudioProcessor)
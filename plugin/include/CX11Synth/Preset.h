@@ -2,9 +2,19 @@
 
 #include <cstring>
 
-const int NUM_PARAMS = 26;
+const int NUM_PARAMS = 27;
 
 struct Preset {
+    // Indices into param.
+    enum Param {
+        OSC_MIX, OSC_TUNE, OSC_FINE, GLIDE_MODE, GLIDE_RATE, GLIDE_BEND, FILTER_FREQ, FILTER_RESO,
+        FILTER_ENV, FILTER_LFO, FILTER_VELOCITY, FILTER_ATTACK, FILTER_DECAY, FILTER_SUSTAIN,
+        FILTER_RELEASE, ENV_ATTACK, ENV_DECAY, ENV_SUSTAIN, ENV_RELEASE, LFO_RATE, VIBRATO, NOISE,
+        OCTAVE, TUNING, OUTPUT_LEVEL, POLY_MODE, OSC_ENGINE
+    };
+
+    Preset() = default;
+
     Preset(const char* name,
         float p0,  float p1,  float p2,  float p3,
         float p4,  float p5,  float p6,  float p7,
@@ -12,10 +22,11 @@ struct Preset {
         float p12, float p13, float p14, float p15,
         float p16, float p17, float p18, float p19,
         float p20, float p21, float p22, float p23,
-        float p24, float p25
+        float p24, float p25,
+        float p26 = 0.0f
     )
     {
-        strcpy(this->name, name);
+        setName(name);
         param[0] =  p0;     // Osc Mix
         param[1] =  p1;     // Osc Tune
         param[2] =  p2;     // Osc Fine
@@ -42,8 +53,17 @@ struct Preset {
         param[23] = p23;    // Tuning
         param[24] = p24;    // Output Level
         param[25] = p25;    // Poly Mode
+        param[26] = p26;    // Osc Engine
     }
 
-    char name[40];
-    float param[NUM_PARAMS];
+    // Cut to fit, always zero-terminated.
+    void setName(const char* new_name) {
+        std::strncpy(name, new_name, sizeof(name) - 1);
+        name[sizeof(name) - 1] = '\0';
+    }
+
+    char name[40] = {};
+    float param[NUM_PARAMS] = {};
 };
+
+static_assert(Preset::OSC_ENGINE == NUM_PARAMS - 1, "an index for every parameter");
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <memory>
+#include <stdint.h>
+#include <vector>
+
+#include <juce_audio_processors/juce_audio_processors.h>
+#include "Preset.h"
+
+// Presets in a binary file that's read through a read-only memory map instead of being parsed.
+// Opening a bank only checks its header; a name or a preset's values are read out of the map
+// when somebody asks for them, so a user bank with tens of thousands of patches opens as fast as
+// one with ten. Banks are shared: every processor that opens the same file gets the same map,
+// and the presets that come with the plugin are made into a bank once per process.
+//
+// The file, all numbers little-endian:
+//   header       "CX11BANK", then uint32 version, preset count, parameter count, name table
+//                offset, parameter block offset and a reserved 0 (HEADER_SIZE bytes)
+//   name table   NAME_LENGTH bytes per preset, UTF-8 and zero padded
+//   parameters   one block of `parameter count` floats per preset, in Preset::param order
+//
+// A bank from before a parameter was added loads with the missing ones at 0, parameters this
+// build doesn't know about are skipped.
+class PresetBank {
+    public:
+        static constexpr uint32_t VERSION = 1;
+        static constexpr size_t HEADER_SIZE = 32;
+        static constexpr int NAME_LENGTH = int(sizeof(Preset::name));
+
+        // The presets that come with the plugin.
+        static std::shared_ptr<const PresetBank> factory();
+
+        // Maps `file` and checks its header. Returns nullptr and sets `error` if it isn't a bank.
+        static std::shared_ptr<const PresetBank> open(const juce::File& file, juce::String& error);
+
+        // A bank in memory, for presets that don't come from a bank file.
+        static std::shared_ptr<const PresetBank> fromPresets(const std::vector<Preset>& presets);
+
+        static bool write(const std::vector<Preset>& presets, const juce::File& file, juce::String& error);
+
+        // Tab-separated text, a line with the parameter IDs and then a line per preset (the name
+        // and the parameter values), for editing in a spreadsheet or a text editor. readText()
+        // matches the columns to the parameters by the IDs in the header.
+        static bool writeText(const std::vector<Preset>& presets, const juce::File& file, juce::String& error);
+        static bool readText(const juce::File& file, std::vector<Preset>& presets, juce::String& error);
+
+        int size() const { return count_; }
+        juce::String name(int index) const;
+        Preset preset(int index) const;
+        std::vector<Preset> presets() const; // all of them, which reads the whole bank
+
+        const juce::File& file() const { return file_; } // empty for a bank in memory
+
+    private:
+        juce::File file_;
+        juce::Time modified_;
+        std::unique_ptr<juce::MemoryMappedFile> map_;
+        juce::MemoryBlock memory_;
+
+        int count_ = 0;
+        int param_count_ = 0;
+        const char* names_ = nullptr;
+        const char* params_ = nullptr;
+
+        PresetBank() = default;
+
+        // Checks the header of the bank in `data` and points names_ and params_ into it.
+        bool parse(const void* data, size_t size, juce::String& error);
+
+        static void write(const std::vector<Preset>& presets, juce::OutputStream& stream);
+
+        JUCE_DECLARE_NON_COPYABLE(PresetBank)
+};
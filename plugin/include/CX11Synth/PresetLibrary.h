@@ -0,0 +1,116 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <stdint.h>
+#include <vector>
+
+#include <juce_audio_processors/juce_audio_processors.h>
+#include "PresetBank.h"
+
+// Every preset in the bank files (.cx11bank, see PresetBank) under a few directories, for
+// browsing and searching a sound designer's whole collection.
+//
+// A background thread walks the directories and keeps an index of what it found (name, tags and
+// parameter values per preset) in a file, so the next run starts from the index and only opens
+// the banks that are new or have changed since. Each scan ends with a new Snapshot that's
+// swapped in for the old one. Queries run on a snapshot, on whatever thread asks, and never wait
+// for a scan: a prefix search is a binary search over the sorted names and a similarity search
+// is a pass over the parameter values, both well under a millisecond for tens of thousands of
+// presets.
+//
+// Tags are the folders between the scanned directory and the bank, the bank's file name and an
+// author code in brackets at the end of the preset name ("Echo Pad [SA]").
+class PresetLibrary : public juce::ChangeBroadcaster, private juce::Thread {
+    public:
+        struct Entry {
+            juce::String name;
+            juce::StringArray tags;
+            juce::File bank;
+            int index = 0;                          // in the bank
+            std::array<float, NUM_PARAMS> params {}; // what the similarity search compares
+        };
+
+        // The library as of one scan, sorted by name. Never changes once made.
+        class Snapshot {
+            public:
+                explicit Snapshot(std::vector<Entry> entries);
+
+                int size() const { return int(entries_.size()); }
+                const Entry& operator[](int index) const { return entries_[size_t(index)]; }
+
+                // Indices of the entries whose name starts with `prefix`, ignoring case, in
+                // name order.
+                std::vector<int> findPrefix(const juce::String& prefix, int max_results = 100) const;
+
+                // Indices of the entries with `tag`, ignoring case.
+                std::vector<int> findTag(const juce::String& tag, int max_results = 100) const;
+
+                // Indices of the `count` entries that sound most alike to `params`, closest
+                // first. Each parameter counts in proportion to how far it varies across the
+                // library, so a 0..100 percentage doesn't drown out a -2..2 octave switch.
+                std::vector<int> findSimilar(const float (&params)[NUM_PARAMS], int count = 10) const;
+
+                // Opens the entry's bank (or shares it, see PresetBank::open) and reads the preset.
+                bool load(int index, Preset& preset, juce::String& error) const;
+
+            private:
+                std::vector<Entry> entries_;
+                std::vector<juce::String> keys_;          // lower-case names, for findPrefix
+                std::array<float, NUM_PARAMS> weights_ {}; // 1 / range of each parameter
+        };
+
+        // The index is kept in `index_file` between runs. Nothing is scanned until
+        // setDirectories().
+        explicit PresetLibrary(const juce::File& index_file);
+        ~PresetLibrary() override;
+
+        // Scans these directories (and everything under them) from now on, starting right away.
+        void setDirectories(const juce::Array<juce::File>& directories);
+
+        // Looks for new, changed and deleted banks. setDirectories() does this too.
+        void rescan();
+
+        // The latest snapshot, empty before the first scan or index load. Any thread, doesn't
+        // wait for a scan that's running. Listeners get a change message whenever it's replaced.
+        std::shared_ptr<const Snapshot> snapshot() const;
+
+        // Blocks until the scan that's running or asked for is done. Not for the message thread,
+        // it's there for the render app and the tests.
+        bool waitForScan(int timeout_ms);
+
+    private:
+        // One bank file, as it was when it was indexed.
+        struct Bank {
+            int64_t size = 0;
+            int64_t modified = 0; // milliseconds
+            std::vector<Entry> entries;
+        };
+
+        const juce::File index_file_;
+
+        juce::CriticalSection directories_lock_;
+        juce::Array<juce::File> directories_;
+
+        mutable juce::SpinLock snapshot_lock_;
+        std::shared_ptr<const Snapshot> snapshot_;
+
+        // rescan() counts up requested_scans_, the thread sets finished_scans_ to the count it
+        // had when it started the scan it just finished.
+        std::atomic<uint32_t> requested_scans_ { 0 };
+        std::atomic<uint32_t> finished_scans_ { 0 };
+        juce::WaitableEvent scan_finished_;
+
+        // The scanning thread's, by path.
+        std::map<juce::String, Bank> banks_;
+
+        void run() override;
+        void scan();
+        void publish();
+        bool readIndex();
+        bool writeIndex() const;
+
+        JUCE_DECLARE_NON_COPYABLE(PresetLibrary)
+};
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <array>
+
+#include "SynthParameters.h"
+
+// Morphs between two or more presets with one control. The presets sit at positions 0, 1, 2, ...
+// and a position in between blends the two on either side of it.
+//
+// What gets blended are the settings the presets work out to (SynthParameters), each in the
+// domain where halfway sounds like halfway: ratios (resonance, detune, tuning, LFO rate, output
+// level) as their log, the envelope and glide coefficients as the log of their rate, which is
+// the log of the time they take, and the rest as they are. Switches (poly, glide mode, osc engine,
+// velocity off) flip at the halfway point.
+//
+// The presets are worked out once, in prepare(). A position is then a multiply-add and at most
+// two exps per setting and doesn't depend on the number of voices, so the processor can work it
+// out every LFO tick for as long as the morph moves.
+class PresetMorph {
+    public:
+        static constexpr int MAX_PRESETS = 8;
+
+        // Up to MAX_PRESETS presets, the rest are dropped. Needs a prepare() before evaluate().
+        void setPresets(const Preset* presets, int count);
+
+        // Works out the presets' settings at this sample rate. Doesn't allocate.
+        void prepare(float sample_rate);
+
+        int size() const { return count_; }
+        float getSampleRate() const { return sample_rate_; }
+
+        // The settings at `position`, from 0 (the first preset) to size() - 1 (the last one).
+        // Exactly the preset's own settings at a whole number. Doesn't allocate.
+        void evaluate(float position, SynthParameters& params) const;
+
+    private:
+        enum Domain { LINEAR, LOG, RATE, GLIDE };
+
+        struct Setting {
+            float SynthParameters::*value;
+            Domain domain;
+        };
+
+        static constexpr int NUM_SETTINGS = 24;
+        static const Setting settings[NUM_SETTINGS];
+
+        static float encode(float value, Domain domain);
+        static float decode(float value, Domain domain);
+
+        int count_ = 0;
+        float sample_rate_ = 0.0f;
+        std::array<std::array<float, NUM_PARAMS>, MAX_PRESETS> presets_ {};
+        std::array<SynthParameters, MAX_PRESETS> parameters_ {};
+        std::array<std::array<float, NUM_SETTINGS>, MAX_PRESETS> encoded_ {}; // see settings
+};
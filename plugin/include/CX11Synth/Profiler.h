@@ -0,0 +1,146 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <ostream>
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    #if defined(_MSC_VER)
+        #include <intrin.h>
+    #else
+        #include <x86intrin.h>
+    #endif
+#endif
+
+// Scoped timing of the stages of the voice pipeline, for seeing where a patch spends its cycles
+// without attaching a profiler to a DAW. Build with -DCX11_PROFILING=ON, otherwise
+// CX11_PROFILE_ZONE() compiles to nothing.
+//
+// A zone reads the CPU's cycle counter when it opens and closes and pushes the pair into a ring
+// buffer owned by the calling thread, so recording never locks or allocates (except the first
+// zone on a thread, which sets up its buffer). When a buffer is full new zones are dropped until
+// someone calls collect(). The headless renderer collects after every block and writes the lot
+// out as a Chrome trace (chrome://tracing or ui.perfetto.dev).
+//
+// Zones are opened per control-rate chunk, not per sample, so they cost a few percent at most.
+
+#ifndef CX11_PROFILING
+    #define CX11_PROFILING 0
+#endif
+
+namespace Profiler {
+    enum Zone : uint8_t {
+        RENDER,             // Synth::render, everything below but the output guard happens inside it
+        MIDI,               // applying note and controller events
+        LFO,                // LFO ticks and the per-voice modulation updates
+        ENVELOPE,
+        OSCILLATOR,
+        FILTER,             // leaky integrator, noise and filter
+        MIXDOWN,            // panning, summing the banks, output level
+        OUTPUT_GUARD,       // NaN/range check of the finished host block
+        NUM_ZONES
+    };
+
+    constexpr bool ENABLED = CX11_PROFILING != 0;
+
+    const char* zoneName(Zone zone);
+
+    // Cycle counter, or nanoseconds where there isn't one. ticksPerSecond() converts.
+    inline uint64_t now() {
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+        return __rdtsc();
+#elif defined(__aarch64__)
+        uint64_t ticks;
+        asm volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+        return ticks;
+#else
+        return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+    }
+
+    struct Event {
+        uint64_t start;
+        uint64_t end;
+        Zone zone;
+    };
+
+    // One thread's zones. Only that thread writes, only collect() reads.
+    class ThreadLog {
+        public:
+            static constexpr uint32_t CAPACITY = 1 << 15; // power of two
+
+            explicit ThreadLog(uint32_t id) : thread_id(id) {}
+
+            void push(const Event& event) {
+                const uint32_t write = write_.load(std::memory_order_relaxed);
+                if (write - read_.load(std::memory_order_acquire) == CAPACITY) {
+                    dropped_.fetch_add(1, std::memory_order_relaxed);
+                    return;
+                }
+
+                events_[write & (CAPACITY - 1)] = event;
+                write_.store(write + 1, std::memory_order_release);
+            }
+
+            // Calls `f` for every event logged since the last call.
+            template <typename F>
+            void drain(F&& f) {
+                const uint32_t write = write_.load(std::memory_order_acquire);
+                uint32_t read = read_.load(std::memory_order_relaxed);
+                for (; read != write; ++read) {
+                    f(events_[read & (CAPACITY - 1)]);
+                }
+                read_.store(read, std::memory_order_release);
+            }
+
+            uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+            const uint32_t thread_id;
+
+        private:
+            std::array<Event, CAPACITY> events_;
+            std::atomic<uint32_t> write_ { 0 };
+            std::atomic<uint32_t> read_ { 0 };
+            std::atomic<uint64_t> dropped_ { 0 };
+    };
+
+    // The calling thread's log, set up on first use and kept until the process ends (so zones
+    // from threads that have already finished can still be collected).
+    ThreadLog& threadLog();
+
+    class Scope {
+        public:
+            explicit Scope(Zone zone) : zone_(zone), start_(now()) {}
+            ~Scope() { threadLog().push({ start_, now(), zone_ }); }
+
+            Scope(const Scope&) = delete;
+            Scope& operator=(const Scope&) = delete;
+
+        private:
+            Zone zone_;
+            uint64_t start_;
+    };
+
+    // Moves the zones out of every thread's log into the trace. Not real-time safe, call it from
+    // a thread that isn't rendering (or between blocks). Does nothing in a build without
+    // CX11_PROFILING.
+    void collect();
+
+    // Writes everything collected so far as Chrome trace event JSON and empties the trace.
+    // Returns the number of zones that were dropped because a log was full.
+    uint64_t writeChromeTrace(std::ostream& stream);
+
+    double ticksPerSecond();
+}
+
+#define CX11_PROFILE_CONCAT_(a, b) a##b
+#define CX11_PROFILE_CONCAT(a, b) CX11_PROFILE_CONCAT_(a, b)
+
+#if CX11_PROFILING
+    #define CX11_PROFILE_ZONE(zone) const Profiler::Scope CX11_PROFILE_CONCAT(profile_zone_, __LINE__) { Profiler::zone }
+#else
+    #define CX11_PROFILE_ZONE(zone)
+#endif
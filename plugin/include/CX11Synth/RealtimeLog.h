@@ -0,0 +1,129 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdarg>
+#include <cstdio>
+#include <memory>
+#include <stdint.h>
+
+#include <juce_audio_processors/juce_audio_processors.h>
+
+// Log messages that are safe to post from the audio thread. A message is formatted straight into
+// a fixed-size record in a ring buffer and a background thread (Writer) takes it from there to
+// stdout or a file, so the thread that posts never waits for I/O, a lock or the allocator.
+//
+// Records are claimed with a compare-and-swap instead of a single producer index, because a
+// batch render runs several synths on several threads and the message thread posts too. There
+// is only ever one reader, the Writer. When the ring is full new messages are dropped and
+// counted, and the Writer says how many it missed.
+class RealtimeLog {
+    public:
+        static constexpr int CAPACITY = 256;   // records, power of two
+        static constexpr int MAX_LENGTH = 120; // characters per message, longer ones are cut
+
+        RealtimeLog() {
+            for (size_t i = 0; i < records_.size(); ++i) {
+                records_[i].sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        // The log everybody posts to.
+        static RealtimeLog& shared() {
+            static RealtimeLog log;
+            return log;
+        }
+
+        // printf-style. Formats with vsnprintf into the record, which doesn't allocate for the
+        // plain %d, %s and %f conversions used in this code base. Returns false if the message
+        // was dropped.
+#if JUCE_GCC || JUCE_CLANG
+        __attribute__((format(printf, 2, 3)))
+#endif
+        bool post(const char* format, ...) {
+            va_list args;
+            va_start(args, format);
+            const bool posted = postV(format, args);
+            va_end(args);
+            return posted;
+        }
+
+        bool postV(const char* format, va_list args) {
+            uint64_t position = write_.load(std::memory_order_relaxed);
+            Record* record = nullptr;
+
+            for (;;) {
+                record = &records_[position & (CAPACITY - 1)];
+                const uint64_t sequence = record->sequence.load(std::memory_order_acquire);
+                const int64_t difference = int64_t(sequence) - int64_t(position);
+
+                if (difference == 0) {
+                    if (write_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                        break;
+                    }
+                } else if (difference < 0) {
+                    dropped_.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                } else {
+                    position = write_.load(std::memory_order_relaxed);
+                }
+            }
+
+            std::vsnprintf(record->text, MAX_LENGTH, format, args);
+            record->sequence.store(position + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Reader side, only one thread at a time. Calls `f` with every message posted since the
+        // last call, oldest first.
+        template <typename F>
+        int drain(F&& f) {
+            int count = 0;
+            for (;; ++count) {
+                Record& record = records_[read_ & (CAPACITY - 1)];
+                if (record.sequence.load(std::memory_order_acquire) != read_ + 1) {
+                    return count; // empty, or the next message is still being written
+                }
+
+                f(static_cast<const char*>(record.text));
+                record.sequence.store(read_ + CAPACITY, std::memory_order_release);
+                ++read_;
+            }
+        }
+
+        uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+        // Drains the shared log every few milliseconds into the file named by the CX11_LOG_FILE
+        // environment variable, or stdout without one (and the debugger in a Debug build). Made
+        // through a juce::SharedResourcePointer, so all plugin instances in a process share one.
+        class Writer : private juce::Thread {
+            public:
+                Writer();
+                ~Writer() override;
+
+            private:
+                std::unique_ptr<juce::FileOutputStream> file_;
+                uint64_t reported_dropped_ = 0;
+
+                void run() override;
+                void writeAll();
+
+                JUCE_DECLARE_NON_COPYABLE(Writer)
+        };
+
+    private:
+        struct Record {
+            std::atomic<uint64_t> sequence; // position + 1 once written, position + CAPACITY once read
+            char text[MAX_LENGTH];
+        };
+
+        std::array<Record, CAPACITY> records_;
+        std::atomic<uint64_t> write_ { 0 };
+        uint64_t read_ = 0;
+        std::atomic<uint64_t> dropped_ { 0 };
+
+        JUCE_DECLARE_NON_COPYABLE(RealtimeLog)
+};
+
+// Posts to the shared log, e.g. CX11_LOG("Learned a MIDI cc: %d", cc).
+#define CX11_LOG(...) RealtimeLog::shared().post(__VA_ARGS__)
@@ -3,8 +3,12 @@
 //#include <JuceHeader.h>
 #include <stdint.h>
 #include <array>
+#include <vector>
 #include "Voice.h"
+#include "VoiceBank.h"
 #include "NoiseGenerator.h"
+#include "ParameterRamp.h"
+#include "WorkerPool.h"
 
 #include <juce_audio_processors/juce_audio_processors.h> 
 
@@ -13,8 +17,10 @@ class Synth {
     public: 
         Synth();
 
-        static constexpr int MAX_VOICES = 8;
-        const int LFO_MAX = 32;
+        // Upper limit for voice_capacity. The voices themselves are allocated in allocate_resources().
+        static constexpr int MAX_VOICES = 128;
+        static constexpr int DEFAULT_VOICES = 8;
+        static constexpr int LFO_MAX = 32;
         uint8_t reso_cc = 0x47;
 
         int num_voices;
@@ -50,6 +56,21 @@ class Synth {
         float filter_release;
         float filter_env_depth;
         bool ignore_velocity;
+        int osc_engine = 0; // 0 = BLIT, 1 = wavetable. Picked up by the next note-on.
+
+        // Render with the original per-sample, per-voice loop instead of the block renderer.
+        // Both produce the same output; this is only here to A/B them.
+        bool reference_render = false;
+
+        // Number of helper threads rendering voice banks next to the audio thread. 0 renders
+        // everything on the audio thread. Only read in allocate_resources().
+        int render_threads = 0;
+
+        // How many voices to allocate, rounded up to whole banks of VoiceBank::LANES and capped at
+        // MAX_VOICES. Only read in allocate_resources(). Rendering cost goes with the number of
+        // voices that are sounding, not with this.
+        int voice_capacity = DEFAULT_VOICES;
+        int getVoiceCapacity() const { return int(voices_.size()); }
 
         juce::LinearSmoothedValue<float> output_level_smoother;
 
@@ -57,6 +78,20 @@ class Synth {
         void deallocate_resources();
         void reset();
         void render(float** output_buffers, int sample_count);
+
+        // Hands a MIDI message to the next render() call, `sample_position` samples into the
+        // block. Messages have to be queued in order. render() takes them in-line: note-ons,
+        // note-offs, sustain and all-notes-off at their exact sample, everything else (mod wheel,
+        // pitch bend, pressure, ...) right before the LFO tick that would pick it up anyway, so
+        // a dense controller stream doesn't cut the block into small renders.
+        // Returns false when the queue is full; render what's queued and try again.
+        bool queueMidiMessage(int sample_position, uint8_t data0, uint8_t data1, uint8_t data2);
+
+        // True when no voice is sounding. Until the next note-on the output is silence and
+        // skip() can be used instead of render().
+        bool isSilent() const { return active_voices_.empty(); }
+        void skip(int sample_count);
+        // Applies a MIDI message right away, between two render() calls.
         void midi_message(uint8_t data0, uint8_t data1, uint8_t data2);
         void controlChange(uint8_t data1, uint8_t data2);
 
@@ -66,13 +101,133 @@ class Synth {
         int lfo_step;
         bool sustained_pedal_pressed;
 
-        std::array<Voice, MAX_VOICES> voices_;
+        std::vector<Voice> voices_;
         NoiseGenerator noise_gen;
 
+        // In mono mode the voices after the first one double as a queue of held notes.
+        static constexpr int NOTE_QUEUE_SIZE = 8;
+
+        // Voices that are sounding, sorted by voice index. startVoice() and restartMonoVoice() add
+        // to it, render() drops the voices that went quiet. Nothing else needs to look at the
+        // voices that aren't in here.
+        std::vector<int> active_voices_;
+
+        // Which voices hold which note: one linked list per MIDI note through next_voice_, plus
+        // one for voices held by the sustain pedal. Note 0 means "no note" and has no list.
+        // Only change Voice::note through setVoiceNote().
+        static constexpr int NO_VOICE = -1;
+        static constexpr int SUSTAIN_LIST = 128;
+        std::array<int, SUSTAIN_LIST + 1> note_voices_;
+        std::vector<int> next_voice_;
+        int held_notes_ = 0; // voices with note > 0
+
+        // The sounding voices are packed into banks of VoiceBank::LANES and rendered one LFO chunk
+        // at a time. There's a chunk renderer for every combination of RenderTraits, so the
+        // parts of the voice a patch doesn't use aren't computed at all. render_chunks_ holds them
+        // for the widest instruction set the CPU supports, picked once in the constructor, and
+        // renderBlocks() picks one per bank at the start of every block.
+        using RenderChunkFn = void (*)(VoiceBank&, Voice* const*, const float*, int);
+
+        struct RenderTraits {
+            bool osc2;  // some voice in the bank has the second oscillator turned up
+            bool noise; // noise mix isn't 0
+        };
+
+        static constexpr int kernelIndex(RenderTraits traits) {
+            return (traits.osc2 ? 1 : 0) | (traits.noise ? 2 : 0);
+        }
+        static_assert(MAX_VOICES % VoiceBank::LANES == 0, "voices have to fill whole banks");
+        static_assert(VoiceBank::MAX_SAMPLES == LFO_MAX, "one bank chunk per LFO step");
+
+        // What an LFO tick hands to the voices. Pitch bend and resonance are in here too since
+        // controller events change them on the tick (see queueMidiMessage()).
+        struct Modulation {
+            float vibrato_mod;
+            float pwm;
+            float filter_mod;
+            float pitch_bend;
+            float filter_q;
+            float filter_env_depth;
+            float detune;
+        };
+
+        // The LFO runs on the audio thread before the banks are rendered, this is what each chunk
+        // of the block needs from it.
+        struct LFOChunk {
+            int offset;
+            int length;
+            bool tick; // false if the chunk continues an LFO step from the previous block
+            Modulation modulation;
+        };
+
+        std::array<RenderChunkFn, 4> render_chunks_;
+        std::array<RenderChunkFn, MAX_VOICES / VoiceBank::LANES> bank_kernels_ {};
+        bool noise_on_ = false; // this block
+        std::vector<VoiceBank> banks_;
+        WorkerPool pool_;
+
+        // Per block scratch, sized in allocate_resources()
+        int max_block_size_ = 0;
+        int num_chunks_ = 0;
+        std::vector<LFOChunk> lfo_chunks_;
+        std::vector<float> noise_buffer_;
+        std::vector<float> bank_left_;  // one row of max_block_size_ per bank
+        std::vector<float> bank_right_;
+        std::vector<Voice*> bank_voices_;  // LANES per bank, nullptr for an empty lane
+        int num_banks_ = 0;                // banks in use for this block
+
+        float vibrato_mod_ = 1.0f;
+        float pwm_ = 1.0f;
+
+        // The public parameter fields are targets: the ones that shape the sound continuously
+        // glide to a new value over RAMP_TIME instead of jumping, so automating them doesn't
+        // zipper. Noise is mixed in per sample, the rest are only read on an LFO tick and ramp one
+        // step per tick. (filter_key_tracking already goes through the filter_zip smoothing.)
+        static constexpr float RAMP_TIME = 0.02f; // seconds
+        ParameterRamp noise_mix_ramp_;
+        ParameterRamp vibrato_ramp_;
+        ParameterRamp pwm_depth_ramp_;
+        ParameterRamp filter_lfo_depth_ramp_;
+        ParameterRamp filter_q_ramp_;
+        ParameterRamp filter_env_depth_ramp_;
+        ParameterRamp detune_ramp_;
+        bool tick_ramps_moving_ = false;
+        bool ramps_started_ = false; // the first targets after a reset are jumped to
+        std::vector<float> noise_mix_buffer_;
+
+        // MIDI for the current render() call, see queueMidiMessage(). A fixed array so queueing
+        // never allocates; MAX_EVENTS is far more than a host sends in one block.
+        struct MidiEvent {
+            int position;
+            uint8_t data0, data1, data2;
+        };
+        static constexpr int MAX_EVENTS = 1024;
+        std::array<MidiEvent, MAX_EVENTS> events_;
+        int num_events_ = 0;
+        int next_event_ = 0;      // first event that hasn't been applied yet
+        int block_position_ = 0;  // where the block being rendered starts within the render() call
+
+        void renderSegment(float* output_buffer_left, float* output_buffer_right, int sample_count);
+        void updateRamps();
+        void stepTickRamps();
+        bool tickRampsMoving() const;
+        void applyEvents(int position);
+        int nextVoiceEvent(int sample_count) const;
+
+        void renderBlocks(float* output_buffer_left, float* output_buffer_right, int sample_count);
+        void renderReference(float* output_buffer_left, float* output_buffer_right, int sample_count);
+        void renderBank(int b);
+        static void renderBankJob(void* context, int index);
         void updateLFO();
+        bool advanceLFO();
+        Modulation currentModulation() const;
+        void applyLFO(Voice& voice, const Modulation& modulation);
         void shiftQueuedNotes();
         int nextQueuedNote();
         void restartMonoVoice(int note, int velocity);
+        void activateVoice(int v);
+        void setVoiceNote(int v, int note);
+        void resetVoices();
         int findFreeVoice() const;
         void startVoice(int v, int note, int velocity);
         void noteOn(int note, int velocity);
@@ -80,9 +235,9 @@ class Synth {
         float calcPeriod(int v, int note) const;
         bool isPlayingLegatoStyle() const;
 
-        inline void updatePeriod(Voice& voice) {
-            voice.osc1.period = voice.period * pitch_bend;
-            voice.osc2.period = voice.osc1.period * detune;
+        inline void updatePeriod(Voice& voice, float bend, float detune_ratio) {
+            voice.osc1.period = voice.period * bend;
+            voice.osc2.period = voice.osc1.period * detune_ratio;
         }
 };
 //} // End NameSpace
\ No newline at end of file
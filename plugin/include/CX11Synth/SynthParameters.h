@@ -0,0 +1,88 @@
+#pragma once
+
+#include "Synth.h"
+#include "Preset.h"
+
+// The synth settings the processor works out from its parameters (the exp/pow curves, the sample
+// rate dependent coefficients). Worked out off the audio thread, one parameter at a time, and
+// handed to the audio thread as a whole through a TripleBuffer, so all the audio thread does is
+// copy a few dozen numbers into the Synth.
+struct SynthParameters {
+    float env_attack = 0.0f;
+    float env_decay = 0.0f;
+    float env_sustain = 0.0f;
+    float env_release = 0.0f;
+    float noise_mix = 0.0f;
+    float filter_key_tracking = 0.0f;
+    float filter_q = 1.0f;
+    float osc_mix = 0.0f;
+    float volume_trim = 0.0f;
+    float detune = 1.0f;
+    float tune = 0.0f;
+    bool poly = true;
+    int osc_engine = 0;
+    float output_level = 1.0f; // gain, not dB
+    float vibrato = 0.0f;
+    float pwm_depth = 0.0f;
+    float velocity_sensitivity = 0.0f;
+    bool ignore_velocity = false;
+    float lfo_inc = 0.0f;
+    int glide_mode = 0;
+    float glide_rate = 1.0f;
+    float glide_bend = 0.0f;
+    float filter_lfo_depth = 0.0f;
+    float filter_attack = 0.0f;
+    float filter_decay = 0.0f;
+    float filter_sustain = 0.0f;
+    float filter_release = 0.0f;
+    float filter_env_depth = 0.0f;
+
+    // Works out the settings from parameter values in Preset::param order (the processor's
+    // parameters, or a preset's). Only what depends on a value whose bit is set in `dirty` (bit n
+    // = Preset::param[n]) is worked out again. Not for the audio thread.
+    void update(const float (&values)[NUM_PARAMS], uint32_t dirty, float sample_rate);
+
+    // All of it worked out from a preset, for driving a Synth without a processor (benchmarks,
+    // golden renders).
+    static SynthParameters fromPreset(const Preset& preset, float sample_rate) {
+        SynthParameters params;
+        params.update(preset.param, 0xFFFFFFFF, sample_rate);
+        return params;
+    }
+
+    // Goes up by one with every program change. applyTo() ignores it, the processor resets the
+    // voices before applying a snapshot where it has moved.
+    uint32_t program_changes = 0;
+
+    // Audio thread.
+    void applyTo(Synth& synth) const {
+        synth.env_attack = env_attack;
+        synth.env_decay = env_decay;
+        synth.env_sustain = env_sustain;
+        synth.env_release = env_release;
+        synth.noise_mix = noise_mix;
+        synth.filter_key_tracking = filter_key_tracking;
+        synth.filter_q = filter_q;
+        synth.osc_mix = osc_mix;
+        synth.volume_trim = volume_trim;
+        synth.detune = detune;
+        synth.tune = tune;
+        synth.num_voices = poly ? synth.getVoiceCapacity() : 1;
+        synth.osc_engine = osc_engine;
+        synth.output_level_smoother.setTargetValue(output_level);
+        synth.vibrato = vibrato;
+        synth.pwm_depth = pwm_depth;
+        synth.velocity_sensitivity = velocity_sensitivity;
+        synth.ignore_velocity = ignore_velocity;
+        synth.lfo_inc = lfo_inc;
+        synth.glide_mode = glide_mode;
+        synth.glide_rate = glide_rate;
+        synth.glide_bend = glide_bend;
+        synth.filter_lfo_depth = filter_lfo_depth;
+        synth.filter_attack = filter_attack;
+        synth.filter_decay = filter_decay;
+        synth.filter_sustain = filter_sustain;
+        synth.filter_release = filter_release;
+        synth.filter_env_depth = filter_env_depth;
+    }
+};
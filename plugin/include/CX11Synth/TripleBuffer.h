@@ -0,0 +1,48 @@
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+// Hands the latest value of a T from one writer thread to one reader thread without either of
+// them ever waiting on the other. The writer fills its own slot and swaps it with the spare one;
+// the reader swaps its slot with the spare one when there's something new in it. Three slots
+// mean the writer always has one the reader can't be looking at.
+//
+// Values in between can be skipped (the reader only ever sees the newest one), so it's only for
+// state snapshots, not for messages.
+template <typename T>
+class TripleBuffer {
+    public:
+        // Writer: the slot to fill in. Stays valid until publish().
+        T& writeSlot() { return slots_[write_]; }
+
+        // Writer: makes the write slot the newest value.
+        void publish() {
+            write_ = spare_.exchange(write_ | FRESH, std::memory_order_acq_rel) & INDEX_MASK;
+        }
+
+        void publish(const T& value) {
+            writeSlot() = value;
+            publish();
+        }
+
+        // Reader: the newest value if one was published since the last call, nullptr otherwise.
+        // The pointer stays valid until the next call.
+        const T* read() {
+            if ((spare_.load(std::memory_order_relaxed) & FRESH) == 0) {
+                return nullptr;
+            }
+
+            read_ = spare_.exchange(read_, std::memory_order_acq_rel) & INDEX_MASK;
+            return &slots_[read_];
+        }
+
+    private:
+        static constexpr uint32_t INDEX_MASK = 3;
+        static constexpr uint32_t FRESH = 4; // set on the spare slot index when it holds a new value
+
+        T slots_[3] {};
+        uint32_t write_ = 0;                 // only touched by the writer
+        uint32_t read_ = 1;                  // only touched by the reader
+        std::atomic<uint32_t> spare_ { 2 };
+};
@@ -2,8 +2,10 @@
 
 #include <algorithm>
 #include "Envelope.h"
+#include "FastMath.h"
 #include "Filter.h"
 #include "Oscillator.h"
+#include "WavetableOscillator.h"
 
 struct Voice {
     int note;
@@ -24,6 +26,12 @@ struct Voice {
     Oscillator osc1;
     Oscillator osc2;
 
+    // Used instead of osc1/osc2 when the voice was started with the wavetable engine. Synth only
+    // writes the oscillator settings to osc1/osc2, syncWavetables() copies them over.
+    WavetableOscillator wavetable1;
+    WavetableOscillator wavetable2;
+    bool wavetable = false;
+
     void reset() {
         note = 0;
         saw = 0.0f;
@@ -32,6 +40,8 @@ struct Voice {
         filter.reset();
         osc1.reset();
         osc2.reset();
+        wavetable1.reset();
+        wavetable2.reset();
         env.reset();
         filter_env.reset();
     }
@@ -43,8 +53,21 @@ struct Voice {
 
     float render(float input) {
         // 0.997f is a "leaky" integrator. Acts as a LPF that prevents an offset from building up.
-        float sample1 = osc1.next_sample();
-        float sample2 = osc2.next_sample();
+        // A silent second oscillator isn't run, same as in the block renderer, so both leave it
+        // in the same state.
+        float sample1, sample2 = 0.0f;
+        if (wavetable) {
+            syncWavetables();
+            sample1 = wavetable1.next_sample();
+            if (osc2.amplitude != 0.0f) {
+                sample2 = wavetable2.next_sample();
+            }
+        } else {
+            sample1 = osc1.next_sample();
+            if (osc2.amplitude != 0.0f) {
+                sample2 = osc2.next_sample();
+            }
+        }
 
         saw = saw * 0.997f + sample1 - sample2;
          
@@ -61,17 +84,26 @@ struct Voice {
         // return envelope; // DEBUG ENV SHAPE
     }
 
+    void syncWavetables() {
+        wavetable1.amplitude = osc1.amplitude;
+        wavetable1.period = osc1.period;
+        wavetable1.modulation = osc1.modulation;
+        wavetable2.amplitude = osc2.amplitude;
+        wavetable2.period = osc2.period;
+        wavetable2.modulation = osc2.modulation;
+    }
+
     // TODO - lookup Haas effect / comb filtering  re: stereo widening
     void updatePanning() {
         float panning = std::clamp((note - 60.0f) / 24.0f, -1.0f, 1.0f);
-        pan_left = std::sin(PI_OVER_4 * (1.0f - panning));
-        pan_right = std::sin(PI_OVER_4 * (1.0f + panning));
+        pan_left = SynthMath::sin(PI_OVER_4 * (1.0f - panning));
+        pan_right = SynthMath::sin(PI_OVER_4 * (1.0f + panning));
     }
 
     void update_LFO() {
         period += glide_rate * (target - period);
         float fenv = filter_env.nextValue();
-        float modulated_cutoff =  cutoff * std::exp(filter_mod + filter_env_depth * fenv) / pitch_bend;
+        float modulated_cutoff =  cutoff * SynthMath::exp(filter_mod + filter_env_depth * fenv) / pitch_bend;
         modulated_cutoff = std::clamp(modulated_cutoff, 30.0f, 20000.0f);
         filter.updateCoefficients(modulated_cutoff, filter_q); // 0.707 (sqrt(.5)) means no resonance. Consider this the minimum value
     }
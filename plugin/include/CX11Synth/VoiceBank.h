@@ -0,0 +1,210 @@
+#pragma once
+
+#include "Voice.h"
+
+// GCC fully unrolls the 8-iteration lane loops before the vectorizer gets to see them and then
+// can't put the unrolled statements back together. Keeping the loops rolled lets it vectorize them.
+#if defined(__GNUC__)
+    #define LANE_LOOP _Pragma("GCC unroll 1")
+#else
+    #define LANE_LOOP
+#endif
+
+// Structure-of-arrays copy of the per-sample voice state. Voice keeps one Filter and Envelope
+// per struct (AoS), which means the compiler can't put the same field of several voices into one
+// SIMD register. The bank holds the leaky integrator, the SVF and the amp envelope of every voice
+// side by side in aligned lanes so the lane loops turn into a handful of packed instructions
+// (8 voices == 2 SSE/NEON or 1 AVX register).
+//
+// The bank only lives for one control-rate chunk (LFO_MAX samples). The coefficients only change
+// on an LFO tick, so Synth loads the voices into the lanes at the start of a chunk and stores them
+// back at the end. Everything else (glide, filter envelope, panning, notes) stays in Voice.
+//
+// A chunk is rendered in stages rather than sample by sample: amp envelopes for all lanes, then
+// each voice's oscillators on their own, then integrator + filter for all lanes. The result is one
+// row of samples per voice, which Synth pans and sums into the output in a separate pass.
+struct VoiceBank {
+    static constexpr int LANES = 8;
+    static constexpr int MAX_SAMPLES = 32; // one control-rate chunk
+
+    alignas(32) float saw[LANES];
+
+    // amp envelope
+    alignas(32) float level[LANES];
+    alignas(32) float multiplier[LANES];
+    alignas(32) float target[LANES];
+    alignas(32) float decay_multiplier[LANES];
+    alignas(32) float sustain_level[LANES];
+
+    // state variable filter
+    alignas(32) float a1[LANES];
+    alignas(32) float a2[LANES];
+    alignas(32) float a3[LANES];
+    alignas(32) float ic1eq[LANES];
+    alignas(32) float ic2eq[LANES];
+
+    alignas(32) float pan_left[LANES];
+    alignas(32) float pan_right[LANES];
+
+    // Scratch for one chunk. Rows are samples and columns are lanes, except for output which has
+    // one row per lane so the mixdown can run over contiguous samples.
+    alignas(32) float env[MAX_SAMPLES][LANES];
+    alignas(32) float gate[MAX_SAMPLES][LANES];
+    alignas(32) float osc1[MAX_SAMPLES][LANES];
+    alignas(32) float osc2[MAX_SAMPLES][LANES];
+    alignas(32) float output[LANES][MAX_SAMPLES];
+
+    // How many samples of the chunk each lane was still above SILENCE for. Once a lane drops out
+    // its state is frozen, so the gate never comes back on within the chunk.
+    int active_samples[LANES];
+
+    void load(int lane, const Voice& voice) {
+        saw[lane] = voice.saw;
+
+        level[lane] = voice.env.level;
+        multiplier[lane] = voice.env.multiplier;
+        target[lane] = voice.env.target;
+        decay_multiplier[lane] = voice.env.decay_multiplier;
+        sustain_level[lane] = voice.env.sustain_level;
+
+        a1[lane] = voice.filter.a1;
+        a2[lane] = voice.filter.a2;
+        a3[lane] = voice.filter.a3;
+        ic1eq[lane] = voice.filter.ic1eq;
+        ic2eq[lane] = voice.filter.ic2eq;
+
+        pan_left[lane] = voice.pan_left;
+        pan_right[lane] = voice.pan_right;
+    }
+
+    // Empty lane in a bank that isn't full. It stays below SILENCE so it never renders.
+    void clear(int lane) {
+        saw[lane] = 0.0f;
+
+        level[lane] = 0.0f;
+        multiplier[lane] = 0.0f;
+        target[lane] = 0.0f;
+        decay_multiplier[lane] = 0.0f;
+        sustain_level[lane] = 0.0f;
+
+        a1[lane] = 0.0f;
+        a2[lane] = 0.0f;
+        a3[lane] = 0.0f;
+        ic1eq[lane] = 0.0f;
+        ic2eq[lane] = 0.0f;
+
+        pan_left[lane] = 0.0f;
+        pan_right[lane] = 0.0f;
+    }
+
+    void store(int lane, Voice& voice) const {
+        voice.saw = saw[lane];
+
+        voice.env.level = level[lane];
+        voice.env.multiplier = multiplier[lane];
+        voice.env.target = target[lane];
+
+        voice.filter.ic1eq = ic1eq[lane];
+        voice.filter.ic2eq = ic2eq[lane];
+    }
+
+    // The math below is the same as Voice::render() + Filter::render() + Envelope::nextValue(),
+    // only split into an envelope pass and a filter pass so the oscillators can run in between,
+    // one voice at a time, for exactly as many samples as the envelope says the voice is alive.
+    //
+    // Careful when editing these: GCC gives up on vectorizing as soon as `active` is used in more
+    // than one ?: or lives in a bool array (it threads them back into branches). So each sample is
+    // computed for every lane unconditionally and then committed through a float gate.
+
+    // Amp envelope for sample_count samples. Fills env, gate and active_samples.
+    inline void renderEnvelopes(int sample_count) {
+        alignas(32) float new_level[LANES];
+        alignas(32) float new_multiplier[LANES];
+        alignas(32) float new_target[LANES];
+        alignas(32) float count[LANES] = {};
+
+        for (int sample = 0; sample < sample_count; ++sample) {
+            LANE_LOOP
+            for (int v = 0; v < LANES; ++v) {
+                const float g = (level[v] > SILENCE) ? 1.0f : 0.0f;
+                const float l = multiplier[v] * (level[v] - target[v]) + target[v];
+                const bool decaying = l + target[v] > 3.0f;
+                new_level[v] = l;
+                new_multiplier[v] = decaying ? decay_multiplier[v] : multiplier[v];
+                new_target[v] = decaying ? sustain_level[v] : target[v];
+
+                gate[sample][v] = g;
+                env[sample][v] = l;
+                count[v] += g;
+            }
+
+            // Blend through a mask so this doesn't need AVX masked stores to vectorize.
+            LANE_LOOP
+            for (int v = 0; v < LANES; ++v) {
+                const bool active = gate[sample][v] != 0.0f;
+                const float l = level[v], m = multiplier[v], t = target[v];
+                level[v] = active ? new_level[v] : l;
+                multiplier[v] = active ? new_multiplier[v] : m;
+                target[v] = active ? new_target[v] : t;
+            }
+        }
+
+        for (int v = 0; v < LANES; ++v) {
+            active_samples[v] = int(count[v]);
+        }
+    }
+
+    // Leaky integrator, noise and SVF for sample_count samples, using the oscillator output in
+    // osc1/osc2 and the envelope from renderEnvelopes(). Writes one row of output per lane.
+    // Without OSC2 osc2 isn't read (and doesn't have to be filled in), without NOISE neither is
+    // `noise`.
+    template <bool OSC2, bool NOISE>
+    inline void renderFilters(const float* noise, int sample_count) {
+        alignas(32) float new_saw[LANES];
+        alignas(32) float new_ic1eq[LANES];
+        alignas(32) float new_ic2eq[LANES];
+        alignas(32) float out[LANES];
+
+        for (int sample = 0; sample < sample_count; ++sample) {
+            LANE_LOOP
+            for (int v = 0; v < LANES; ++v) {
+                const float c1 = ic1eq[v];
+                const float c2 = ic2eq[v];
+
+                // 0.997f is the leaky integrator from Voice::render()
+                if constexpr (OSC2) {
+                    new_saw[v] = saw[v] * 0.997f + osc1[sample][v] - osc2[sample][v];
+                } else {
+                    new_saw[v] = saw[v] * 0.997f + osc1[sample][v];
+                }
+
+                float x = new_saw[v];
+                if constexpr (NOISE) {
+                    x += noise[sample];
+                }
+
+                float v3 = x - c2;
+                float v1 = a1[v] * c1 + a2[v] * v3;
+                float v2 = c2 + a2[v] * c1 + a3[v] * v3;
+                new_ic1eq[v] = 2.0f * v1 - c1;
+                new_ic2eq[v] = 2.0f * v2 - c2;
+
+                out[v] = gate[sample][v] * (v2 * env[sample][v]);
+            }
+
+            LANE_LOOP
+            for (int v = 0; v < LANES; ++v) {
+                const bool active = gate[sample][v] != 0.0f;
+                const float s = saw[v], c1 = ic1eq[v], c2 = ic2eq[v];
+                saw[v] = active ? new_saw[v] : s;
+                ic1eq[v] = active ? new_ic1eq[v] : c1;
+                ic2eq[v] = active ? new_ic2eq[v] : c2;
+            }
+
+            LANE_LOOP
+            for (int v = 0; v < LANES; ++v) {
+                output[v][sample] = out[v];
+            }
+        }
+    }
+};
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <bit>
+#include <cmath>
+#include <stdint.h>
+#include <vector>
+#include "Oscillator.h"
+
+// Band-limited impulse trains, one table per octave of period. Every table holds one cycle of
+//
+//     2 * (cos(x) + cos(2x) + ... + cos(Kx))
+//
+// i.e. the same impulse train the BLIT makes, minus its DC, with K picked so the top harmonic of
+// the shortest period in the octave stays below Nyquist. The tables are built once and only ever
+// read afterwards, so all voices of all plugin instances share them. They're built when the plugin
+// is loaded (~160 KB) so the audio thread never has to wait for them.
+class WavetableBank {
+    public:
+        static constexpr int TABLE_SIZE = 4096;
+        static constexpr int NUM_TABLES = 10;
+        static constexpr float MIN_PERIOD = 6.0f; // calcPeriod() never goes below this
+        static constexpr int MAX_HARMONICS = TABLE_SIZE / 4; // keeps linear interpolation clean
+
+        static const WavetableBank& get() { return instance; }
+
+        // Table for a period of `period` samples. Table n covers periods of
+        // MIN_PERIOD * 2^n up to MIN_PERIOD * 2^(n + 1), the last one everything above.
+        const float* tableFor(float period) const {
+            // floor(log2(period / MIN_PERIOD)) straight from the float exponent. Called from inside
+            // the oscillator loop, where a call to ilogb() would make the compiler spill registers.
+            const uint32_t bits = std::bit_cast<uint32_t>(period * (1.0f / MIN_PERIOD));
+            int octave = int((bits >> 23) & 0xFF) - 127;
+            octave = octave < 0 ? 0 : (octave >= NUM_TABLES ? NUM_TABLES - 1 : octave);
+            return tables_.data() + octave * (TABLE_SIZE + 1);
+        }
+
+    private:
+        static const WavetableBank instance;
+
+        // Each table has one extra sample (a copy of the first) so the interpolation never wraps.
+        std::vector<float> tables_;
+
+        WavetableBank() : tables_(size_t(NUM_TABLES * (TABLE_SIZE + 1))) {
+            for (int octave = 0; octave < NUM_TABLES; ++octave) {
+                const double shortest_period = double(MIN_PERIOD) * double(1 << octave);
+                int harmonics = int(shortest_period / 2.0);
+                if (harmonics > MAX_HARMONICS) { harmonics = MAX_HARMONICS; }
+
+                float* table = tables_.data() + octave * (TABLE_SIZE + 1);
+                for (int i = 0; i < TABLE_SIZE; ++i) {
+                    // Closed form of the cosine sum (Dirichlet kernel), 2K at the peak
+                    const double x = 3.14159265358979323846 * double(i) / double(TABLE_SIZE);
+                    const double s = std::sin(x);
+                    table[i] = (i == 0) ? float(2 * harmonics)
+                                        : float(std::sin(double(2 * harmonics + 1) * x) / s - 1.0);
+                }
+                table[TABLE_SIZE] = table[0];
+            }
+        }
+};
+
+inline const WavetableBank WavetableBank::instance;
+
+// Alternative to the BLIT in Oscillator. Same interface and roughly the same output (band-limited
+// pulses of height `amplitude` every `period * modulation` samples, without DC), but each sample is
+// one table read with linear interpolation instead of a sine resonator and a divide. The sin, cos
+// and floor in Oscillator at the start of each cycle become one table lookup.
+//
+// The phase is a 32-bit fixed point fraction of a cycle, so it wraps around by itself and the only
+// thing carried from one sample to the next is an integer add.
+class WavetableOscillator {
+    public:
+        float amplitude = 1.0f;
+        float period = 0.0f;
+        float modulation = 1.0f;
+
+        void reset() {
+            // One step short of a full cycle, so the next sample starts a new cycle at phase 0 like
+            // the BLIT starting with an impulse.
+            phase = 0xFFFFFFFFu;
+            phase_inc = RESET_INC;
+            gain = 0.0f;
+            table = WavetableBank::get().tableFor(WavetableBank::MIN_PERIOD);
+        }
+
+        float next_sample() {
+            const uint32_t previous = phase;
+            phase += phase_inc;
+
+            // Like the BLIT, period and modulation changes are only picked up at the start of a cycle.
+            if (phase < previous) {
+                startCycle(period * modulation);
+            }
+
+            const uint32_t index = phase >> FRACTION_BITS;
+            const float fraction = float(phase & FRACTION_MASK) * (1.0f / float(FRACTION_MASK + 1));
+            const float value = table[index] + fraction * (table[index + 1] - table[index]);
+
+            // The tables peak at 2K ~= period, dividing by the period brings the pulse back to `amplitude`.
+            return value * gain;
+        }
+
+        // Same as Oscillator::squareWave(): follow other_osc half a cycle behind, so subtracting
+        // the two and integrating gives a square wave instead of a saw.
+        void squareWave(const WavetableOscillator& other_osc, float new_period) {
+            reset();
+
+            if (other_osc.phase_inc != RESET_INC) {
+                phase = other_osc.phase + HALF_CYCLE;
+                phase_inc = other_osc.phase_inc;
+                gain = amplitude * float(phase_inc) * (1.0f / CYCLE);
+                table = other_osc.table;
+            } else {
+                // other_osc hasn't started yet and will be at phase 0 on its next sample.
+                startCycle(new_period);
+                phase = HALF_CYCLE - phase_inc;
+            }
+        }
+
+    private:
+        static constexpr int FRACTION_BITS = 32 - 12; // top 12 bits index the 4096 entry table
+        static constexpr uint32_t FRACTION_MASK = (1u << FRACTION_BITS) - 1;
+        static constexpr uint32_t HALF_CYCLE = 0x80000000u;
+        static constexpr float CYCLE = 4294967296.0f;
+        static constexpr uint32_t RESET_INC = 1; // only after reset(), no real period is that long
+        static_assert(WavetableBank::TABLE_SIZE == 1 << (32 - FRACTION_BITS), "table size doesn't match the phase");
+
+        uint32_t phase;
+        uint32_t phase_inc;
+        float gain; // amplitude / period for the current cycle
+        const float* table;
+
+        inline void startCycle(float cycle_period) {
+            phase_inc = uint32_t(CYCLE / cycle_period);
+            gain = amplitude / cycle_period;
+            table = WavetableBank::get().tableFor(cycle_period);
+        }
+};
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <stdint.h>
+#include <vector>
+
+#include <juce_audio_processors/juce_audio_processors.h>
+
+// Small pool of helper threads for the audio thread. The threads are started once, off the audio
+// thread, and then spin/back off waiting for work, so handing out a job never allocates, locks or
+// signals the OS.
+//
+// run() publishes `count` jobs and the calling thread takes part in rendering them. Jobs are
+// claimed one at a time from a shared counter: whichever thread is free grabs the next one, so a
+// worker that is late to wake up (or asleep) doesn't get a share in the first place. A worker that
+// is preempted between claiming a job and starting it would still hold up the block, so once the
+// audio thread has waited STEAL_SPINS it takes back every job that hasn't started and renders it
+// itself. Worst case that is every job, exactly like the serial path. What can't be taken back is
+// a job a worker is in the middle of: if the OS preempts a worker right then, run() waits for it.
+//
+// Only one thread (the audio thread) may call run() at a time.
+class WorkerPool {
+    public:
+        using Job = void (*)(void* context, int index);
+
+        WorkerPool();
+        ~WorkerPool();
+
+        // Not real-time safe, call from prepareToPlay / releaseResources.
+        void start(int num_threads);
+        void stop();
+
+        int size() const { return int(workers_.size()); }
+
+        // Runs job(context, 0) .. job(context, count - 1) and returns once all of them are done.
+        // Real-time safe.
+        void run(Job job, void* context, int count);
+
+        static constexpr int MAX_JOBS = 128;
+
+    private:
+        class Worker;
+
+        // The ticket packs the generation, the number of jobs and the next unclaimed job into one
+        // word so a worker can never claim a job from a batch that has already been retired.
+        static constexpr int GENERATION_SHIFT = 32;
+        static constexpr int COUNT_SHIFT = 16;
+        static constexpr uint64_t INDEX_MASK = 0xFFFF;
+
+        std::atomic<uint64_t> ticket_ { 0 };
+        std::atomic<int> remaining_ { 0 };
+        // open_[i] holds the generation job i was published in until someone takes it, then 0.
+        // Taking a job is a compare-exchange on this, so exactly one thread runs it: the worker
+        // that claimed it, or the audio thread taking it back.
+        std::array<std::atomic<uint32_t>, MAX_JOBS> open_ {};
+        Job job_ = nullptr;
+        void* context_ = nullptr;
+
+        std::vector<std::unique_ptr<Worker>> workers_;
+
+        // Claims and runs jobs until the batch in `ticket` runs out. Returns false if there was
+        // nothing left to claim.
+        bool runJobs(uint64_t ticket);
+        // Runs job `index` unless it has already been taken or belongs to another generation.
+        bool takeJob(int index, uint32_t generation);
+
+        static uint32_t generationOf(uint64_t ticket) { return uint32_t(ticket >> GENERATION_SHIFT); }
+
+        JUCE_DECLARE_NON_COPYABLE(WorkerPool)
+};
@@ -28,7 +28,14 @@ namespace audio_plugin {
     midi_learn_btn.addListener(this);
     addAndMakeVisible(midi_learn_btn);
 
+    load_label.setJustificationType(juce::Justification::centredLeft);
+    load_label.setFont(juce::Font(juce::FontOptions(12.0f)));
+    addAndMakeVisible(load_label);
+
     setSize(600, 400);
+
+    // Keeps the load readout going, and picks up the end of MIDI learn.
+    startTimerHz(10);
   }
 
   CX11SynthAudioProcessorEditor::~CX11SynthAudioProcessorEditor() {
@@ -62,21 +69,44 @@ namespace audio_plugin {
     poly_mode_button.setCentrePosition(r.withX(r.getRight()).getCentre());
 
     midi_learn_btn.setBounds(400, 20, 100, 30);
+
+    load_label.setBounds(getLocalBounds().removeFromBottom(24).reduced(8, 0));
   }
 
   void CX11SynthAudioProcessorEditor::buttonClicked(juce::Button* button) {
     button->setButtonText("Waiting...");
     button->setEnabled(false);
     audioProcessor.midi_learn = true;
-    startTimerHz(10);
   }
 
   void CX11SynthAudioProcessorEditor::timerCallback() {
-    if (!audioProcessor.midi_learn) {
-      stopTimer();
+    if (!midi_learn_btn.isEnabled() && !audioProcessor.midi_learn) {
       midi_learn_btn.setButtonText("MIDI Learn");
       midi_learn_btn.setEnabled(true);
     }
+
+    updateLoadLabel();
+  }
+
+  void CX11SynthAudioProcessorEditor::updateLoadLabel() {
+    const LoadMonitor::Stats stats = audioProcessor.load_monitor.getStats();
+
+    juce::String text = "CPU " + juce::String(juce::roundToInt(stats.average_load * 100.0f)) + "%"
+                      + "  peak " + juce::String(juce::roundToInt(stats.peak_load * 100.0f)) + "%"
+                      + "  dropouts " + juce::String(stats.deadline_misses);
+
+    // The most recent close call, and whether it came with a burst of notes or a preset change.
+    if (stats.num_spikes > 0) {
+      const LoadMonitor::Spike& spike = stats.spikes[0];
+      text << "  last spike " << juce::roundToInt(spike.load * 100.0f) << "% with " << spike.note_ons << " note-ons";
+      if (spike.flags & LoadMonitor::PROGRAM_CHANGED) {
+        text << ", program change";
+      } else if (spike.flags & LoadMonitor::PARAMETERS_CHANGED) {
+        text << ", parameter change";
+      }
+    }
+
+    load_label.setText(text, juce::dontSendNotification);
   }
 
 }  // namespace audio_plugin
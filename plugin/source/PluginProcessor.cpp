@@ -1,14 +1,18 @@
 #include "CX11Synth/PluginProcessor.h"
 #include "CX11Synth/PluginEditor.h"
+#include "CX11Synth/Profiler.h"
 #include "CX11Synth/Utils.h"
 
-#include <iostream> // for debug
-
 namespace audio_plugin {
 
 static const juce::Identifier plugin_tag = "PLUGIN";
 static const juce::Identifier extra_tag = "EXTRA";
 static const juce::Identifier midi_cc_attribute = "midCC";
+static const juce::Identifier preset_bank_attribute = "presetBank";
+
+// First bytes of the binary state, see getStateInformation().
+static const char state_magic[4] = { 'C', 'X', '1', 'S' };
+static const int state_version = 3;
 
 CX11SynthAudioProcessor::CX11SynthAudioProcessor()
     : AudioProcessor(
@@ -46,14 +50,31 @@ CX11SynthAudioProcessor::CX11SynthAudioProcessor()
   castParameter(apvts, ParameterId::tuning, tuning_param);
   castParameter(apvts, ParameterId::output_level, output_level_param);
   castParameter(apvts, ParameterId::poly_mode, poly_mode_param);
+  castParameter(apvts, ParameterId::osc_engine, osc_engine_param);
+  castParameter(apvts, ParameterId::morph, morph_param);
+
+  // The morph parameter is read by the audio thread directly, it has nothing to update.
+  static_assert(NUM_PARAMS <= 32, "one dirty bit per parameter");
+  for (auto* param : presetParameters()) {
+    param->addListener(this);
+  }
 
-  apvts.state.addListener(this);
-  createPrograms();
   setCurrentProgram(0);
+
+  // Picks up parameter changes, see updateParameters().
+  startTimerHz(100);
 }
 
 CX11SynthAudioProcessor::~CX11SynthAudioProcessor() {
-  apvts.state.removeListener(this);
+  stopTimer();
+
+  for (auto* param : presetParameters()) {
+    param->removeListener(this);
+  }
+
+  if (presetLibrary != nullptr) {
+    presetLibrary->removeChangeListener(this);
+  }
 }
 
 const juce::String CX11SynthAudioProcessor::getName() const {
@@ -92,16 +113,15 @@ int CX11SynthAudioProcessor::getNumPrograms() {
   // return 1;  // NB: some hosts don't cope very well if you tell them there are 0
   //            // programs, so this should be at least 1, even if you're not
   //            // really implementing programs.
-  return int(presets.size());
+  return usesLibrary() ? libraryPrograms->size() : presetBank->size();
 }
 
 int CX11SynthAudioProcessor::getCurrentProgram() {
   return currentProgram;
 }
 
-void CX11SynthAudioProcessor::setCurrentProgram(int index) {
-  currentProgram = index;
-  juce::RangedAudioParameter *params[NUM_PARAMS] = {
+std::array<juce::RangedAudioParameter*, NUM_PARAMS> CX11SynthAudioProcessor::presetParameters() const {
+  return {
     osc_mix_param,
     osc_tune_param,
     osc_fine_param,
@@ -128,79 +148,112 @@ void CX11SynthAudioProcessor::setCurrentProgram(int index) {
     tuning_param,
     output_level_param,
     poly_mode_param,
+    osc_engine_param,
   };
+}
+
+void CX11SynthAudioProcessor::setCurrentProgram(int index) {
+  Preset preset;
+  if (!usesLibrary()) {
+    preset = presetBank->preset(index);
+  } else if (juce::String error; !libraryPrograms->load(index, preset, error)) {
+    CX11_LOG("Can't load program %d: %s", index, error.toRawUTF8());
+    return;
+  }
 
-  const Preset& preset = presets[index];
+  currentProgram = index;
+  const auto params = presetParameters();
 
   for (int i = 0; i < NUM_PARAMS; ++i) {
     // JUCE uses values 0.0..1.0 for all parameters, so convert the parameters to those values.
-    params[i]->setValueNotifyingHost(params[i]->convertTo0to1(preset.param[i]));
+    params[size_t(i)]->setValueNotifyingHost(params[size_t(i)]->convertTo0to1(preset.param[i]));
   }
 
-  // Tell synth to stop playing. If any notes are playing, sudden changes in the params
+  // The synth has to stop playing before it gets the new settings: sudden changes in the params
   // can cause invalid states in features like filters which can cause poles to be nan/infinity.
-  reset();
+  // The bumped count tells the audio thread to do that, see beginProgramChange().
+  {
+    const juce::SpinLock::ScopedLockType lock(parameterLock);
+    ++synthParameters.program_changes;
+  }
+  dirtyParameters.store(ALL_PARAMETERS);
+  updateParameters();
+}
+
+void CX11SynthAudioProcessor::applyPendingProgram() {
+  // The count before the program, see holdingNotes().
+  const uint32_t requests = programRequests.load();
+  const int program = pendingProgram.exchange(-1);
+  if (program >= 0 && program < getNumPrograms()) {
+    setCurrentProgram(program);
+  }
+  handledProgramRequests.store(requests);
+}
+
+bool CX11SynthAudioProcessor::loadPresetBank(const juce::File& file, juce::String& error) {
+  std::shared_ptr<const PresetBank> bank = PresetBank::open(file, error);
+  if (bank == nullptr) {
+    return false;
+  }
+  if (bank->size() == 0) {
+    error = file.getFullPathName() + " has no presets";
+    return false;
+  }
+
+  // The sound stays as it is until a program is picked from the new bank.
+  presetBank = std::move(bank);
+  currentProgram = 0;
+  updateHostDisplay(ChangeDetails().withProgramChanged(true));
+  return true;
 }
 
-void CX11SynthAudioProcessor::createPrograms()
-{
-    presets.emplace_back("Init", 0.00f, -12.00f, 0.00f, 0.00f, 35.00f, 0.00f, 100.00f, 15.00f, 50.00f, 0.00f, 0.00f, 0.00f, 30.00f, 0.00f, 25.00f, 0.00f, 50.00f, 100.00f, 30.00f, 0.81f, 0.00f, 0.00f, 0.00f, 0.00f, 0.00f, 1.00f);
-    presets.emplace_back("5th Sweep Pad", 100.00f, -7.00f, -6.30f, 1.00f, 32.00f, 0.00f, 90.00f, 60.00f, -76.00f, 0.00f, 0.00f, 90.00f, 89.00f, 90.00f, 73.00f, 0.00f, 50.00f, 100.00f, 71.00f, 0.81f, 30.00f, 0.00f, 0.00f, 0.00f, 0.00f, 1.00f);
-    presets.emplace_back("Echo Pad [SA]", 88.00f, 0.00f, 0.00f, 0.00f, 49.00f, 0.00f, 46.00f, 76.00f, 38.00f, 10.00f, 38.00f, 100.00f, 86.00f, 76.00f, 57.00f, 30.00f, 80.00f, 68.00f, 66.00f, 0.79f, -74.00f, 25.00f, 0.00f, 0.00f, 0.00f, 1.00f);
-    presets.emplace_back("Space Chimes [SA]", 88.00f, 0.00f, 0.00f, 0.00f, 49.00f, 0.00f, 49.00f, 82.00f, 32.00f, 8.00f, 78.00f, 85.00f, 69.00f, 76.00f, 47.00f, 12.00f, 22.00f, 55.00f, 66.00f, 0.89f, -32.00f, 0.00f, 2.00f, 0.00f, 0.00f, 1.00f);
-    presets.emplace_back("Solid Backing", 100.00f, -12.00f, -18.70f, 0.00f, 35.00f, 0.00f, 30.00f, 25.00f, 40.00f, 0.00f, 26.00f, 0.00f, 35.00f, 0.00f, 25.00f, 0.00f, 50.00f, 100.00f, 30.00f, 0.81f, 0.00f, 50.00f, 0.00f, 0.00f, 0.00f, 1.00f);
-    presets.emplace_back("Velocity Backing [SA]", 41.00f, 0.00f, 9.70f, 0.00f, 8.00f, -1.68f, 49.00f, 1.00f, -32.00f, 0.00f, 86.00f, 61.00f, 87.00f, 100.00f, 93.00f, 11.00f, 48.00f, 98.00f, 32.00f, 0.81f, 0.00f, 0.00f, 0.00f, 0.00f, 0.00f, 1.00f);
-    presets.emplace_back("Rubber Backing [ZF]", 29.00f, 12.00f, -5.60f, 0.00f, 18.00f, 5.06f, 35.00f, 15.00f, 54.00f, 14.00f, 8.00f, 0.00f, 42.00f, 13.00f, 21.00f, 0.00f, 56.00f, 0.00f, 32.00f, 0.20f, 16.00f, 22.00f, 0.00f, 0.00f, 0.00f, 1.00f);
-    presets.emplace_back("808 State Lead", 100.00f, 7.00f, -7.10f, 2.00f, 34.00f, 12.35f, 65.00f, 63.00f, 50.00f, 16.00f, 0.00f, 0.00f, 30.00f, 0.00f, 25.00f, 17.00f, 50.00f, 100.00f, 3.00f, 0.81f, 0.00f, 0.00f, 1.00f, 0.00f, 0.00f, 1.00f);
-    presets.emplace_back("Mono Glide", 0.00f, -12.00f, 0.00f, 2.00f, 46.00f, 0.00f, 51.00f, 0.00f, 0.00f, 0.00f, -100.00f, 0.00f, 30.00f, 0.00f, 25.00f, 37.00f, 50.00f, 100.00f, 38.00f, 0.81f, 24.00f, 0.00f, 0.00f, 0.00f, 0.00f, 0.00f);
-    presets.emplace_back("Detuned Techno Lead", 84.00f, 0.00f, -17.20f, 2.00f, 41.00f, -0.15f, 54.00f, 1.00f, 16.00f, 21.00f, 34.00f, 0.00f, 9.00f, 100.00f, 25.00f, 20.00f, 85.00f, 100.00f, 30.00f, 0.83f, -82.00f, 40.00f, 0.00f, 0.00f, 0.00f, 1.00f);
-    presets.emplace_back("Hard Lead [SA]", 71.00f, 12.00f, 0.00f, 0.00f, 24.00f, 36.00f, 56.00f, 52.00f, 38.00f, 19.00f, 40.00f, 100.00f, 14.00f, 65.00f, 95.00f, 7.00f, 91.00f, 100.00f, 15.00f, 0.84f, -34.00f, 0.00f, 0.00f, 0.00f, 0.00f, 1.00f);
-    presets.emplace_back("Bubble", 0.00f, -12.00f, -0.20f, 0.00f, 71.00f, -0.00f, 23.00f, 77.00f, 60.00f, 32.00f, 26.00f, 40.00f, 18.00f, 66.00f, 14.00f, 0.00f, 38.00f, 65.00f, 16.00f, 0.48f, 0.00f, 0.00f, 1.00f, 0.00f, 0.00f, 1.00f);
-    presets.emplace_back("Monosynth", 62.00f, -12.00f, 0.00f, 1.00f, 35.00f, 0.02f, 64.00f, 39.00f, 2.00f, 65.00f, -100.00f, 7.00f, 52.00f, 24.00f, 84.00f, 13.00f, 30.00f, 76.00f, 21.00f, 0.58f, -40.00f, 0.00f, -1.00f, 0.00f, 0.00f, 0.00f);
-    presets.emplace_back("Moogcury Lite", 81.00f, 24.00f, -9.80f, 1.00f, 15.00f, -0.97f, 39.00f, 17.00f, 38.00f, 40.00f, 24.00f, 0.00f, 47.00f, 19.00f, 37.00f, 0.00f, 50.00f, 20.00f, 33.00f, 0.38f, 6.00f, 0.00f, -2.00f, 0.00f, 0.00f, 0.00f);
-    presets.emplace_back("Gangsta Whine", 0.00f, 0.00f, 0.00f, 2.00f, 44.00f, 0.00f, 41.00f, 46.00f, 0.00f, 0.00f, -100.00f, 0.00f, 0.00f, 100.00f, 25.00f, 15.00f, 50.00f, 100.00f, 32.00f, 0.81f, -2.00f, 0.00f, 2.00f, 0.00f, 0.00f, 0.00f);
-    presets.emplace_back("Higher Synth [ZF]", 48.00f, 0.00f, -8.80f, 0.00f, 0.00f, 0.00f, 50.00f, 47.00f, 46.00f, 30.00f, 60.00f, 0.00f, 10.00f, 0.00f, 7.00f, 0.00f, 42.00f, 0.00f, 22.00f, 0.21f, 18.00f, 16.00f, 2.00f, 0.00f, 0.00f, 1.00f);
-    presets.emplace_back("303 Saw Bass", 0.00f, 0.00f, 0.00f, 1.00f, 49.00f, 0.00f, 55.00f, 75.00f, 38.00f, 35.00f, 0.00f, 0.00f, 56.00f, 0.00f, 56.00f, 0.00f, 80.00f, 100.00f, 24.00f, 0.26f, -2.00f, 0.00f, -2.00f, 0.00f, 0.00f, 0.00f);
-    presets.emplace_back("303 Square Bass", 75.00f, 0.00f, 0.00f, 1.00f, 49.00f, 0.00f, 55.00f, 75.00f, 38.00f, 35.00f, 0.00f, 14.00f, 49.00f, 0.00f, 39.00f, 0.00f, 80.00f, 100.00f, 24.00f, 0.26f, -2.00f, 0.00f, -2.00f, 0.00f, 0.00f, 0.00f);
-    presets.emplace_back("Analog Bass", 100.00f, -12.00f, -10.90f, 1.00f, 19.00f, 0.00f, 30.00f, 51.00f, 70.00f, 9.00f, -100.00f, 0.00f, 88.00f, 0.00f, 21.00f, 0.00f, 50.00f, 100.00f, 46.00f, 0.81f, 0.00f, 0.00f, -1.00f, 0.00f, 0.00f, 0.00f);
-    presets.emplace_back("Analog Bass 2", 100.00f, -12.00f, -10.90f, 0.00f, 19.00f, 13.44f, 48.00f, 43.00f, 88.00f, 0.00f, 60.00f, 0.00f, 0.00f, 0.00f, 0.00f, 0.00f, 61.00f, 100.00f, 32.00f, 0.81f, 0.00f, 0.00f, -1.00f, 0.00f, 0.00f, 0.00f);
-    presets.emplace_back("Low Pulses", 97.00f, -12.00f, -3.30f, 0.00f, 35.00f, 0.00f, 80.00f, 40.00f, 4.00f, 0.00f, 0.00f, 0.00f, 77.00f, 0.00f, 25.00f, 0.00f, 50.00f, 100.00f, 30.00f, 0.81f, -68.00f, 0.00f, -2.00f, 0.00f, 0.00f, 1.00f);
-    presets.emplace_back("Sine Infra-Bass", 0.00f, -12.00f, 0.00f, 0.00f, 35.00f, 0.00f, 33.00f, 76.00f, 6.00f, 0.00f, 0.00f, 0.00f, 30.00f, 0.00f, 25.00f, 0.00f, 55.00f, 25.00f, 30.00f, 0.81f, 4.00f, 0.00f, -2.00f, 0.00f, 0.00f, 0.00f);
-    presets.emplace_back("Wobble Bass [SA]", 100.00f, -12.00f, -8.80f, 0.00f, 82.00f, 0.21f, 72.00f, 47.00f, -32.00f, 34.00f, 64.00f, 20.00f, 69.00f, 100.00f, 15.00f, 9.00f, 50.00f, 100.00f, 7.00f, 0.81f, -8.00f, 0.00f, -1.00f, 0.00f, 0.00f, 0.00f);
-    presets.emplace_back("Squelch Bass", 100.00f, -12.00f, -8.80f, 0.00f, 35.00f, 0.00f, 67.00f, 70.00f, -48.00f, 0.00f, 0.00f, 48.00f, 69.00f, 100.00f, 15.00f, 0.00f, 50.00f, 100.00f, 7.00f, 0.81f, -8.00f, 0.00f, -1.00f, 0.00f, 0.00f, 0.00f);
-    presets.emplace_back("Rubber Bass [ZF]", 49.00f, -12.00f, 1.60f, 1.00f, 35.00f, 0.00f, 36.00f, 15.00f, 50.00f, 20.00f, 0.00f, 0.00f, 38.00f, 0.00f, 25.00f, 0.00f, 60.00f, 100.00f, 22.00f, 0.19f, 0.00f, 0.00f, -2.00f, 0.00f, 0.00f, 0.00f);
-    presets.emplace_back("Soft Pick Bass", 37.00f, 0.00f, 7.80f, 0.00f, 22.00f, 0.00f, 33.00f, 47.00f, 42.00f, 16.00f, 18.00f, 0.00f, 0.00f, 0.00f, 25.00f, 4.00f, 58.00f, 0.00f, 22.00f, 0.15f, -12.00f, 33.00f, -2.00f, 0.00f, 0.00f, 0.00f);
-    presets.emplace_back("Fretless Bass", 50.00f, 0.00f, -14.40f, 1.00f, 34.00f, 0.00f, 51.00f, 0.00f, 16.00f, 0.00f, 34.00f, 0.00f, 9.00f, 0.00f, 25.00f, 20.00f, 85.00f, 0.00f, 30.00f, 0.81f, 40.00f, 0.00f, -2.00f, 0.00f, 0.00f, 0.00f);
-    presets.emplace_back("Whistler", 23.00f, 0.00f, -0.70f, 0.00f, 35.00f, 0.00f, 33.00f, 100.00f, 0.00f, 0.00f, 0.00f, 0.00f, 29.00f, 0.00f, 25.00f, 68.00f, 39.00f, 58.00f, 36.00f, 0.81f, 28.00f, 38.00f, 2.00f, 0.00f, 0.00f, 1.00f);
-    presets.emplace_back("Very Soft Pad", 39.00f, 0.00f, -4.90f, 2.00f, 12.00f, 0.00f, 35.00f, 78.00f, 0.00f, 0.00f, 0.00f, 0.00f, 30.00f, 0.00f, 25.00f, 35.00f, 50.00f, 80.00f, 70.00f, 0.81f, 0.00f, 0.00f, 0.00f, 0.00f, 0.00f, 1.00f);
-    presets.emplace_back("Pizzicato", 0.00f, -12.00f, 0.00f, 0.00f, 35.00f, 0.00f, 23.00f, 20.00f, 50.00f, 0.00f, 0.00f, 0.00f, 22.00f, 0.00f, 25.00f, 0.00f, 47.00f, 0.00f, 30.00f, 0.81f, 0.00f, 80.00f, 0.00f, 0.00f, 0.00f, 1.00f);
-    presets.emplace_back("Synth Strings", 100.00f, 0.00f, -7.10f, 0.00f, 0.00f, -0.97f, 42.00f, 26.00f, 50.00f, 14.00f, 38.00f, 0.00f, 67.00f, 55.00f, 97.00f, 82.00f, 70.00f, 100.00f, 42.00f, 0.84f, 34.00f, 30.00f, 0.00f, 0.00f, 0.00f, 1.00f);
-    presets.emplace_back("Synth Strings 2", 75.00f, 0.00f, -3.80f, 0.00f, 49.00f, 0.00f, 55.00f, 16.00f, 38.00f, 8.00f, -60.00f, 76.00f, 29.00f, 76.00f, 100.00f, 46.00f, 80.00f, 100.00f, 39.00f, 0.79f, -46.00f, 0.00f, 1.00f, 0.00f, 0.00f, 1.00f);
-    presets.emplace_back("Leslie Organ", 0.00f, 0.00f, 0.00f, 0.00f, 13.00f, -0.38f, 38.00f, 74.00f, 8.00f, 20.00f, -100.00f, 0.00f, 55.00f, 52.00f, 31.00f, 0.00f, 17.00f, 73.00f, 28.00f, 0.87f, -52.00f, 0.00f, -1.00f, 0.00f, 0.00f, 1.00f);
-    presets.emplace_back("Click Organ", 50.00f, 12.00f, 0.00f, 0.00f, 35.00f, 0.00f, 44.00f, 50.00f, 30.00f, 16.00f, -100.00f, 0.00f, 0.00f, 18.00f, 0.00f, 0.00f, 75.00f, 80.00f, 0.00f, 0.81f, -2.00f, 0.00f, 0.00f, 0.00f, 0.00f, 1.00f);
-    presets.emplace_back("Hard Organ", 89.00f, 19.00f, -0.90f, 0.00f, 35.00f, 0.00f, 51.00f, 62.00f, 8.00f, 0.00f, -100.00f, 0.00f, 37.00f, 0.00f, 100.00f, 4.00f, 8.00f, 72.00f, 4.00f, 0.77f, -2.00f, 0.00f, 0.00f, 0.00f, 0.00f, 1.00f);
-    presets.emplace_back("Bass Clarinet", 100.00f, 0.00f, 0.00f, 1.00f, 0.00f, 0.00f, 51.00f, 10.00f, 0.00f, 11.00f, 0.00f, 0.00f, 0.00f, 0.00f, 25.00f, 35.00f, 65.00f, 65.00f, 32.00f, 0.79f, -2.00f, 20.00f, -1.00f, 0.00f, 0.00f, 1.00f);
-    presets.emplace_back("Trumpet", 0.00f, 0.00f, 0.00f, 1.00f, 6.00f, 0.00f, 57.00f, 0.00f, -36.00f, 15.00f, 0.00f, 21.00f, 15.00f, 0.00f, 25.00f, 24.00f, 60.00f, 80.00f, 10.00f, 0.75f, 10.00f, 25.00f, 1.00f, 0.00f, 0.00f, 0.00f);
-    presets.emplace_back("Soft Horn", 12.00f, 19.00f, 1.90f, 0.00f, 35.00f, 0.00f, 50.00f, 21.00f, -42.00f, 12.00f, 20.00f, 0.00f, 35.00f, 36.00f, 25.00f, 8.00f, 50.00f, 100.00f, 27.00f, 0.83f, 2.00f, 10.00f, -1.00f, 0.00f, 0.00f, 1.00f);
-    presets.emplace_back("Brass Section", 43.00f, 12.00f, -7.90f, 0.00f, 28.00f, -0.79f, 50.00f, 0.00f, 18.00f, 0.00f, 0.00f, 24.00f, 16.00f, 91.00f, 8.00f, 17.00f, 50.00f, 80.00f, 45.00f, 0.81f, 0.00f, 0.00f, 0.00f, 0.00f, 0.00f, 1.00f);
-    presets.emplace_back("Synth Brass", 40.00f, 0.00f, -6.30f, 0.00f, 30.00f, -3.07f, 39.00f, 15.00f, 50.00f, 0.00f, 0.00f, 39.00f, 30.00f, 82.00f, 25.00f, 33.00f, 74.00f, 76.00f, 41.00f, 0.81f, -6.00f, 23.00f, 0.00f, 0.00f, 0.00f, 1.00f);
-    presets.emplace_back("Detuned Syn Brass [ZF]", 68.00f, 0.00f, 31.80f, 0.00f, 31.00f, 0.50f, 26.00f, 7.00f, 70.00f, 0.00f, 32.00f, 0.00f, 83.00f, 0.00f, 5.00f, 0.00f, 75.00f, 54.00f, 32.00f, 0.76f, -26.00f, 29.00f, 0.00f, 0.00f, 0.00f, 1.00f);
-    presets.emplace_back("Power PWM", 100.00f, -12.00f, -8.80f, 0.00f, 35.00f, 0.00f, 82.00f, 13.00f, 50.00f, 0.00f, -100.00f, 24.00f, 30.00f, 88.00f, 34.00f, 0.00f, 50.00f, 100.00f, 48.00f, 0.71f, -26.00f, 0.00f, -1.00f, 0.00f, 0.00f, 1.00f);
-    presets.emplace_back("Water Velocity [SA]", 76.00f, 0.00f, -1.40f, 0.00f, 49.00f, 0.00f, 87.00f, 67.00f, 100.00f, 32.00f, -82.00f, 95.00f, 56.00f, 72.00f, 100.00f, 4.00f, 76.00f, 11.00f, 46.00f, 0.88f, 44.00f, 0.00f, -1.00f, 0.00f, 0.00f, 1.00f);
-    presets.emplace_back("Ghost [SA]", 75.00f, 0.00f, -7.10f, 2.00f, 16.00f, -0.00f, 38.00f, 58.00f, 50.00f, 16.00f, 62.00f, 0.00f, 30.00f, 40.00f, 31.00f, 37.00f, 50.00f, 100.00f, 54.00f, 0.85f, 66.00f, 43.00f, 0.00f, 0.00f, 0.00f, 1.00f);
-    presets.emplace_back("Soft E.Piano", 31.00f, 0.00f, -0.20f, 0.00f, 35.00f, 0.00f, 34.00f, 26.00f, 6.00f, 0.00f, 26.00f, 0.00f, 22.00f, 0.00f, 39.00f, 0.00f, 80.00f, 0.00f, 44.00f, 0.81f, 2.00f, 0.00f, 0.00f, 0.00f, 0.00f, 1.00f);
-    presets.emplace_back("Thumb Piano", 72.00f, 15.00f, 50.00f, 0.00f, 35.00f, 0.00f, 37.00f, 47.00f, 8.00f, 0.00f, 0.00f, 0.00f, 45.00f, 0.00f, 39.00f, 0.00f, 39.00f, 0.00f, 48.00f, 0.81f, 20.00f, 0.00f, 1.00f, 0.00f, 0.00f, 1.00f);
-    presets.emplace_back("Steel Drums [ZF]", 81.00f, 12.00f, -12.00f, 0.00f, 18.00f, 2.30f, 40.00f, 30.00f, 8.00f, 17.00f, -20.00f, 0.00f, 42.00f, 23.00f, 47.00f, 12.00f, 48.00f, 0.00f, 49.00f, 0.53f, -28.00f, 34.00f, 0.00f, 0.00f, 0.00f, 1.00f);
-    presets.emplace_back("Car Horn", 57.00f, -1.00f, -2.80f, 0.00f, 35.00f, 0.00f, 46.00f, 0.00f, 36.00f, 0.00f, 0.00f, 46.00f, 30.00f, 100.00f, 23.00f, 30.00f, 50.00f, 100.00f, 31.00f, 1.00f, -24.00f, 0.00f, 0.00f, 0.00f, 0.00f, 1.00f);
-    presets.emplace_back("Helicopter", 0.00f, -12.00f, 0.00f, 0.00f, 35.00f, 0.00f, 8.00f, 36.00f, 38.00f, 100.00f, 0.00f, 100.00f, 100.00f, 0.00f, 100.00f, 96.00f, 50.00f, 100.00f, 92.00f, 0.97f, 0.00f, 100.00f, -2.00f, 0.00f, 0.00f, 1.00f);
-    presets.emplace_back("Arctic Wind", 0.00f, -12.00f, 0.00f, 0.00f, 35.00f, 0.00f, 16.00f, 85.00f, 0.00f, 28.00f, 0.00f, 37.00f, 30.00f, 0.00f, 25.00f, 89.00f, 50.00f, 100.00f, 89.00f, 0.24f, 0.00f, 100.00f, 2.00f, 0.00f, 0.00f, 1.00f);
-    presets.emplace_back("Thip", 100.00f, -7.00f, 0.00f, 0.00f, 35.00f, 0.00f, 0.00f, 100.00f, 94.00f, 0.00f, 0.00f, 2.00f, 20.00f, 0.00f, 20.00f, 0.00f, 46.00f, 0.00f, 30.00f, 0.81f, 0.00f, 78.00f, 0.00f, 0.00f, 0.00f, 1.00f);
-    presets.emplace_back("Synth Tom", 0.00f, -12.00f, 0.00f, 0.00f, 76.00f, 24.53f, 30.00f, 33.00f, 52.00f, 0.00f, 36.00f, 0.00f, 59.00f, 0.00f, 59.00f, 10.00f, 50.00f, 0.00f, 50.00f, 0.81f, 0.00f, 70.00f, -2.00f, 0.00f, 0.00f, 1.00f);
-    presets.emplace_back("Squelchy Frog", 50.00f, -5.00f, -7.90f, 2.00f, 77.00f, -36.00f, 40.00f, 65.00f, 90.00f, 0.00f, 0.00f, 33.00f, 50.00f, 0.00f, 25.00f, 0.00f, 70.00f, 65.00f, 18.00f, 0.32f, 100.00f, 0.00f, -2.00f, 0.00f, 0.00f, 1.00f);
+void CX11SynthAudioProcessor::usePresetLibrary(std::shared_ptr<PresetLibrary> library) {
+  if (presetLibrary != nullptr) {
+    presetLibrary->removeChangeListener(this);
+  }
+
+  presetLibrary = std::move(library);
+  if (presetLibrary != nullptr) {
+    presetLibrary->addChangeListener(this);
+  }
+  changeListenerCallback(nullptr);
+}
+
+void CX11SynthAudioProcessor::setMorphPresets(const std::vector<Preset>& presets) {
+  morphPresets.assign(presets.begin(), presets.begin() + std::min(int(presets.size()), PresetMorph::MAX_PRESETS));
+  if (morphPresets.size() < 2) {
+    morphPresets.clear();
+  }
+
+  PresetMorph& next = morphSnapshot.writeSlot();
+  next.setPresets(morphPresets.data(), int(morphPresets.size()));
+  {
+    const juce::SpinLock::ScopedLockType lock(parameterLock);
+    next.prepare(parameterSampleRate);
+  }
+  morphSnapshot.publish();
+
+  // Published after the morph, so the audio thread can't pick up the parameters while the
+  // morph is still playing and then drop them.
+  if (morphPresets.empty()) {
+    dirtyParameters.store(ALL_PARAMETERS);
+    updateParameters();
+  }
+}
+
+void CX11SynthAudioProcessor::changeListenerCallback(juce::ChangeBroadcaster*) {
+  // The host sees the library as it was at the last scan until the next one is done.
+  libraryPrograms = presetLibrary != nullptr ? presetLibrary->snapshot() : nullptr;
+  currentProgram = std::clamp(currentProgram, 0, getNumPrograms() - 1);
+  updateHostDisplay(ChangeDetails().withProgramChanged(true));
+}
+
+bool CX11SynthAudioProcessor::usesLibrary() const {
+  return libraryPrograms != nullptr && libraryPrograms->size() > 0;
 }
 
 const juce::String CX11SynthAudioProcessor::getProgramName(int index) {
-  return { presets[index].name };
+  return usesLibrary() ? (*libraryPrograms)[index].name : presetBank->name(index);
 }
 
 void CX11SynthAudioProcessor::changeProgramName(int index, const juce::String& newName) {
@@ -208,9 +261,27 @@ void CX11SynthAudioProcessor::changeProgramName(int index, const juce::String& n
 }
 
 void CX11SynthAudioProcessor::prepareToPlay(double sampleRate, int samplesPerBlock) {
+  synth.voice_capacity = polyphony;
+  synth.render_threads = render_threads;
   synth.allocate_resources(sampleRate, samplesPerBlock);
-  parametersChanged.store(true); // force update the first time process block is called so the state is initialized.
+
+  // Everything depends on the sample rate or the voice count, work it all out again before the
+  // first block.
+  {
+    const juce::SpinLock::ScopedLockType lock(parameterLock);
+    parameterSampleRate = float(sampleRate);
+  }
+  dirtyParameters.store(ALL_PARAMETERS);
+  updateParameters();
+
+  morphRamp.prepare(ParameterRamp::LINEAR, juce::roundToInt(morph_glide_seconds * sampleRate / MORPH_STEP));
+  if (morphing()) {
+    morph.prepare(float(sampleRate));
+  }
   reset();
+
+  programFadeSamples = juce::roundToInt(program_fade_seconds * sampleRate);
+  load_monitor.reset();
 }
 
 void CX11SynthAudioProcessor::releaseResources() {
@@ -221,7 +292,19 @@ void CX11SynthAudioProcessor::reset() {
   midi_learn = false;
   midi_learn_cc = synth.reso_cc;
   synth.reset();
+  if (programPending) {
+    // No need to fade, nothing's playing any more.
+    programParameters.applyTo(synth);
+    programPending = false;
+  }
+  numHeldNotes = 0;
   synth.output_level_smoother.setCurrentAndTargetValue(juce::Decibels::decibelsToGain(output_level_param->get()));
+
+  if (morphing()) {
+    morphRamp.jump(morphTarget());
+    applyMorph();
+    synth.output_level_smoother.setCurrentAndTargetValue(synth.output_level_smoother.getTargetValue());
+  }
 }
 
 bool CX11SynthAudioProcessor::isBusesLayoutSupported(
@@ -251,6 +334,8 @@ bool CX11SynthAudioProcessor::isBusesLayoutSupported(
 void CX11SynthAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages) {
   //juce::ignoreUnused(midiMessages);
   juce::ScopedNoDenormals noDenormals;
+  const auto blockStart = LoadMonitor::beginBlock();
+  uint32_t blockFlags = 0;
 
   auto totalNumInputChannels = getTotalNumInputChannels();
   auto totalNumOutputChannels = getTotalNumOutputChannels();
@@ -261,157 +346,258 @@ void CX11SynthAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer, juc
 
   synth.reso_cc = midi_learn_cc;
 
-  bool expected = true;
-  if (isNonRealtime() || parametersChanged.compare_exchange_strong(expected, false)) {
-    update();
+  // Offline renders can run blocks much faster than the timer fires, keep up with automation there.
+  if (isNonRealtime()) {
+    applyPendingProgram();
+    updateParameters();
+  }
+
+  // Before the snapshot: a program the timer has handled is in the snapshot it published
+  // before, see holdingNotes().
+  handledRequests = handledProgramRequests.load();
+
+  // Before the parameters, see setMorphPresets().
+  if (const PresetMorph* next = morphSnapshot.read()) {
+    startMorph(*next);
+    blockFlags |= LoadMonitor::PARAMETERS_CHANGED;
+  }
+
+  if (const SynthParameters* parameters = parameterSnapshot.read()) {
+    if (programPending || parameters->program_changes != appliedProgramChanges) {
+      beginProgramChange(*parameters);
+    } else if (!morphing()) {
+      parameters->applyTo(synth);
+    }
+    blockFlags |= LoadMonitor::PARAMETERS_CHANGED;
   }
 
-  splitBufferByEvents(buffer, midiMessages);
+  if (morphing()) {
+    morphRamp.setTarget(morphTarget());
+  }
+
+  if (programPending && (programFadeRemaining == 0 || synth.isSilent())) {
+    switchProgram();
+    blockFlags |= LoadMonitor::PROGRAM_CHANGED;
+  }
+
+  if (numHeldNotes > 0 && !holdingNotes()) {
+    releaseHeldNotes();
+  }
+
+  // Nothing playing and no notes coming in: skip the synth entirely and hand the host a buffer
+  // that's flagged as clear.
+  if (synth.isSilent() && midiMessages.isEmpty()) {
+    if (morphRamp.isMoving()) {
+      morphRamp.jump(morphRamp.getTarget());
+      applyMorph();
+    }
+    synth.skip(buffer.getNumSamples());
+    buffer.clear();
+    load_monitor.endBlock(blockStart, buffer.getNumSamples(), getSampleRate(), 0, blockFlags);
+    return;
+  }
+
+  const int noteOns = renderWithEvents(buffer, midiMessages);
+  if (programPending) {
+    fadeOutProgram(buffer);
+  }
+
+  {
+    CX11_PROFILE_ZONE(OUTPUT_GUARD);
+    outputGuard.process(buffer.getWritePointer(0),
+                        getTotalNumOutputChannels() > 1 ? buffer.getWritePointer(1) : nullptr,
+                        buffer.getNumSamples());
+  }
+  load_monitor.endBlock(blockStart, buffer.getNumSamples(), getSampleRate(), noteOns, blockFlags);
 }
 
-void CX11SynthAudioProcessor::splitBufferByEvents(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages) {
+int CX11SynthAudioProcessor::renderWithEvents(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages) {
   int bufferOffset = 0;
+  int noteOns = 0;
 
+  // The synth takes the events in-line while it renders, so the buffer is only split up if
+  // there are more events than fit in its queue, or for a morph that's moving.
   for (const auto metadata : midiMessages) {
+    // Ignore some MIDI messages
+    if (metadata.numBytes > 3) {
+      continue;
+    }
 
-    // Render audio that happens before this event
-    int samplesThisSegment = metadata.samplePosition - bufferOffset;
+    uint8_t data0 = metadata.data[0];
+    uint8_t data1 = (metadata.numBytes >= 2) ? metadata.data[1] : 0;
+    uint8_t data2 = (metadata.numBytes == 3) ? metadata.data[2] : 0;
 
-    if (samplesThisSegment > 0) {
-      render(buffer, samplesThisSegment, bufferOffset);
-      bufferOffset += samplesThisSegment;
+    if (!handleMIDI(data0, data1, data2)) {
+      continue;
     }
 
-    // Handle the event and ignore some MIDI messages
-    if (metadata.numBytes <= 3) {
-      uint8_t data1 = (metadata.numBytes >= 2) ? metadata.data[1] : 0;
-      uint8_t data2 = (metadata.numBytes == 3) ? metadata.data[2] : 0;
-      handleMIDI(metadata.data[0], data1, data2);
+    if ((data0 & 0xF0) == 0x90 && data2 > 0) {
+      ++noteOns;
     }
-  }
 
-  // Render the audio after the last MIDI event. Render the entire buffer
-  // if there were no MIDI events.
-  int samplesLastSegment = buffer.getNumSamples() - bufferOffset;
-  if (samplesLastSegment > 0) {
-    render(buffer, samplesLastSegment, bufferOffset);
+    // Notes after a program change wait for the new program, see holdingNotes().
+    const uint8_t status = data0 & 0xF0;
+    if ((status == 0x80 || status == 0x90) && holdingNotes()) {
+      if (numHeldNotes < MAX_HELD_NOTES) {
+        heldNotes[size_t(numHeldNotes++)] = { data0, data1, data2 };
+      }
+      continue;
+    }
+
+    const int position = std::min(metadata.samplePosition, buffer.getNumSamples());
+
+    // A render's events have to fall into its morph step.
+    if (morphRamp.isMoving()) {
+      renderUpTo(buffer, position - position % MORPH_STEP, bufferOffset);
+    }
+
+    if (!synth.queueMidiMessage(position - bufferOffset, data0, data1, data2)) {
+      // Queue is full, render up to this event (which empties it) and carry on from there.
+      renderUpTo(buffer, position, bufferOffset);
+      synth.queueMidiMessage(0, data0, data1, data2);
+    }
   }
 
+  renderUpTo(buffer, buffer.getNumSamples(), bufferOffset);
+
   midiMessages.clear();
+  return noteOns;
 }
 
-void CX11SynthAudioProcessor::update() {
-  float sample_rate = float(getSampleRate());
-  float inverse_sample_rate = 1.0f / sample_rate;
+void CX11SynthAudioProcessor::beginProgramChange(const SynthParameters& parameters) {
+  // Keeps the newest snapshot until the switch, a parameter change that comes in during the fade
+  // belongs to the new program as much as the rest of it.
+  programParameters = parameters;
+  appliedProgramChanges = parameters.program_changes;
+
+  if (!programPending) {
+    programPending = true;
+    programFadeRemaining = programFadeSamples;
+  }
+}
 
-  // On AudioParamterChoice data types, the index is the returned value.
-  // Mono = 0, Poly = 1
+void CX11SynthAudioProcessor::fadeOutProgram(juce::AudioBuffer<float>& buffer) {
+  // Straight line down to silence over programFadeSamples. If it gets there inside this block the
+  // rest of the block stays silent and the switch happens at the start of the next one.
+  const int sampleCount = buffer.getNumSamples();
+  const int fadeCount = std::min(programFadeRemaining, sampleCount);
+  const float scale = 1.0f / float(std::max(programFadeSamples, 1));
 
-  // 5.5 - 0.075 scales the time
-  synth.env_attack = std::exp(-inverse_sample_rate * std::exp(5.5f - 0.075f * env_attack_param->get()));
-  synth.env_decay = std::exp(-inverse_sample_rate * std::exp(5.5f - 0.075f * env_decay_param->get()));
-  synth.env_sustain = env_sustain_param->get() / 100.0f;
-  float env_release = env_release_param->get();
-  
-  if (env_release < 1.0f) {
-    synth.env_release = 0.75f; // extra fast release fades out over ~32 samples. 0.75^32 = 0.0001 aka SILENCE
-  } else {
-    synth.env_release = std::exp(-inverse_sample_rate * std::exp(5.5f - 0.075f * env_release));
+  buffer.applyGainRamp(0, fadeCount, float(programFadeRemaining) * scale, float(programFadeRemaining - fadeCount) * scale);
+  if (fadeCount < sampleCount) {
+    buffer.clear(fadeCount, sampleCount - fadeCount);
   }
+  programFadeRemaining -= fadeCount;
+}
 
-  float noise_mix = noise_param->get() / 100.0f;
-  noise_mix *= noise_mix;
-  synth.noise_mix = noise_mix * 0.06f;
+void CX11SynthAudioProcessor::switchProgram() {
+  synth.reset();
+  programParameters.applyTo(synth);
+  synth.output_level_smoother.setCurrentAndTargetValue(programParameters.output_level);
+  programPending = false;
+  programFadeRemaining = 0;
 
-  synth.filter_key_tracking = 0.08f * filter_freq_param->get() - 1.5f; // multiplier range -1.5..6.5
-  float filter_reso = filter_reso_param->get() / 100.0f;
-  synth.filter_q = std::exp(3.0f * filter_reso);
-  
-  synth.osc_mix = osc_mix_param->get() / 100.0f;
-  synth.volume_trim = 0.0008f * (3.2f - synth.osc_mix - 25.0f * synth.noise_mix) * (1.5f - 0.5f * filter_reso);
+  if (morphing()) {
+    applyMorph();
+  }
+}
 
-  float semi = osc_tune_param->get();
-  float cent = osc_fine_param->get();
-  synth.detune = std::pow(1.059463094359f, -semi - 0.01f * cent);
-  
-  float octave = octave_param->get();
-  float tuning = tuning_param->get();
-  float tune_in_semi = -36.3763f - 12.0f * octave - tuning / 100.0f;
-  synth.tune = sample_rate * std::exp(0.05776226505f * tune_in_semi);
+// From a MIDI program change until the synth has switched to the new program: the timer hasn't
+// dealt with it yet, or the fade before the switch is still running. Without holding them back
+// the notes that come with a program change would start on the old program and be cut off by
+// the switch, which is what a MIDI file that sets the program and starts playing at once does.
+bool CX11SynthAudioProcessor::holdingNotes() const {
+  return programPending || programRequests.load(std::memory_order_relaxed) != handledRequests;
+}
 
-  synth.num_voices = (poly_mode_param->getIndex() == 0) ? 1 : Synth::MAX_VOICES;
-  synth.output_level_smoother.setTargetValue(juce::Decibels::decibelsToGain(output_level_param->get()));
+void CX11SynthAudioProcessor::releaseHeldNotes() {
+  for (int i = 0; i < numHeldNotes; ++i) {
+    const MidiEvent& event = heldNotes[size_t(i)];
+    synth.midi_message(event.data0, event.data1, event.data2);
+  }
+  numHeldNotes = 0;
+}
 
-  float vibrato = vibrato_param->get() / 200.0f;
-  synth.vibrato = 0.2f * vibrato * vibrato;
+void CX11SynthAudioProcessor::startMorph(const PresetMorph& next) {
+  const bool started = !morphing();
+  morph = next;
 
-  synth.pwm_depth = synth.vibrato;
-  if (vibrato < 0.0f) { synth.vibrato = 0.0f; }
+  // Prepared at the sample rate before a prepareToPlay() that came in between.
+  if (morphing() && morph.getSampleRate() != float(getSampleRate())) {
+    morph.prepare(float(getSampleRate()));
+  }
 
-  float filter_velocity = filter_velocity_param->get();
-  if (filter_velocity < -90.0f) {
-    synth.velocity_sensitivity = 0.0f;
-    synth.ignore_velocity = true;
+  if (!morphing()) {
+    morphRamp.jump(0.0f); // the parameters are on their way
   } else {
-    synth.velocity_sensitivity = 0.0005f * filter_velocity;
-    synth.ignore_velocity = false;
+    if (started) {
+      morphRamp.jump(morphTarget());
+    }
+    applyMorph();
   }
+}
 
-  const float inverse_update_rate = inverse_sample_rate * synth.LFO_MAX;
-  float lfo_rate = std::exp(7.0f * lfo_rate_param->get() - 4.0f); // exp(7x - 4)
-  synth.lfo_inc = lfo_rate * inverse_update_rate * float(TAU);
+void CX11SynthAudioProcessor::applyMorph() {
+  SynthParameters parameters;
+  morph.evaluate(morphRamp.getValue(), parameters);
+  parameters.applyTo(synth);
+}
 
-  synth.glide_mode = glide_mode_param->getIndex();
+float CX11SynthAudioProcessor::morphTarget() const {
+  return morph_param->get() / 100.0f * float(morph.size() - 1);
+}
 
-  float glide_rate = glide_rate_param->get();
-  if (glide_rate < 2.0f) {
-    synth.glide_rate = 1.0f; // No glide
-  } else {
-    synth.glide_rate = 1.0f - std::exp(-inverse_update_rate * std::exp(6.0f - 0.07f * glide_rate));
+void CX11SynthAudioProcessor::updateParameters() {
+  // The timer and an offline render on the audio thread could both get here, only one of them
+  // gets to write the snapshot. The other one finds nothing left to do next time around.
+  const juce::SpinLock::ScopedTryLockType lock(parameterLock);
+  if (!lock.isLocked()) {
+    return;
   }
 
-  synth.glide_bend = glide_bend_param->get();
-  float filter_lfo = filter_lfo_param->get() / 100.0f;
-  synth.filter_lfo_depth = 2.5f * filter_lfo * filter_lfo; // parabolic curve [0..2.5]
+  const uint32_t dirty = dirtyParameters.exchange(0);
+  if (dirty == 0) {
+    return;
+  }
 
-  synth.filter_attack = std::exp(-inverse_update_rate * std::exp(5.5f - 0.075f * filter_attack_param->get()));
-  synth.filter_decay  = std::exp(-inverse_update_rate * std::exp(5.5f - 0.075f * filter_decay_param->get()));
-  synth.filter_sustain = filter_sustain_param->get() / 100.0f;
-  synth.filter_sustain = synth.filter_sustain * synth.filter_sustain; // logarithmic nature of frequencies?
-  synth.filter_release  = std::exp(-inverse_update_rate * std::exp(5.5f - 0.075f * filter_release_param->get()));
-  synth.filter_env_depth = 0.06f * filter_env_param->get();
+  update(dirty);
+  parameterSnapshot.publish(synthParameters);
+}
 
-  
+void CX11SynthAudioProcessor::update(uint32_t dirty) {
+  // The dirty bits go by parameter index, SynthParameters::update() goes by Preset::param.
+  const auto params = presetParameters();
+  float values[NUM_PARAMS];
+  uint32_t dirty_values = 0;
 
+  for (int i = 0; i < NUM_PARAMS; ++i) {
+    const auto* param = params[size_t(i)];
+    if (const auto* choice = dynamic_cast<const juce::AudioParameterChoice*>(param)) {
+      values[i] = float(choice->getIndex());
+    } else {
+      values[i] = static_cast<const juce::AudioParameterFloat*>(param)->get();
+    }
 
-  // starting pitch is 2^(n/12) where n is the number of fractional semitones. Alternate is 2.0 ^((-semi - 0.01f * cent) / 12.0f)
-  // 1.059463094359f == 2^(1/12)
-  // Using -semi because we specify the oscillator's period and not frequency. Making the period larger decreases the frequency.
-  /*
-    OLD DECAY LPF
-    // Need our exp(-x) function to go from 1.0 down to 0.0001 in a certain amount of time.
-    // Figure out the number of samples in the time period (ie. sample count for two seconds at 44.1kHz = 2.0 * 44100)
-    // log is the ln in multiplier  = exp(log(SILENCE) / sample_count)
-    // The decay param is a percentage, so bring it into 0.0..1.0. Dividing by 5.0 means 100% = 5 seconds
-    float decay_time = env_decay_param->get() / 100.0f * 5.0f;
-    float decay_samples = sample_rate * decay_time;
-    synth.env_decay = std::exp(std::log(SILENCE) / decay_samples);
-  
-  */  
+    if ((dirty & (1u << param->getParameterIndex())) != 0) {
+      dirty_values |= 1u << i;
+    }
+  }
+
+  synthParameters.update(values, dirty_values, parameterSampleRate);
 }
 
-void CX11SynthAudioProcessor::handleMIDI(uint8_t data0, uint8_t data1, uint8_t data2) {
+bool CX11SynthAudioProcessor::handleMIDI(uint8_t data0, uint8_t data1, uint8_t data2) {
   if (midi_learn && ((data0 & 0xF0) == 0xB0)) {
-    std::cout << "Learned a MIDI cc: '" << std::to_string(data1) << "'" << std::endl;
+    CX11_LOG("Learned a MIDI cc: '%d'", int(data1));
     midi_learn_cc = data1;
     midi_learn = false;
-    return;  
+    return false;
   }
 
   if ((data0 & 0xF0) == 0xB0) {
     if (data1 == 0x07) {
       float volume_ctl = float(data2) / 127.0f;
-      std::cout << volume_ctl << std::endl; // debug
+      CX11_LOG("CC7 volume %.3f", double(volume_ctl));
       output_level_param->beginChangeGesture();
       // NOTE: setValueNotifyingHost has a lock inside of it, however it should only be unbounded and potentially cause a glitch
       // if a MIDI message and opening/closing the editor window
@@ -422,13 +608,13 @@ void CX11SynthAudioProcessor::handleMIDI(uint8_t data0, uint8_t data1, uint8_t d
     }
   }
   
-  // Change program via MIDI
+  // Change program via MIDI. Setting 26 parameters isn't something to do on the audio thread,
+  // the timer picks the program up from here (and ignores it if the bank hasn't got it).
   if ((data0 & 0xF0) == 0xC0){
-    if (data1 < presets.size()) {
-      setCurrentProgram(data1);
-    }
+    pendingProgram.store(data1);
+    programRequests.store(programRequests.load(std::memory_order_relaxed) + 1);
   }
-  synth.midi_message(data0, data1, data2);
+  return true;
 }
 
 void CX11SynthAudioProcessor::render(juce::AudioBuffer<float>& buffer, int sampleCount , int bufferOffset) {
@@ -442,6 +628,25 @@ void CX11SynthAudioProcessor::render(juce::AudioBuffer<float>& buffer, int sampl
   synth.render(output_buffers, sampleCount);
 }
 
+void CX11SynthAudioProcessor::renderUpTo(juce::AudioBuffer<float>& buffer, int end, int& bufferOffset) {
+  while (bufferOffset < end) {
+    int sampleCount = end - bufferOffset;
+
+    // Steps start every MORPH_STEP samples from the start of the block. A step that's split by
+    // a full event queue only gets the morph's settings once.
+    if (morphRamp.isMoving()) {
+      if (bufferOffset % MORPH_STEP == 0) {
+        morphRamp.next();
+        applyMorph();
+      }
+      sampleCount = std::min(sampleCount, MORPH_STEP - bufferOffset % MORPH_STEP);
+    }
+
+    render(buffer, sampleCount, bufferOffset);
+    bufferOffset += sampleCount;
+  }
+}
+
 bool CX11SynthAudioProcessor::hasEditor() const {
   return true;  // (change this to false if you choose to not supply an editor)
 }
@@ -454,27 +659,102 @@ juce::AudioProcessorEditor* CX11SynthAudioProcessor::createEditor() {
 }
 
 void CX11SynthAudioProcessor::getStateInformation(juce::MemoryBlock& destData) {
-  auto xml = std::make_unique<juce::XmlElement>(plugin_tag);
+  // Binary: state_magic, the version, the number of parameters and their values in Preset::param
+  // order, the MIDI learn CC, the preset bank's path (empty for the built-in presets), since
+  // version 2 the polyphony, and since version 3 the morph: its position in percent, the number
+  // of presets and each one's name and parameters. No XML
+  // tree to build and parse, which adds up in a project with hundreds of instances. Versions
+  // before this one saved XML, see setXmlState().
+  juce::MemoryOutputStream stream(destData, false);
+
+  stream.write(state_magic, sizeof(state_magic));
+  stream.writeInt(state_version);
+  stream.writeInt(NUM_PARAMS);
+  for (const auto* param : presetParameters()) {
+    stream.writeFloat(param->convertFrom0to1(param->getValue()));
+  }
+  stream.writeInt(midi_learn_cc);
+  stream.writeString(presetBank->file().getFullPathName());
+  stream.writeInt(polyphony);
+
+  stream.writeFloat(morph_param->get());
+  stream.writeInt(int(morphPresets.size()));
+  for (const Preset& preset : morphPresets) {
+    stream.writeString(preset.name);
+    for (float value : preset.param) {
+      stream.writeFloat(value);
+    }
+  }
+}
+
+void CX11SynthAudioProcessor::setStateInformation(const void* data, int sizeInBytes) {
+  if (sizeInBytes >= int(sizeof(state_magic)) && std::memcmp(data, state_magic, sizeof(state_magic)) == 0) {
+    setBinaryState(data, sizeInBytes);
+  } else {
+    setXmlState(data, sizeInBytes);
+  }
+}
+
+void CX11SynthAudioProcessor::setBinaryState(const void* data, int sizeInBytes) {
+  juce::MemoryInputStream stream(data, size_t(sizeInBytes), false);
+  stream.skipNextBytes(sizeof(state_magic));
 
-  std::unique_ptr<juce::XmlElement> parametersXML(apvts.copyState().createXml());
-  xml->addChildElement(parametersXML.release());
+  const int version = stream.readInt();
+  const int count = stream.readInt();
+  // The values, the MIDI CC and at least the path's terminating zero.
+  if (version > state_version || count < 0 || stream.getNumBytesRemaining() < juce::int64(count) * 4 + 5) {
+    CX11_LOG("Ignoring a saved state that's from a newer version or damaged");
+    return;
+  }
 
-  auto extraXml = std::make_unique<juce::XmlElement>(extra_tag);
-  extraXml->setAttribute(midi_cc_attribute, midi_learn_cc);
-  xml->addChildElement(extraXml.release());
+  // State from before a parameter was added leaves it at its default.
+  const auto params = presetParameters();
+  for (int i = 0; i < std::max(count, NUM_PARAMS); ++i) {
+    const float value = i < count ? stream.readFloat() : 0.0f;
+    if (i < NUM_PARAMS) {
+      auto* param = params[size_t(i)];
+      param->setValueNotifyingHost(i < count ? param->convertTo0to1(value) : param->getDefaultValue());
+    }
+  }
+  dirtyParameters.store(ALL_PARAMETERS);
 
-  // You should use this method to store your parameters in the memory block.
-  // You could do that either as raw data, or use the XML or ValueTree classes
-  // as intermediaries to make it easy to save and load complex data.
-  copyXmlToBinary(*xml, destData);
+  const int midi_cc = stream.readInt();
+  if (midi_cc != 0) {
+    midi_learn_cc = static_cast<uint8_t>(midi_cc);
+  }
 
-  //std::cout << xml->toString() << std::endl;
+  const juce::String bank = stream.readString();
+  juce::String error;
+  if (bank.isNotEmpty() && !loadPresetBank(juce::File(bank), error)) {
+    CX11_LOG("Can't load the preset bank: %s", error.toRawUTF8());
+  }
+
+  // Like a change from the host, this takes effect the next time the plugin is prepared.
+  if (version >= 2) {
+    const int voices = stream.readInt();
+    if (voices > 0) {
+      polyphony = std::min(voices, Synth::MAX_VOICES);
+    }
+  }
+
+  // No morph in the state ends the one that's playing.
+  std::vector<Preset> presets;
+  if (version >= 3) {
+    morph_param->setValueNotifyingHost(morph_param->convertTo0to1(stream.readFloat()));
+
+    const int num_presets = stream.readInt();
+    for (int i = 0; i < std::min(num_presets, PresetMorph::MAX_PRESETS) && !stream.isExhausted(); ++i) {
+      Preset& preset = presets.emplace_back();
+      preset.setName(stream.readString().toRawUTF8());
+      for (float& value : preset.param) {
+        value = stream.readFloat();
+      }
+    }
+  }
+  setMorphPresets(presets);
 }
 
-void CX11SynthAudioProcessor::setStateInformation(const void* data, int sizeInBytes) {
-  // You should use this method to restore your parameters from this memory
-  // block, whose contents will have been created by the getStateInformation()
-  // call.
+void CX11SynthAudioProcessor::setXmlState(const void* data, int sizeInBytes) {
   std::unique_ptr<juce::XmlElement> xml(getXmlFromBinary(data, sizeInBytes));
 
   if (xml.get() != nullptr && xml->hasTagName(plugin_tag)) {
@@ -482,14 +762,20 @@ void CX11SynthAudioProcessor::setStateInformation(const void* data, int sizeInBy
       int midi_cc = extraXml->getIntAttribute(midi_cc_attribute);
 
       if (midi_cc != 0) {
-        std::cout << "Loaded Midi CC: " << midi_cc << std::endl;
+        CX11_LOG("Loaded Midi CC: %d", midi_cc);
         midi_learn_cc = static_cast<uint8_t>(midi_cc);
       }
+
+      const juce::String bank = extraXml->getStringAttribute(preset_bank_attribute);
+      juce::String error;
+      if (bank.isNotEmpty() && !loadPresetBank(juce::File(bank), error)) {
+        CX11_LOG("Can't load the preset bank: %s", error.toRawUTF8());
+      }
     }
     
     if (auto* parametersXML = xml->getChildByName(apvts.state.getType())) {
       apvts.replaceState(juce::ValueTree::fromXml(*parametersXML));
-      parametersChanged.store(true);
+      dirtyParameters.store(ALL_PARAMETERS);
     }
   }
 }
@@ -504,6 +790,13 @@ juce::AudioProcessorValueTreeState::ParameterLayout CX11SynthAudioProcessor::cre
     1
   ));
 
+  layout.add(std::make_unique<juce::AudioParameterChoice>(
+    ParameterId::osc_engine,
+    "Osc Engine",
+    juce::StringArray { "BLIT", "Wavetable" },
+    0
+  ));
+
   layout.add(std::make_unique<juce::AudioParameterFloat>(
     ParameterId::osc_tune,
     "Osc Tune",
@@ -743,6 +1036,15 @@ layout.add(std::make_unique<juce::AudioParameterFloat>(
     juce::AudioParameterFloatAttributes().withLabel("dB")      
   ));
 
+  // Only does something while the processor plays a morph, see setMorphPresets().
+  layout.add(std::make_unique<juce::AudioParameterFloat>(
+    ParameterId::morph,
+    "Morph",
+    juce::NormalisableRange<float>(0.0f, 100.0f),
+    0.0f,
+    juce::AudioParameterFloatAttributes().withLabel("%")
+  ));
+
 
   return layout;
 }
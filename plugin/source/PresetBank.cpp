@@ -0,0 +1,375 @@
+#include "CX11Synth/PresetBank.h"
+#include "CX11Synth/ParameterId.h"
+
+#include <charconv>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <mutex>
+
+namespace {
+    const char MAGIC[8] = { 'C', 'X', '1', '1', 'B', 'A', 'N', 'K' };
+
+    std::vector<Preset> factoryPresets() {
+        std::vector<Preset> presets;
+        presets.emplace_back("Init", 0.00f, -12.00f, 0.00f, 0.00f, 35.00f, 0.00f, 100.00f, 15.00f, 50.00f, 0.00f, 0.00f, 0.00f, 30.00f, 0.00f, 25.00f, 0.00f, 50.00f, 100.00f, 30.00f, 0.81f, 0.00f, 0.00f, 0.00f, 0.00f, 0.00f, 1.00f);
+        presets.emplace_back("5th Sweep Pad", 100.00f, -7.00f, -6.30f, 1.00f, 32.00f, 0.00f, 90.00f, 60.00f, -76.00f, 0.00f, 0.00f, 90.00f, 89.00f, 90.00f, 73.00f, 0.00f, 50.00f, 100.00f, 71.00f, 0.81f, 30.00f, 0.00f, 0.00f, 0.00f, 0.00f, 1.00f);
+        presets.emplace_back("Echo Pad [SA]", 88.00f, 0.00f, 0.00f, 0.00f, 49.00f, 0.00f, 46.00f, 76.00f, 38.00f, 10.00f, 38.00f, 100.00f, 86.00f, 76.00f, 57.00f, 30.00f, 80.00f, 68.00f, 66.00f, 0.79f, -74.00f, 25.00f, 0.00f, 0.00f, 0.00f, 1.00f);
+        presets.emplace_back("Space Chimes [SA]", 88.00f, 0.00f, 0.00f, 0.00f, 49.00f, 0.00f, 49.00f, 82.00f, 32.00f, 8.00f, 78.00f, 85.00f, 69.00f, 76.00f, 47.00f, 12.00f, 22.00f, 55.00f, 66.00f, 0.89f, -32.00f, 0.00f, 2.00f, 0.00f, 0.00f, 1.00f);
+        presets.emplace_back("Solid Backing", 100.00f, -12.00f, -18.70f, 0.00f, 35.00f, 0.00f, 30.00f, 25.00f, 40.00f, 0.00f, 26.00f, 0.00f, 35.00f, 0.00f, 25.00f, 0.00f, 50.00f, 100.00f, 30.00f, 0.81f, 0.00f, 50.00f, 0.00f, 0.00f, 0.00f, 1.00f);
+        presets.emplace_back("Velocity Backing [SA]", 41.00f, 0.00f, 9.70f, 0.00f, 8.00f, -1.68f, 49.00f, 1.00f, -32.00f, 0.00f, 86.00f, 61.00f, 87.00f, 100.00f, 93.00f, 11.00f, 48.00f, 98.00f, 32.00f, 0.81f, 0.00f, 0.00f, 0.00f, 0.00f, 0.00f, 1.00f);
+        presets.emplace_back("Rubber Backing [ZF]", 29.00f, 12.00f, -5.60f, 0.00f, 18.00f, 5.06f, 35.00f, 15.00f, 54.00f, 14.00f, 8.00f, 0.00f, 42.00f, 13.00f, 21.00f, 0.00f, 56.00f, 0.00f, 32.00f, 0.20f, 16.00f, 22.00f, 0.00f, 0.00f, 0.00f, 1.00f);
+        presets.emplace_back("808 State Lead", 100.00f, 7.00f, -7.10f, 2.00f, 34.00f, 12.35f, 65.00f, 63.00f, 50.00f, 16.00f, 0.00f, 0.00f, 30.00f, 0.00f, 25.00f, 17.00f, 50.00f, 100.00f, 3.00f, 0.81f, 0.00f, 0.00f, 1.00f, 0.00f, 0.00f, 1.00f);
+        presets.emplace_back("Mono Glide", 0.00f, -12.00f, 0.00f, 2.00f, 46.00f, 0.00f, 51.00f, 0.00f, 0.00f, 0.00f, -100.00f, 0.00f, 30.00f, 0.00f, 25.00f, 37.00f, 50.00f, 100.00f, 38.00f, 0.81f, 24.00f, 0.00f, 0.00f, 0.00f, 0.00f, 0.00f);
+        presets.emplace_back("Detuned Techno Lead", 84.00f, 0.00f, -17.20f, 2.00f, 41.00f, -0.15f, 54.00f, 1.00f, 16.00f, 21.00f, 34.00f, 0.00f, 9.00f, 100.00f, 25.00f, 20.00f, 85.00f, 100.00f, 30.00f, 0.83f, -82.00f, 40.00f, 0.00f, 0.00f, 0.00f, 1.00f);
+        presets.emplace_back("Hard Lead [SA]", 71.00f, 12.00f, 0.00f, 0.00f, 24.00f, 36.00f, 56.00f, 52.00f, 38.00f, 19.00f, 40.00f, 100.00f, 14.00f, 65.00f, 95.00f, 7.00f, 91.00f, 100.00f, 15.00f, 0.84f, -34.00f, 0.00f, 0.00f, 0.00f, 0.00f, 1.00f);
+        presets.emplace_back("Bubble", 0.00f, -12.00f, -0.20f, 0.00f, 71.00f, -0.00f, 23.00f, 77.00f, 60.00f, 32.00f, 26.00f, 40.00f, 18.00f, 66.00f, 14.00f, 0.00f, 38.00f, 65.00f, 16.00f, 0.48f, 0.00f, 0.00f, 1.00f, 0.00f, 0.00f, 1.00f);
+        presets.emplace_back("Monosynth", 62.00f, -12.00f, 0.00f, 1.00f, 35.00f, 0.02f, 64.00f, 39.00f, 2.00f, 65.00f, -100.00f, 7.00f, 52.00f, 24.00f, 84.00f, 13.00f, 30.00f, 76.00f, 21.00f, 0.58f, -40.00f, 0.00f, -1.00f, 0.00f, 0.00f, 0.00f);
+        presets.emplace_back("Moogcury Lite", 81.00f, 24.00f, -9.80f, 1.00f, 15.00f, -0.97f, 39.00f, 17.00f, 38.00f, 40.00f, 24.00f, 0.00f, 47.00f, 19.00f, 37.00f, 0.00f, 50.00f, 20.00f, 33.00f, 0.38f, 6.00f, 0.00f, -2.00f, 0.00f, 0.00f, 0.00f);
+        presets.emplace_back("Gangsta Whine", 0.00f, 0.00f, 0.00f, 2.00f, 44.00f, 0.00f, 41.00f, 46.00f, 0.00f, 0.00f, -100.00f, 0.00f, 0.00f, 100.00f, 25.00f, 15.00f, 50.00f, 100.00f, 32.00f, 0.81f, -2.00f, 0.00f, 2.00f, 0.00f, 0.00f, 0.00f);
+        presets.emplace_back("Higher Synth [ZF]", 48.00f, 0.00f, -8.80f, 0.00f, 0.00f, 0.00f, 50.00f, 47.00f, 46.00f, 30.00f, 60.00f, 0.00f, 10.00f, 0.00f, 7.00f, 0.00f, 42.00f, 0.00f, 22.00f, 0.21f, 18.00f, 16.00f, 2.00f, 0.00f, 0.00f, 1.00f);
+        presets.emplace_back("303 Saw Bass", 0.00f, 0.00f, 0.00f, 1.00f, 49.00f, 0.00f, 55.00f, 75.00f, 38.00f, 35.00f, 0.00f, 0.00f, 56.00f, 0.00f, 56.00f, 0.00f, 80.00f, 100.00f, 24.00f, 0.26f, -2.00f, 0.00f, -2.00f, 0.00f, 0.00f, 0.00f);
+        presets.emplace_back("303 Square Bass", 75.00f, 0.00f, 0.00f, 1.00f, 49.00f, 0.00f, 55.00f, 75.00f, 38.00f, 35.00f, 0.00f, 14.00f, 49.00f, 0.00f, 39.00f, 0.00f, 80.00f, 100.00f, 24.00f, 0.26f, -2.00f, 0.00f, -2.00f, 0.00f, 0.00f, 0.00f);
+        presets.emplace_back("Analog Bass", 100.00f, -12.00f, -10.90f, 1.00f, 19.00f, 0.00f, 30.00f, 51.00f, 70.00f, 9.00f, -100.00f, 0.00f, 88.00f, 0.00f, 21.00f, 0.00f, 50.00f, 100.00f, 46.00f, 0.81f, 0.00f, 0.00f, -1.00f, 0.00f, 0.00f, 0.00f);
+        presets.emplace_back("Analog Bass 2", 100.00f, -12.00f, -10.90f, 0.00f, 19.00f, 13.44f, 48.00f, 43.00f, 88.00f, 0.00f, 60.00f, 0.00f, 0.00f, 0.00f, 0.00f, 0.00f, 61.00f, 100.00f, 32.00f, 0.81f, 0.00f, 0.00f, -1.00f, 0.00f, 0.00f, 0.00f);
+        presets.emplace_back("Low Pulses", 97.00f, -12.00f, -3.30f, 0.00f, 35.00f, 0.00f, 80.00f, 40.00f, 4.00f, 0.00f, 0.00f, 0.00f, 77.00f, 0.00f, 25.00f, 0.00f, 50.00f, 100.00f, 30.00f, 0.81f, -68.00f, 0.00f, -2.00f, 0.00f, 0.00f, 1.00f);
+        presets.emplace_back("Sine Infra-Bass", 0.00f, -12.00f, 0.00f, 0.00f, 35.00f, 0.00f, 33.00f, 76.00f, 6.00f, 0.00f, 0.00f, 0.00f, 30.00f, 0.00f, 25.00f, 0.00f, 55.00f, 25.00f, 30.00f, 0.81f, 4.00f, 0.00f, -2.00f, 0.00f, 0.00f, 0.00f);
+        presets.emplace_back("Wobble Bass [SA]", 100.00f, -12.00f, -8.80f, 0.00f, 82.00f, 0.21f, 72.00f, 47.00f, -32.00f, 34.00f, 64.00f, 20.00f, 69.00f, 100.00f, 15.00f, 9.00f, 50.00f, 100.00f, 7.00f, 0.81f, -8.00f, 0.00f, -1.00f, 0.00f, 0.00f, 0.00f);
+        presets.emplace_back("Squelch Bass", 100.00f, -12.00f, -8.80f, 0.00f, 35.00f, 0.00f, 67.00f, 70.00f, -48.00f, 0.00f, 0.00f, 48.00f, 69.00f, 100.00f, 15.00f, 0.00f, 50.00f, 100.00f, 7.00f, 0.81f, -8.00f, 0.00f, -1.00f, 0.00f, 0.00f, 0.00f);
+        presets.emplace_back("Rubber Bass [ZF]", 49.00f, -12.00f, 1.60f, 1.00f, 35.00f, 0.00f, 36.00f, 15.00f, 50.00f, 20.00f, 0.00f, 0.00f, 38.00f, 0.00f, 25.00f, 0.00f, 60.00f, 100.00f, 22.00f, 0.19f, 0.00f, 0.00f, -2.00f, 0.00f, 0.00f, 0.00f);
+        presets.emplace_back("Soft Pick Bass", 37.00f, 0.00f, 7.80f, 0.00f, 22.00f, 0.00f, 33.00f, 47.00f, 42.00f, 16.00f, 18.00f, 0.00f, 0.00f, 0.00f, 25.00f, 4.00f, 58.00f, 0.00f, 22.00f, 0.15f, -12.00f, 33.00f, -2.00f, 0.00f, 0.00f, 0.00f);
+        presets.emplace_back("Fretless Bass", 50.00f, 0.00f, -14.40f, 1.00f, 34.00f, 0.00f, 51.00f, 0.00f, 16.00f, 0.00f, 34.00f, 0.00f, 9.00f, 0.00f, 25.00f, 20.00f, 85.00f, 0.00f, 30.00f, 0.81f, 40.00f, 0.00f, -2.00f, 0.00f, 0.00f, 0.00f);
+        presets.emplace_back("Whistler", 23.00f, 0.00f, -0.70f, 0.00f, 35.00f, 0.00f, 33.00f, 100.00f, 0.00f, 0.00f, 0.00f, 0.00f, 29.00f, 0.00f, 25.00f, 68.00f, 39.00f, 58.00f, 36.00f, 0.81f, 28.00f, 38.00f, 2.00f, 0.00f, 0.00f, 1.00f);
+        presets.emplace_back("Very Soft Pad", 39.00f, 0.00f, -4.90f, 2.00f, 12.00f, 0.00f, 35.00f, 78.00f, 0.00f, 0.00f, 0.00f, 0.00f, 30.00f, 0.00f, 25.00f, 35.00f, 50.00f, 80.00f, 70.00f, 0.81f, 0.00f, 0.00f, 0.00f, 0.00f, 0.00f, 1.00f);
+        presets.emplace_back("Pizzicato", 0.00f, -12.00f, 0.00f, 0.00f, 35.00f, 0.00f, 23.00f, 20.00f, 50.00f, 0.00f, 0.00f, 0.00f, 22.00f, 0.00f, 25.00f, 0.00f, 47.00f, 0.00f, 30.00f, 0.81f, 0.00f, 80.00f, 0.00f, 0.00f, 0.00f, 1.00f);
+        presets.emplace_back("Synth Strings", 100.00f, 0.00f, -7.10f, 0.00f, 0.00f, -0.97f, 42.00f, 26.00f, 50.00f, 14.00f, 38.00f, 0.00f, 67.00f, 55.00f, 97.00f, 82.00f, 70.00f, 100.00f, 42.00f, 0.84f, 34.00f, 30.00f, 0.00f, 0.00f, 0.00f, 1.00f);
+        presets.emplace_back("Synth Strings 2", 75.00f, 0.00f, -3.80f, 0.00f, 49.00f, 0.00f, 55.00f, 16.00f, 38.00f, 8.00f, -60.00f, 76.00f, 29.00f, 76.00f, 100.00f, 46.00f, 80.00f, 100.00f, 39.00f, 0.79f, -46.00f, 0.00f, 1.00f, 0.00f, 0.00f, 1.00f);
+        presets.emplace_back("Leslie Organ", 0.00f, 0.00f, 0.00f, 0.00f, 13.00f, -0.38f, 38.00f, 74.00f, 8.00f, 20.00f, -100.00f, 0.00f, 55.00f, 52.00f, 31.00f, 0.00f, 17.00f, 73.00f, 28.00f, 0.87f, -52.00f, 0.00f, -1.00f, 0.00f, 0.00f, 1.00f);
+        presets.emplace_back("Click Organ", 50.00f, 12.00f, 0.00f, 0.00f, 35.00f, 0.00f, 44.00f, 50.00f, 30.00f, 16.00f, -100.00f, 0.00f, 0.00f, 18.00f, 0.00f, 0.00f, 75.00f, 80.00f, 0.00f, 0.81f, -2.00f, 0.00f, 0.00f, 0.00f, 0.00f, 1.00f);
+        presets.emplace_back("Hard Organ", 89.00f, 19.00f, -0.90f, 0.00f, 35.00f, 0.00f, 51.00f, 62.00f, 8.00f, 0.00f, -100.00f, 0.00f, 37.00f, 0.00f, 100.00f, 4.00f, 8.00f, 72.00f, 4.00f, 0.77f, -2.00f, 0.00f, 0.00f, 0.00f, 0.00f, 1.00f);
+        presets.emplace_back("Bass Clarinet", 100.00f, 0.00f, 0.00f, 1.00f, 0.00f, 0.00f, 51.00f, 10.00f, 0.00f, 11.00f, 0.00f, 0.00f, 0.00f, 0.00f, 25.00f, 35.00f, 65.00f, 65.00f, 32.00f, 0.79f, -2.00f, 20.00f, -1.00f, 0.00f, 0.00f, 1.00f);
+        presets.emplace_back("Trumpet", 0.00f, 0.00f, 0.00f, 1.00f, 6.00f, 0.00f, 57.00f, 0.00f, -36.00f, 15.00f, 0.00f, 21.00f, 15.00f, 0.00f, 25.00f, 24.00f, 60.00f, 80.00f, 10.00f, 0.75f, 10.00f, 25.00f, 1.00f, 0.00f, 0.00f, 0.00f);
+        presets.emplace_back("Soft Horn", 12.00f, 19.00f, 1.90f, 0.00f, 35.00f, 0.00f, 50.00f, 21.00f, -42.00f, 12.00f, 20.00f, 0.00f, 35.00f, 36.00f, 25.00f, 8.00f, 50.00f, 100.00f, 27.00f, 0.83f, 2.00f, 10.00f, -1.00f, 0.00f, 0.00f, 1.00f);
+        presets.emplace_back("Brass Section", 43.00f, 12.00f, -7.90f, 0.00f, 28.00f, -0.79f, 50.00f, 0.00f, 18.00f, 0.00f, 0.00f, 24.00f, 16.00f, 91.00f, 8.00f, 17.00f, 50.00f, 80.00f, 45.00f, 0.81f, 0.00f, 0.00f, 0.00f, 0.00f, 0.00f, 1.00f);
+        presets.emplace_back("Synth Brass", 40.00f, 0.00f, -6.30f, 0.00f, 30.00f, -3.07f, 39.00f, 15.00f, 50.00f, 0.00f, 0.00f, 39.00f, 30.00f, 82.00f, 25.00f, 33.00f, 74.00f, 76.00f, 41.00f, 0.81f, -6.00f, 23.00f, 0.00f, 0.00f, 0.00f, 1.00f);
+        presets.emplace_back("Detuned Syn Brass [ZF]", 68.00f, 0.00f, 31.80f, 0.00f, 31.00f, 0.50f, 26.00f, 7.00f, 70.00f, 0.00f, 32.00f, 0.00f, 83.00f, 0.00f, 5.00f, 0.00f, 75.00f, 54.00f, 32.00f, 0.76f, -26.00f, 29.00f, 0.00f, 0.00f, 0.00f, 1.00f);
+        presets.emplace_back("Power PWM", 100.00f, -12.00f, -8.80f, 0.00f, 35.00f, 0.00f, 82.00f, 13.00f, 50.00f, 0.00f, -100.00f, 24.00f, 30.00f, 88.00f, 34.00f, 0.00f, 50.00f, 100.00f, 48.00f, 0.71f, -26.00f, 0.00f, -1.00f, 0.00f, 0.00f, 1.00f);
+        presets.emplace_back("Water Velocity [SA]", 76.00f, 0.00f, -1.40f, 0.00f, 49.00f, 0.00f, 87.00f, 67.00f, 100.00f, 32.00f, -82.00f, 95.00f, 56.00f, 72.00f, 100.00f, 4.00f, 76.00f, 11.00f, 46.00f, 0.88f, 44.00f, 0.00f, -1.00f, 0.00f, 0.00f, 1.00f);
+        presets.emplace_back("Ghost [SA]", 75.00f, 0.00f, -7.10f, 2.00f, 16.00f, -0.00f, 38.00f, 58.00f, 50.00f, 16.00f, 62.00f, 0.00f, 30.00f, 40.00f, 31.00f, 37.00f, 50.00f, 100.00f, 54.00f, 0.85f, 66.00f, 43.00f, 0.00f, 0.00f, 0.00f, 1.00f);
+        presets.emplace_back("Soft E.Piano", 31.00f, 0.00f, -0.20f, 0.00f, 35.00f, 0.00f, 34.00f, 26.00f, 6.00f, 0.00f, 26.00f, 0.00f, 22.00f, 0.00f, 39.00f, 0.00f, 80.00f, 0.00f, 44.00f, 0.81f, 2.00f, 0.00f, 0.00f, 0.00f, 0.00f, 1.00f);
+        presets.emplace_back("Thumb Piano", 72.00f, 15.00f, 50.00f, 0.00f, 35.00f, 0.00f, 37.00f, 47.00f, 8.00f, 0.00f, 0.00f, 0.00f, 45.00f, 0.00f, 39.00f, 0.00f, 39.00f, 0.00f, 48.00f, 0.81f, 20.00f, 0.00f, 1.00f, 0.00f, 0.00f, 1.00f);
+        presets.emplace_back("Steel Drums [ZF]", 81.00f, 12.00f, -12.00f, 0.00f, 18.00f, 2.30f, 40.00f, 30.00f, 8.00f, 17.00f, -20.00f, 0.00f, 42.00f, 23.00f, 47.00f, 12.00f, 48.00f, 0.00f, 49.00f, 0.53f, -28.00f, 34.00f, 0.00f, 0.00f, 0.00f, 1.00f);
+        presets.emplace_back("Car Horn", 57.00f, -1.00f, -2.80f, 0.00f, 35.00f, 0.00f, 46.00f, 0.00f, 36.00f, 0.00f, 0.00f, 46.00f, 30.00f, 100.00f, 23.00f, 30.00f, 50.00f, 100.00f, 31.00f, 1.00f, -24.00f, 0.00f, 0.00f, 0.00f, 0.00f, 1.00f);
+        presets.emplace_back("Helicopter", 0.00f, -12.00f, 0.00f, 0.00f, 35.00f, 0.00f, 8.00f, 36.00f, 38.00f, 100.00f, 0.00f, 100.00f, 100.00f, 0.00f, 100.00f, 96.00f, 50.00f, 100.00f, 92.00f, 0.97f, 0.00f, 100.00f, -2.00f, 0.00f, 0.00f, 1.00f);
+        presets.emplace_back("Arctic Wind", 0.00f, -12.00f, 0.00f, 0.00f, 35.00f, 0.00f, 16.00f, 85.00f, 0.00f, 28.00f, 0.00f, 37.00f, 30.00f, 0.00f, 25.00f, 89.00f, 50.00f, 100.00f, 89.00f, 0.24f, 0.00f, 100.00f, 2.00f, 0.00f, 0.00f, 1.00f);
+        presets.emplace_back("Thip", 100.00f, -7.00f, 0.00f, 0.00f, 35.00f, 0.00f, 0.00f, 100.00f, 94.00f, 0.00f, 0.00f, 2.00f, 20.00f, 0.00f, 20.00f, 0.00f, 46.00f, 0.00f, 30.00f, 0.81f, 0.00f, 78.00f, 0.00f, 0.00f, 0.00f, 1.00f);
+        presets.emplace_back("Synth Tom", 0.00f, -12.00f, 0.00f, 0.00f, 76.00f, 24.53f, 30.00f, 33.00f, 52.00f, 0.00f, 36.00f, 0.00f, 59.00f, 0.00f, 59.00f, 10.00f, 50.00f, 0.00f, 50.00f, 0.81f, 0.00f, 70.00f, -2.00f, 0.00f, 0.00f, 1.00f);
+        presets.emplace_back("Squelchy Frog", 50.00f, -5.00f, -7.90f, 2.00f, 77.00f, -36.00f, 40.00f, 65.00f, 90.00f, 0.00f, 0.00f, 33.00f, 50.00f, 0.00f, 25.00f, 0.00f, 70.00f, 65.00f, 18.00f, 0.32f, 100.00f, 0.00f, -2.00f, 0.00f, 0.00f, 1.00f);
+        return presets;
+    }
+
+    // The parameter IDs in Preset::param order, for the text format.
+    juce::StringArray parameterIds() {
+        const juce::ParameterID ids[NUM_PARAMS] = {
+            ParameterId::osc_mix, ParameterId::osc_tune, ParameterId::osc_fine,
+            ParameterId::glide_mode, ParameterId::glide_rate, ParameterId::glide_bend,
+            ParameterId::filter_freq, ParameterId::filter_reso, ParameterId::filter_env,
+            ParameterId::filter_lfo, ParameterId::filter_velocity,
+            ParameterId::filter_attack, ParameterId::filter_decay, ParameterId::filter_sustain, ParameterId::filter_release,
+            ParameterId::env_attack, ParameterId::env_decay, ParameterId::env_sustain, ParameterId::env_release,
+            ParameterId::lfo_rate, ParameterId::vibrato, ParameterId::noise, ParameterId::octave, ParameterId::tuning,
+            ParameterId::output_level, ParameterId::poly_mode, ParameterId::osc_engine,
+        };
+
+        juce::StringArray names;
+        for (const auto& id : ids) {
+            names.add(id.getParamID());
+        }
+        return names;
+    }
+
+    uint32_t readUInt32(const char* data) {
+        return juce::ByteOrder::littleEndianInt(data);
+    }
+
+    float readFloat(const char* data) {
+        const uint32_t bits = juce::ByteOrder::littleEndianInt(data);
+        float value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    // Banks that are open somewhere, so opening one again shares its map.
+    struct OpenBanks {
+        std::mutex lock;
+        std::map<juce::String, std::weak_ptr<const PresetBank>> banks;
+    };
+
+    OpenBanks& openBanks() {
+        static OpenBanks instance;
+        return instance;
+    }
+}
+
+std::shared_ptr<const PresetBank> PresetBank::factory() {
+    static const std::shared_ptr<const PresetBank> bank = fromPresets(factoryPresets());
+    return bank;
+}
+
+std::shared_ptr<const PresetBank> PresetBank::open(const juce::File& file, juce::String& error) {
+    const juce::String path = file.getFullPathName();
+    const juce::Time modified = file.getLastModificationTime();
+
+    OpenBanks& open_banks = openBanks();
+    const std::lock_guard<std::mutex> guard(open_banks.lock);
+
+    // A file that's been written since it was mapped is mapped again. The old map stays valid
+    // for whoever still has it.
+    if (auto bank = open_banks.banks[path].lock(); bank != nullptr && bank->modified_ == modified) {
+        return bank;
+    }
+
+    if (!file.existsAsFile()) {
+        error = "can't open " + path;
+        return nullptr;
+    }
+
+    std::shared_ptr<PresetBank> bank(new PresetBank());
+    bank->file_ = file;
+    bank->modified_ = modified;
+    bank->map_ = std::make_unique<juce::MemoryMappedFile>(file, juce::MemoryMappedFile::readOnly, false);
+    if (bank->map_->getData() == nullptr) {
+        error = "can't map " + path;
+        return nullptr;
+    }
+
+    if (!bank->parse(bank->map_->getData(), bank->map_->getSize(), error)) {
+        error = path + ": " + error;
+        return nullptr;
+    }
+
+    open_banks.banks[path] = bank;
+    return bank;
+}
+
+std::shared_ptr<const PresetBank> PresetBank::fromPresets(const std::vector<Preset>& presets) {
+    std::shared_ptr<PresetBank> bank(new PresetBank());
+    {
+        juce::MemoryOutputStream stream(bank->memory_, false);
+        write(presets, stream);
+    }
+
+    juce::String error;
+    const bool ok = bank->parse(bank->memory_.getData(), bank->memory_.getSize(), error);
+    jassertquiet(ok);
+    return bank;
+}
+
+bool PresetBank::parse(const void* data, size_t size, juce::String& error) {
+    const char* bytes = static_cast<const char*>(data);
+
+    if (size < HEADER_SIZE || std::memcmp(bytes, MAGIC, sizeof(MAGIC)) != 0) {
+        error = "not a preset bank";
+        return false;
+    }
+
+    const uint32_t version = readUInt32(bytes + 8);
+    if (version != VERSION) {
+        error = "preset bank version " + juce::String(version) + ", this build reads version " + juce::String(VERSION);
+        return false;
+    }
+
+    const uint64_t count = readUInt32(bytes + 12);
+    const uint64_t param_count = readUInt32(bytes + 16);
+    const uint64_t names_offset = readUInt32(bytes + 20);
+    const uint64_t params_offset = readUInt32(bytes + 24);
+
+    // In 64 bits, so a corrupt count can't wrap around and pass.
+    if (count > uint64_t(std::numeric_limits<int>::max())
+            || names_offset + count * uint64_t(NAME_LENGTH) > size
+            || params_offset + count * param_count * sizeof(float) > size) {
+        error = "preset bank is cut short or corrupt";
+        return false;
+    }
+
+    count_ = int(count);
+    param_count_ = int(param_count);
+    names_ = bytes + names_offset;
+    params_ = bytes + params_offset;
+    return true;
+}
+
+juce::String PresetBank::name(int index) const {
+    jassert(index >= 0 && index < count_);
+    const char* name = names_ + size_t(index) * NAME_LENGTH;
+    size_t length = 0;
+    while (length < size_t(NAME_LENGTH) && name[length] != '\0') {
+        ++length;
+    }
+    return juce::String::fromUTF8(name, int(length));
+}
+
+Preset PresetBank::preset(int index) const {
+    jassert(index >= 0 && index < count_);
+    Preset preset;
+    std::memcpy(preset.name, names_ + size_t(index) * NAME_LENGTH, NAME_LENGTH);
+    preset.name[NAME_LENGTH - 1] = '\0';
+
+    const char* params = params_ + size_t(index) * size_t(param_count_) * sizeof(float);
+    for (int i = 0; i < std::min(param_count_, NUM_PARAMS); ++i) {
+        preset.param[i] = readFloat(params + size_t(i) * sizeof(float));
+    }
+    return preset;
+}
+
+std::vector<Preset> PresetBank::presets() const {
+    std::vector<Preset> presets;
+    presets.reserve(size_t(count_));
+    for (int i = 0; i < count_; ++i) {
+        presets.push_back(preset(i));
+    }
+    return presets;
+}
+
+void PresetBank::write(const std::vector<Preset>& presets, juce::OutputStream& stream) {
+    const uint32_t count = uint32_t(presets.size());
+    const uint32_t names_offset = uint32_t(HEADER_SIZE);
+    const uint32_t params_offset = names_offset + count * uint32_t(NAME_LENGTH);
+
+    // OutputStream writes numbers little-endian.
+    stream.write(MAGIC, sizeof(MAGIC));
+    stream.writeInt(int(VERSION));
+    stream.writeInt(int(count));
+    stream.writeInt(NUM_PARAMS);
+    stream.writeInt(int(names_offset));
+    stream.writeInt(int(params_offset));
+    stream.writeInt(0);
+
+    for (const Preset& preset : presets) {
+        char name[NAME_LENGTH] = {};
+        std::memcpy(name, preset.name, std::min(std::strlen(preset.name), size_t(NAME_LENGTH - 1)));
+        stream.write(name, sizeof(name));
+    }
+
+    for (const Preset& preset : presets) {
+        for (float value : preset.param) {
+            stream.writeFloat(value);
+        }
+    }
+}
+
+bool PresetBank::write(const std::vector<Preset>& presets, const juce::File& file, juce::String& error) {
+    // Into a temporary file that replaces the bank at the end, so nobody's map of the old one
+    // changes under them.
+    juce::TemporaryFile temporary(file);
+    {
+        juce::FileOutputStream stream(temporary.getFile());
+        if (stream.failedToOpen()) {
+            error = "can't write " + file.getFullPathName();
+            return false;
+        }
+
+        write(presets, stream);
+        stream.flush();
+        if (stream.getStatus().failed()) {
+            error = "can't write " + file.getFullPathName() + ": " + stream.getStatus().getErrorMessage();
+            return false;
+        }
+    }
+
+    if (!temporary.overwriteTargetFileWithTemporary()) {
+        error = "can't replace " + file.getFullPathName();
+        return false;
+    }
+    return true;
+}
+
+bool PresetBank::writeText(const std::vector<Preset>& presets, const juce::File& file, juce::String& error) {
+    juce::String text = "name\t" + parameterIds().joinIntoString("\t") + "\n";
+    for (const Preset& preset : presets) {
+        text << juce::String::fromUTF8(preset.name);
+        for (float value : preset.param) {
+            // The shortest text that reads back as the same float, 0.81 and not 0.810000002.
+            char number[32];
+            const auto result = std::to_chars(number, number + sizeof(number), value);
+            text << "\t" << juce::String(number, size_t(result.ptr - number));
+        }
+        text << "\n";
+    }
+
+    if (!file.replaceWithText(text, false, false, "\n")) {
+        error = "can't write " + file.getFullPathName();
+        return false;
+    }
+    return true;
+}
+
+bool PresetBank::readText(const juce::File& file, std::vector<Preset>& presets, juce::String& error) {
+    if (!file.existsAsFile()) {
+        error = "can't open " + file.getFullPathName();
+        return false;
+    }
+
+    juce::StringArray lines;
+    file.readLines(lines);
+    if (lines.isEmpty()) {
+        return true;
+    }
+
+    const auto where = [&file](int line_index) {
+        return file.getFileName() + ":" + juce::String(line_index + 1) + ": ";
+    };
+
+    // Columns go by the IDs in the header, so they can be moved around or deleted in a
+    // spreadsheet. Like in a bank, a parameter that isn't there stays at 0 and a column this
+    // version doesn't know is skipped.
+    juce::StringArray header;
+    header.addTokens(lines[0], "\t", "");
+    header.trim();
+    if (header.isEmpty() || header[0] != "name") {
+        error = where(0) + "expected a header of name and the parameter IDs separated by tabs";
+        return false;
+    }
+
+    const juce::StringArray ids = parameterIds();
+    std::vector<int> columns; // the param index of each column after the name, -1 to skip it
+    for (int i = 1; i < header.size(); ++i) {
+        columns.push_back(ids.indexOf(header[i]));
+    }
+
+    for (int line_index = 1; line_index < lines.size(); ++line_index) {
+        if (lines[line_index].trim().isEmpty()) {
+            continue;
+        }
+
+        juce::StringArray fields;
+        fields.addTokens(lines[line_index], "\t", "");
+        if (fields.size() < 2 || fields.size() > header.size()) {
+            error = where(line_index) + "expected a name and up to " + juce::String(header.size() - 1)
+                  + " values separated by tabs";
+            return false;
+        }
+
+        Preset preset;
+        preset.setName(fields[0].trim().toRawUTF8());
+        for (int i = 1; i < fields.size(); ++i) {
+            const int param = columns[size_t(i - 1)];
+            if (param < 0) {
+                continue;
+            }
+
+            // The same format writeText() uses, and nothing else: a typo is an error, not a 0.
+            const std::string text = fields[i].trim().toStdString();
+            float value = 0.0f;
+            const auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+            if (text.empty() || result.ec != std::errc() || result.ptr != text.data() + text.size()) {
+                error = where(line_index) + "\"" + fields[i].trim() + "\" isn't a number (" + header[i] + ")";
+                return false;
+            }
+            preset.param[param] = value;
+        }
+        presets.push_back(preset);
+    }
+
+    return true;
+}
@@ -0,0 +1,343 @@
+#include "CX11Synth/PresetLibrary.h"
+#include "CX11Synth/RealtimeLog.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+    const char INDEX_MAGIC[8] = { 'C', 'X', '1', '1', 'L', 'I', 'B', 'X' };
+    constexpr int INDEX_VERSION = 1;
+
+    // Folders below the scanned directory, the bank's name and an author code at the end of the
+    // preset name.
+    juce::StringArray tagsFor(const juce::String& name, const juce::File& bank, const juce::File& directory) {
+        juce::StringArray tags;
+        tags.addTokens(bank.getParentDirectory().getRelativePathFrom(directory), "/\\", "");
+        tags.removeString(".");
+        tags.add(bank.getFileNameWithoutExtension());
+
+        const juce::String trimmed = name.trimEnd();
+        if (trimmed.endsWithChar(']') && trimmed.containsChar('[')) {
+            tags.add(trimmed.fromLastOccurrenceOf("[", false, false).dropLastCharacters(1));
+        }
+
+        tags.removeEmptyStrings();
+        tags.removeDuplicates(true);
+        return tags;
+    }
+}
+
+PresetLibrary::Snapshot::Snapshot(std::vector<Entry> entries) {
+    // Sorted by the same lower-case keys findPrefix() searches.
+    std::vector<juce::String> keys;
+    std::vector<size_t> order;
+    keys.reserve(entries.size());
+    order.reserve(entries.size());
+    for (size_t i = 0; i < entries.size(); ++i) {
+        keys.push_back(entries[i].name.toLowerCase());
+        order.push_back(i);
+    }
+
+    std::sort(order.begin(), order.end(), [&keys, &entries](size_t a, size_t b) {
+        if (keys[a] != keys[b]) {
+            return keys[a] < keys[b];
+        }
+        return entries[a].bank != entries[b].bank ? entries[a].bank < entries[b].bank : entries[a].index < entries[b].index;
+    });
+
+    entries_.reserve(entries.size());
+    keys_.reserve(entries.size());
+    for (size_t i : order) {
+        entries_.push_back(std::move(entries[i]));
+        keys_.push_back(std::move(keys[i]));
+    }
+
+    for (int i = 0; i < NUM_PARAMS; ++i) {
+        float lowest = 0.0f;
+        float highest = 0.0f;
+        for (size_t j = 0; j < entries_.size(); ++j) {
+            const float value = entries_[j].params[size_t(i)];
+            lowest = j == 0 ? value : std::min(lowest, value);
+            highest = j == 0 ? value : std::max(highest, value);
+        }
+        weights_[size_t(i)] = highest > lowest ? 1.0f / (highest - lowest) : 0.0f;
+    }
+}
+
+std::vector<int> PresetLibrary::Snapshot::findPrefix(const juce::String& prefix, int max_results) const {
+    const juce::String key = prefix.toLowerCase();
+    std::vector<int> found;
+
+    // Everything that starts with the prefix sorts right after it.
+    auto it = std::lower_bound(keys_.begin(), keys_.end(), key);
+    for (; it != keys_.end() && it->startsWith(key) && int(found.size()) < max_results; ++it) {
+        found.push_back(int(it - keys_.begin()));
+    }
+    return found;
+}
+
+std::vector<int> PresetLibrary::Snapshot::findTag(const juce::String& tag, int max_results) const {
+    std::vector<int> found;
+    for (int i = 0; i < size() && int(found.size()) < max_results; ++i) {
+        if (entries_[size_t(i)].tags.contains(tag, true)) {
+            found.push_back(i);
+        }
+    }
+    return found;
+}
+
+std::vector<int> PresetLibrary::Snapshot::findSimilar(const float (&params)[NUM_PARAMS], int count) const {
+    std::vector<std::pair<float, int>> distances;
+    distances.reserve(entries_.size());
+
+    for (int i = 0; i < size(); ++i) {
+        const Entry& entry = entries_[size_t(i)];
+        float distance = 0.0f;
+        for (int j = 0; j < NUM_PARAMS; ++j) {
+            const float difference = (entry.params[size_t(j)] - params[j]) * weights_[size_t(j)];
+            distance += difference * difference;
+        }
+        distances.emplace_back(distance, i);
+    }
+
+    count = std::min(count, size());
+    std::partial_sort(distances.begin(), distances.begin() + count, distances.end());
+
+    std::vector<int> found;
+    for (int i = 0; i < count; ++i) {
+        found.push_back(distances[size_t(i)].second);
+    }
+    return found;
+}
+
+bool PresetLibrary::Snapshot::load(int index, Preset& preset, juce::String& error) const {
+    const Entry& entry = entries_[size_t(index)];
+
+    const auto bank = PresetBank::open(entry.bank, error);
+    if (bank == nullptr) {
+        return false;
+    }
+    if (entry.index >= bank->size()) {
+        error = entry.bank.getFullPathName() + " has changed since it was indexed";
+        return false;
+    }
+
+    preset = bank->preset(entry.index);
+    return true;
+}
+
+PresetLibrary::PresetLibrary(const juce::File& index_file)
+    : juce::Thread("CX11 preset library"), index_file_(index_file),
+      snapshot_(std::make_shared<const Snapshot>(std::vector<Entry>())) {
+    startThread(juce::Thread::Priority::background);
+}
+
+PresetLibrary::~PresetLibrary() {
+    stopThread(5000);
+}
+
+void PresetLibrary::setDirectories(const juce::Array<juce::File>& directories) {
+    {
+        const juce::ScopedLock lock(directories_lock_);
+        directories_ = directories;
+    }
+    rescan();
+}
+
+void PresetLibrary::rescan() {
+    ++requested_scans_;
+    notify();
+}
+
+std::shared_ptr<const PresetLibrary::Snapshot> PresetLibrary::snapshot() const {
+    const juce::SpinLock::ScopedLockType lock(snapshot_lock_);
+    return snapshot_;
+}
+
+bool PresetLibrary::waitForScan(int timeout_ms) {
+    const uint32_t wanted = requested_scans_.load();
+    const uint32_t start = juce::Time::getMillisecondCounter();
+
+    while (int32_t(finished_scans_.load() - wanted) < 0) {
+        const int elapsed = int(juce::Time::getMillisecondCounter() - start);
+        if (elapsed >= timeout_ms) {
+            return false;
+        }
+        scan_finished_.wait(std::min(timeout_ms - elapsed, 50));
+    }
+    return true;
+}
+
+void PresetLibrary::run() {
+    // What the last run found, until the scan has caught up.
+    if (readIndex()) {
+        publish();
+    }
+
+    while (!threadShouldExit()) {
+        const uint32_t requested = requested_scans_.load();
+        if (requested == finished_scans_.load()) {
+            wait(-1);
+            continue;
+        }
+
+        scan();
+        if (threadShouldExit()) {
+            return;
+        }
+
+        publish();
+        if (!writeIndex()) {
+            CX11_LOG("Can't write the preset library index %s", index_file_.getFullPathName().toRawUTF8());
+        }
+
+        finished_scans_.store(requested);
+        scan_finished_.signal();
+    }
+}
+
+void PresetLibrary::scan() {
+    juce::Array<juce::File> directories;
+    {
+        const juce::ScopedLock lock(directories_lock_);
+        directories = directories_;
+    }
+
+    // Banks whose size and modification time haven't changed are taken from the index as they
+    // are, only new and changed ones are opened.
+    std::map<juce::String, Bank> found;
+    for (const juce::File& directory : directories) {
+        for (const auto& item : juce::RangedDirectoryIterator(directory, true, "*.cx11bank", juce::File::findFiles)) {
+            if (threadShouldExit()) {
+                return;
+            }
+
+            const juce::File file = item.getFile();
+            const juce::String path = file.getFullPathName();
+            if (found.count(path) != 0) {
+                continue; // directories that overlap
+            }
+
+            Bank bank;
+            bank.size = item.getFileSize();
+            bank.modified = item.getModificationTime().toMilliseconds();
+
+            if (auto known = banks_.find(path); known != banks_.end() && known->second.size == bank.size
+                                                && known->second.modified == bank.modified) {
+                found.emplace(path, std::move(known->second));
+                continue;
+            }
+
+            // A bank that can't be read is remembered without presets, so it isn't tried again
+            // until it changes.
+            juce::String error;
+            if (const auto presets = PresetBank::open(file, error)) {
+                for (int i = 0; i < presets->size(); ++i) {
+                    const Preset preset = presets->preset(i);
+                    Entry entry;
+                    entry.name = juce::String::fromUTF8(preset.name);
+                    entry.tags = tagsFor(entry.name, file, directory);
+                    entry.bank = file;
+                    entry.index = i;
+                    std::copy(std::begin(preset.param), std::end(preset.param), entry.params.begin());
+                    bank.entries.push_back(std::move(entry));
+                }
+            } else {
+                CX11_LOG("Skipping %s", error.toRawUTF8());
+            }
+
+            found.emplace(path, std::move(bank));
+        }
+    }
+
+    banks_ = std::move(found);
+}
+
+void PresetLibrary::publish() {
+    std::vector<Entry> entries;
+    for (const auto& [path, bank] : banks_) {
+        entries.insert(entries.end(), bank.entries.begin(), bank.entries.end());
+    }
+
+    auto snapshot = std::make_shared<const Snapshot>(std::move(entries));
+    {
+        const juce::SpinLock::ScopedLockType lock(snapshot_lock_);
+        snapshot_.swap(snapshot);
+    }
+    sendChangeMessage();
+}
+
+// The index: INDEX_MAGIC, version and parameter count, then for each bank its path, size,
+// modification time and presets (name, index in the bank, tags, parameter values), and the number
+// of banks at the end. Written with juce::OutputStream, so little-endian.
+bool PresetLibrary::readIndex() {
+    juce::FileInputStream stream(index_file_);
+    if (!stream.openedOk()) {
+        return false;
+    }
+
+    char magic[sizeof(INDEX_MAGIC)] = {};
+    if (stream.read(magic, int(sizeof(magic))) != int(sizeof(magic)) || std::memcmp(magic, INDEX_MAGIC, sizeof(magic)) != 0
+            || stream.readInt() != INDEX_VERSION || stream.readInt() != NUM_PARAMS) {
+        return false; // from another version, scanned from scratch
+    }
+
+    std::map<juce::String, Bank> banks;
+    const int bank_count = stream.readInt();
+    for (int i = 0; i < bank_count && !stream.isExhausted(); ++i) {
+        const juce::File file(stream.readString());
+        Bank& bank = banks[file.getFullPathName()];
+        bank.size = stream.readInt64();
+        bank.modified = stream.readInt64();
+
+        const int entry_count = stream.readInt();
+        for (int j = 0; j < entry_count && !stream.isExhausted(); ++j) {
+            Entry entry;
+            entry.name = stream.readString();
+            entry.index = stream.readInt();
+            entry.tags.addLines(stream.readString());
+            entry.bank = file;
+            for (float& value : entry.params) {
+                value = stream.readFloat();
+            }
+            bank.entries.push_back(std::move(entry));
+        }
+    }
+
+    // The bank count again at the end, reads as 0 if the file was cut short.
+    if (int(banks.size()) != bank_count || stream.readInt() != bank_count) {
+        return false;
+    }
+
+    banks_ = std::move(banks);
+    return true;
+}
+
+bool PresetLibrary::writeIndex() const {
+    juce::MemoryOutputStream stream;
+    stream.write(INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    stream.writeInt(INDEX_VERSION);
+    stream.writeInt(NUM_PARAMS);
+    stream.writeInt(int(banks_.size()));
+
+    for (const auto& [path, bank] : banks_) {
+        stream.writeString(path);
+        stream.writeInt64(bank.size);
+        stream.writeInt64(bank.modified);
+        stream.writeInt(int(bank.entries.size()));
+
+        for (const Entry& entry : bank.entries) {
+            stream.writeString(entry.name);
+            stream.writeInt(entry.index);
+            stream.writeString(entry.tags.joinIntoString("\n"));
+            for (float value : entry.params) {
+                stream.writeFloat(value);
+            }
+        }
+    }
+
+    stream.writeInt(int(banks_.size()));
+
+    index_file_.getParentDirectory().createDirectory();
+    return index_file_.replaceWithData(stream.getData(), stream.getDataSize());
+}
@@ -0,0 +1,121 @@
+#include "CX11Synth/PresetMorph.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Everything continuous in SynthParameters. The switches aren't in here, evaluate() takes those
+// from the nearer preset.
+const PresetMorph::Setting PresetMorph::settings[NUM_SETTINGS] = {
+    { &SynthParameters::env_attack, RATE },
+    { &SynthParameters::env_decay, RATE },
+    { &SynthParameters::env_sustain, LINEAR },
+    { &SynthParameters::env_release, RATE },
+    { &SynthParameters::noise_mix, LINEAR },
+    { &SynthParameters::filter_key_tracking, LINEAR },
+    { &SynthParameters::filter_q, LOG },
+    { &SynthParameters::osc_mix, LINEAR },
+    { &SynthParameters::volume_trim, LINEAR },
+    { &SynthParameters::detune, LOG },
+    { &SynthParameters::tune, LOG },
+    { &SynthParameters::output_level, LOG },
+    { &SynthParameters::vibrato, LINEAR },
+    { &SynthParameters::pwm_depth, LINEAR },
+    { &SynthParameters::velocity_sensitivity, LINEAR },
+    { &SynthParameters::lfo_inc, LOG },
+    { &SynthParameters::glide_rate, GLIDE },
+    { &SynthParameters::glide_bend, LINEAR },
+    { &SynthParameters::filter_lfo_depth, LINEAR },
+    { &SynthParameters::filter_attack, RATE },
+    { &SynthParameters::filter_decay, RATE },
+    { &SynthParameters::filter_sustain, LINEAR },
+    { &SynthParameters::filter_release, RATE },
+    { &SynthParameters::filter_env_depth, LINEAR },
+};
+
+namespace {
+    // Keeps the logs finite: a gain of 0, an envelope multiplier of 1 or "no glide".
+    constexpr float TINY = 1e-30f;
+}
+
+// The envelopes multiply by m = exp(-rate) every step, so log(-log(m)) is the log of the rate.
+// Glide moves by g = 1 - exp(-rate) of the way every tick, the same for 1 - g.
+float PresetMorph::encode(float value, Domain domain) {
+    switch (domain) {
+        case LOG:
+            return std::log(std::max(value, TINY));
+        case RATE:
+            return std::log(std::max(-std::log(value), TINY));
+        case GLIDE:
+            return std::log(std::max(-std::log(std::max(1.0f - value, TINY)), TINY));
+        default:
+            return value;
+    }
+}
+
+float PresetMorph::decode(float value, Domain domain) {
+    switch (domain) {
+        case LOG:
+            return std::exp(value);
+        case RATE:
+            return std::exp(-std::exp(value));
+        case GLIDE:
+            return 1.0f - std::exp(-std::exp(value));
+        default:
+            return value;
+    }
+}
+
+void PresetMorph::setPresets(const Preset* presets, int count) {
+    count_ = std::clamp(count, 0, MAX_PRESETS);
+    for (int i = 0; i < count_; ++i) {
+        std::copy(std::begin(presets[i].param), std::end(presets[i].param), presets_[size_t(i)].begin());
+    }
+    sample_rate_ = 0.0f;
+}
+
+void PresetMorph::prepare(float sample_rate) {
+    sample_rate_ = sample_rate;
+
+    float values[NUM_PARAMS];
+    for (int i = 0; i < count_; ++i) {
+        std::copy(presets_[size_t(i)].begin(), presets_[size_t(i)].end(), values);
+
+        SynthParameters& params = parameters_[size_t(i)];
+        params = SynthParameters();
+        params.update(values, 0xFFFFFFFF, sample_rate);
+
+        for (int s = 0; s < NUM_SETTINGS; ++s) {
+            encoded_[size_t(i)][size_t(s)] = encode(params.*settings[s].value, settings[s].domain);
+        }
+    }
+}
+
+void PresetMorph::evaluate(float position, SynthParameters& params) const {
+    jassert(count_ > 0 && sample_rate_ > 0.0f);
+
+    position = std::clamp(position, 0.0f, float(count_ - 1));
+    const int index = std::min(int(position), std::max(count_ - 2, 0));
+    const float t = position - float(index);
+
+    // Right on a preset, nothing to blend.
+    if (t == 0.0f || count_ == 1) {
+        params = parameters_[size_t(index)];
+        return;
+    }
+    if (t == 1.0f) {
+        params = parameters_[size_t(index + 1)];
+        return;
+    }
+
+    const auto& from = encoded_[size_t(index)];
+    const auto& to = encoded_[size_t(index + 1)];
+    float blended[NUM_SETTINGS];
+    for (int s = 0; s < NUM_SETTINGS; ++s) {
+        blended[s] = from[size_t(s)] + t * (to[size_t(s)] - from[size_t(s)]);
+    }
+
+    params = parameters_[size_t(t < 0.5f ? index : index + 1)];
+    for (int s = 0; s < NUM_SETTINGS; ++s) {
+        params.*settings[s].value = decode(blended[s], settings[s].domain);
+    }
+}
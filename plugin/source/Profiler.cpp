@@ -0,0 +1,132 @@
+#include "CX11Synth/Profiler.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Profiler {
+
+namespace {
+    struct Record {
+        uint32_t thread_id;
+        Event event;
+    };
+
+    struct Registry {
+        std::mutex lock;
+        std::vector<std::unique_ptr<ThreadLog>> logs;
+        std::vector<Record> trace;
+
+        // Two readings of the cycle counter and the clock, far enough apart to work out the
+        // counter's rate from.
+        const uint64_t start_ticks = now();
+        const std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+    };
+
+    Registry& registry() {
+        static Registry instance;
+        return instance;
+    }
+}
+
+const char* zoneName(Zone zone) {
+    switch (zone) {
+        case RENDER: return "render";
+        case MIDI: return "midi";
+        case LFO: return "lfo";
+        case ENVELOPE: return "envelope";
+        case OSCILLATOR: return "oscillator";
+        case FILTER: return "filter";
+        case MIXDOWN: return "mixdown";
+        case OUTPUT_GUARD: return "outputGuard";
+        case NUM_ZONES: break;
+    }
+    return "?";
+}
+
+ThreadLog& threadLog() {
+    thread_local ThreadLog* log = nullptr;
+
+    if (log == nullptr) {
+        Registry& r = registry();
+        const std::lock_guard<std::mutex> guard(r.lock);
+        r.logs.push_back(std::make_unique<ThreadLog>(uint32_t(r.logs.size() + 1)));
+        log = r.logs.back().get();
+    }
+
+    return *log;
+}
+
+void collect() {
+    if (!ENABLED) {
+        return;
+    }
+
+    Registry& r = registry();
+    const std::lock_guard<std::mutex> guard(r.lock);
+
+    for (auto& log : r.logs) {
+        const uint32_t id = log->thread_id;
+        log->drain([&r, id](const Event& event) { r.trace.push_back({ id, event }); });
+    }
+}
+
+double ticksPerSecond() {
+    const Registry& r = registry();
+
+    // Measured against the clock since the registry was set up, which is at the first zone at the
+    // latest. Wait a little if that was only just now, a short interval gives a poor estimate.
+    if (std::chrono::steady_clock::now() - r.start_time < std::chrono::milliseconds(10)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    const uint64_t ticks = now();
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - r.start_time).count();
+    return double(ticks - r.start_ticks) / seconds;
+}
+
+uint64_t writeChromeTrace(std::ostream& stream) {
+    collect();
+
+    const double ticks_per_us = ticksPerSecond() / 1e6;
+
+    Registry& r = registry();
+    const std::lock_guard<std::mutex> guard(r.lock);
+
+    uint64_t first = UINT64_MAX;
+    for (const Record& record : r.trace) {
+        first = std::min(first, record.event.start);
+    }
+
+    // Complete events ("ph":"X") nest by time on each thread, which is how the zones nest. Times
+    // are in microseconds, fixed point so a long render doesn't lose the nanoseconds.
+    const std::ios_base::fmtflags flags = stream.flags();
+    const std::streamsize precision = stream.precision();
+    stream << std::fixed << std::setprecision(3);
+
+    stream << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+    for (size_t i = 0; i < r.trace.size(); ++i) {
+        const Record& record = r.trace[i];
+        const double ts = double(record.event.start - first) / ticks_per_us;
+        const double dur = double(record.event.end - record.event.start) / ticks_per_us;
+        stream << (i == 0 ? "" : ",\n") << "{\"name\":\"" << zoneName(record.event.zone)
+               << "\",\"cat\":\"synth\",\"ph\":\"X\",\"pid\":1,\"tid\":" << record.thread_id
+               << ",\"ts\":" << ts << ",\"dur\":" << dur << "}";
+    }
+    stream << "\n]}\n";
+    stream.flags(flags);
+    stream.precision(precision);
+
+    uint64_t dropped = 0;
+    for (const auto& log : r.logs) {
+        dropped += log->dropped();
+    }
+
+    r.trace.clear();
+    return dropped;
+}
+
+}  // namespace Profiler
@@ -0,0 +1,63 @@
+#include "CX11Synth/RealtimeLog.h"
+
+#include <cstdlib>
+#include <iostream>
+
+namespace {
+    constexpr int WRITE_INTERVAL_MS = 50;
+}
+
+RealtimeLog::Writer::Writer() : juce::Thread("CX11 log writer") {
+    if (const char* path = std::getenv("CX11_LOG_FILE"); path != nullptr && *path != '\0') {
+        file_ = std::make_unique<juce::FileOutputStream>(juce::File::getCurrentWorkingDirectory().getChildFile(path));
+        if (file_->failedToOpen()) {
+            std::cerr << "can't open log file " << path << ", logging to stdout\n";
+            file_.reset();
+        }
+    }
+
+    startThread(juce::Thread::Priority::background);
+}
+
+RealtimeLog::Writer::~Writer() {
+    stopThread(1000);
+    writeAll(); // whatever came in since the last pass
+}
+
+void RealtimeLog::Writer::run() {
+    while (!threadShouldExit()) {
+        writeAll();
+        wait(WRITE_INTERVAL_MS);
+    }
+}
+
+void RealtimeLog::Writer::writeAll() {
+    RealtimeLog& log = RealtimeLog::shared();
+
+    const auto write = [this](const char* text) {
+        if (file_ != nullptr) {
+            *file_ << text << juce::newLine;
+        } else {
+            std::cout << text << "\n";
+        }
+        DBG(text);
+    };
+
+    int count = log.drain(write);
+
+    const uint64_t dropped = log.dropped();
+    if (dropped != reported_dropped_) {
+        const juce::String message = juce::String(dropped - reported_dropped_) + " log messages dropped";
+        write(message.toRawUTF8());
+        reported_dropped_ = dropped;
+        ++count;
+    }
+
+    if (count > 0) {
+        if (file_ != nullptr) {
+            file_->flush();
+        } else {
+            std::cout.flush();
+        }
+    }
+}
@@ -1,37 +1,230 @@
 #include "CX11Synth/Synth.h"
-#include "CX11Synth/Utils.h"
+#include "CX11Synth/Profiler.h"
+#include <limits>
 
 
 
 static const float ANALOG = 0.002f;
 static const int SUSTAIN = -1;
 
+namespace {
+    // Note-on/off, sustain pedal and all-notes-off/reset. These change which voices are sounding,
+    // so render() splits the block at them. Everything else is a controller.
+    bool startsOrStopsVoices(uint8_t data0, uint8_t data1) {
+        switch (data0 & 0xF0) {
+            case 0x80:
+            case 0x90:
+                return true;
+            case 0xB0:
+                return data1 == 0x40 || data1 >= 0x78;
+            default:
+                return false;
+        }
+    }
+
+    // Runs one voice's oscillators for sample_count samples into its lane of the bank, from a
+    // local copy so the phase and resonator state stay in registers. Without OSC2 the second
+    // oscillator is silent (osc_mix was 0 when the note started) and isn't run at all.
+    template <bool OSC2, typename Osc>
+    JUCE_FORCE_INLINE void renderOscillators(Osc& voice_osc1, Osc& voice_osc2, VoiceBank& bank, int v, int sample_count) {
+        Osc osc1 = voice_osc1;
+        Osc osc2 = voice_osc2;
+
+        for (int sample = 0; sample < sample_count; ++sample) {
+            bank.osc1[sample][v] = osc1.next_sample();
+            if constexpr (OSC2) {
+                bank.osc2[sample][v] = osc2.next_sample();
+            }
+        }
+
+        voice_osc1 = osc1;
+        voice_osc2 = osc2;
+    }
+
+    // The second oscillator's level comes from osc_mix when the note starts, at 0 it's silent.
+    template <typename Osc>
+    bool hasOsc2(const Osc& osc2) {
+        return osc2.amplitude != 0.0f;
+    }
+
+    template <bool OSC2, typename Osc>
+    JUCE_FORCE_INLINE void renderVoiceOscillators(Osc& osc1, Osc& osc2, VoiceBank& bank, int v, int sample_count) {
+        if (!OSC2) {
+            renderOscillators<false>(osc1, osc2, bank, v, sample_count);
+        } else if (hasOsc2(osc2)) {
+            renderOscillators<true>(osc1, osc2, bank, v, sample_count);
+        } else {
+            // A bank with OSC2 still has to see zeros in the lanes that don't use it.
+            renderOscillators<false>(osc1, osc2, bank, v, sample_count);
+            for (int sample = 0; sample < sample_count; ++sample) {
+                bank.osc2[sample][v] = 0.0f;
+            }
+        }
+    }
+
+    // Renders one control-rate chunk (at most LFO_MAX samples) of the voice bank into bank.output.
+    // The oscillators branch a lot, so they don't go into lanes. Instead each voice runs its own
+    // oscillators across the chunk, see renderOscillators().
+    //
+    // Compiled once per combination of the traits (see Synth::RenderTraits), so a patch that
+    // doesn't use the second oscillator or the noise doesn't pay for them sample by sample.
+    template <bool OSC2, bool NOISE>
+    JUCE_FORCE_INLINE void renderChunkImpl(VoiceBank& bank, Voice* const* voices, const float* noise, int sample_count) {
+        {
+            CX11_PROFILE_ZONE(ENVELOPE);
+            bank.renderEnvelopes(sample_count);
+        }
+
+        {
+            CX11_PROFILE_ZONE(OSCILLATOR);
+            for (int v = 0; v < VoiceBank::LANES; ++v) {
+                const int active = bank.active_samples[v];
+                if (active > 0) {
+                    Voice& voice = *voices[v];
+                    if (voice.wavetable) {
+                        voice.syncWavetables();
+                        renderVoiceOscillators<OSC2>(voice.wavetable1, voice.wavetable2, bank, v, active);
+                    } else {
+                        renderVoiceOscillators<OSC2>(voice.osc1, voice.osc2, bank, v, active);
+                    }
+                }
+
+                for (int sample = active; sample < sample_count; ++sample) {
+                    bank.osc1[sample][v] = 0.0f;
+                    if constexpr (OSC2) {
+                        bank.osc2[sample][v] = 0.0f;
+                    }
+                }
+            }
+        }
+
+        CX11_PROFILE_ZONE(FILTER);
+        bank.renderFilters<OSC2, NOISE>(noise, sample_count);
+    }
+
+    template <bool OSC2, bool NOISE>
+    void renderChunkDefault(VoiceBank& bank, Voice* const* voices, const float* noise, int sample_count) {
+        renderChunkImpl<OSC2, NOISE>(bank, voices, noise, sample_count);
+    }
+
+#if JUCE_INTEL && (JUCE_GCC || JUCE_CLANG)
+    // Same code, compiled for AVX so the 8 lanes fit in one register. GCC also needs AVX to
+    // vectorize the lane loops at all (SSE has no quiet compare, so with the default -ftrapping-math
+    // it keeps them scalar). FMA is deliberately not enabled: contracting a * b + c changes the
+    // rounding and the output would no longer match the scalar build.
+    template <bool OSC2, bool NOISE>
+    __attribute__((target("avx")))
+    void renderChunkAVX(VoiceBank& bank, Voice* const* voices, const float* noise, int sample_count) {
+        renderChunkImpl<OSC2, NOISE>(bank, voices, noise, sample_count);
+    }
+#endif
+
+    // Output level and the final copy into the host's buffers, one loop for stereo and one for
+    // mono instead of a branch per sample.
+    template <bool STEREO>
+    void writeOutput(float* output_buffer_left, float* output_buffer_right, const float* mix_left,
+                     const float* mix_right, juce::LinearSmoothedValue<float>& output_level_smoother,
+                     int sample_count) {
+        if (mix_left == nullptr) {
+            // No banks, silence. The smoother still moves on, one step at a time so it ends up
+            // exactly where it would have (skip() rounds differently).
+            juce::FloatVectorOperations::clear(output_buffer_left, sample_count);
+            if constexpr (STEREO) {
+                juce::FloatVectorOperations::clear(output_buffer_right, sample_count);
+            }
+            for (int sample = 0; sample < sample_count; ++sample) {
+                output_level_smoother.getNextValue();
+            }
+            return;
+        }
+
+        for (int sample = 0; sample < sample_count; ++sample) {
+            float output_level = output_level_smoother.getNextValue();
+            float output_left = mix_left[sample] * output_level;
+            float output_right = mix_right[sample] * output_level;
+
+            if constexpr (STEREO) {
+                output_buffer_left[sample] = output_left;
+                output_buffer_right[sample] = output_right;
+            } else {
+                output_buffer_left[sample] = (output_left + output_right) * 0.5f;
+            }
+        }
+    }
+}
+
 //namespace audio_plugin {
 Synth::Synth() {
     sample_rate = 44100.0f;
+    note_voices_.fill(NO_VOICE);
+
+    render_chunks_ = { renderChunkDefault<false, false>, renderChunkDefault<true, false>,
+                       renderChunkDefault<false, true>, renderChunkDefault<true, true> };
+#if JUCE_INTEL && (JUCE_GCC || JUCE_CLANG)
+    if (juce::SystemStats::hasAVX()) {
+        render_chunks_ = { renderChunkAVX<false, false>, renderChunkAVX<true, false>,
+                           renderChunkAVX<false, true>, renderChunkAVX<true, true> };
+    }
+#endif
 }
 
-void Synth::allocate_resources(double sample_rate_, int /*samples_per_block*/) {
+void Synth::allocate_resources(double sample_rate_, int samples_per_block) {
     sample_rate = static_cast<float>(sample_rate_);
 
-    for (int v = 0; v < MAX_VOICES; ++v) {
-        voices_[v].filter.sample_rate = sample_rate;
+    // Whole banks only, anything else would leave lanes that can never be used.
+    const int lanes = VoiceBank::LANES;
+    const int capacity = std::clamp((voice_capacity + lanes - 1) / lanes * lanes, lanes, MAX_VOICES);
+    const int num_banks = capacity / lanes;
+
+    voices_.resize(capacity);
+    for (Voice& voice : voices_) {
+        voice.filter.sample_rate = sample_rate;
     }
+
+    banks_.resize(num_banks);
+    bank_voices_.resize(capacity);
+    active_voices_.reserve(capacity);
+    next_voice_.resize(capacity);
+    resetVoices();
+
+    // The first chunk of a block can be the tail end of an LFO step, hence the + 2.
+    max_block_size_ = std::max(samples_per_block, 1);
+    lfo_chunks_.resize(max_block_size_ / LFO_MAX + 2);
+    noise_buffer_.resize(max_block_size_);
+    noise_mix_buffer_.resize(max_block_size_);
+    bank_left_.resize(num_banks * max_block_size_);
+    bank_right_.resize(num_banks * max_block_size_);
+
+    // The tick ramps take one step per LFO tick, so they need fewer steps for the same time.
+    const int ramp_samples = std::max(int(std::round(RAMP_TIME * sample_rate)), 1);
+    const int ramp_ticks = std::max(int(std::round(RAMP_TIME * sample_rate / float(LFO_MAX))), 1);
+    noise_mix_ramp_.prepare(ParameterRamp::LINEAR, ramp_samples);
+    vibrato_ramp_.prepare(ParameterRamp::LINEAR, ramp_ticks);
+    pwm_depth_ramp_.prepare(ParameterRamp::LINEAR, ramp_ticks);
+    filter_lfo_depth_ramp_.prepare(ParameterRamp::LINEAR, ramp_ticks);
+    filter_q_ramp_.prepare(ParameterRamp::EXPONENTIAL, ramp_ticks);
+    filter_env_depth_ramp_.prepare(ParameterRamp::LINEAR, ramp_ticks);
+    detune_ramp_.prepare(ParameterRamp::EXPONENTIAL, ramp_ticks);
+    ramps_started_ = false;
+
+    pool_.start(render_threads);
 }
 
 void Synth::deallocate_resources() {
-
+    pool_.stop();
 }
 
 void Synth::reset() {
-        for (int v = 0; v < MAX_VOICES; ++v) {
-        voices_[v].reset();
-    }
+    resetVoices();
+
+    num_events_ = 0;
+    next_event_ = 0;
 
     sustained_pedal_pressed = false;
     pressure = 0.0f;
     lfo_phase = 0.0f;
     lfo_step = 0;
+    ramps_started_ = false;
     last_note = 0;
     mod_wheel = 0.0f;
     filter_ctrl= 0.0f;
@@ -45,32 +238,317 @@ void Synth::reset() {
 }
 
 void Synth::render(float** output_buffers, int sample_count) {
+    CX11_PROFILE_ZONE(RENDER);
+
     float* output_buffer_left = output_buffers[0];
     float* output_buffer_right = output_buffers[1];
 
-    for (int v = 0; v < MAX_VOICES; ++v) {
+    // Only events that start or stop voices split the block, controllers are picked up by the
+    // LFO ticks inside renderSegment().
+    for (int offset = 0; offset < sample_count;) {
+        applyEvents(offset);
+        const int end = nextVoiceEvent(sample_count);
+
+        block_position_ = offset;
+        renderSegment(output_buffer_left + offset,
+                      output_buffer_right != nullptr ? output_buffer_right + offset : nullptr,
+                      end - offset);
+        offset = end;
+    }
+
+    // Anything the host put past the end of the block still counts.
+    applyEvents(std::numeric_limits<int>::max());
+    num_events_ = 0;
+    next_event_ = 0;
+    block_position_ = 0;
+}
+
+bool Synth::queueMidiMessage(int sample_position, uint8_t data0, uint8_t data1, uint8_t data2) {
+    if (num_events_ == MAX_EVENTS) {
+        return false;
+    }
+
+    // Out of order events would be skipped by applyEvents(), play them late instead.
+    jassert(num_events_ == 0 || sample_position >= events_[num_events_ - 1].position);
+    if (num_events_ > 0) {
+        sample_position = std::max(sample_position, events_[num_events_ - 1].position);
+    }
+
+    events_[num_events_++] = { std::max(sample_position, 0), data0, data1, data2 };
+    return true;
+}
+
+void Synth::applyEvents(int position) {
+    // Checked first so a block without MIDI doesn't fill the trace with empty zones.
+    if (next_event_ == num_events_ || events_[next_event_].position > position) {
+        return;
+    }
+
+    CX11_PROFILE_ZONE(MIDI);
+    while (next_event_ < num_events_ && events_[next_event_].position <= position) {
+        const MidiEvent& event = events_[next_event_++];
+        midi_message(event.data0, event.data1, event.data2);
+    }
+}
+
+int Synth::nextVoiceEvent(int sample_count) const {
+    for (int e = next_event_; e < num_events_ && events_[e].position < sample_count; ++e) {
+        if (startsOrStopsVoices(events_[e].data0, events_[e].data1)) {
+            return events_[e].position;
+        }
+    }
+    return sample_count;
+}
+
+void Synth::renderSegment(float* output_buffer_left, float* output_buffer_right, int sample_count) {
+    updateRamps();
+
+    // Idle fast path, nothing to render.
+    if (isSilent() && !reference_render) {
+        skip(sample_count);
+        juce::FloatVectorOperations::clear(output_buffer_left, sample_count);
+        if (output_buffer_right != nullptr) {
+            juce::FloatVectorOperations::clear(output_buffer_right, sample_count);
+        }
+        return;
+    }
+
+    for (int v : active_voices_) {
+        Voice& voice = voices_[v];
+
+        // NOTE:
+        // Synth and Voice share a lot of data. This can potentially be put into a Struct
+        // and the Voice can track a pointer to that struct upon constuction. DON'T USE GLOBAlS.
+        // Another idea is to have Voice hold a pointer back to Synth ... I don't like that approach
+        updatePeriod(voice, pitch_bend, detune_ramp_.getValue());
+        voice.glide_rate = glide_rate;
+        voice.filter_q = filter_q_ramp_.getValue() * resonance_ctrl;
+        voice.pitch_bend = pitch_bend;
+        voice.filter_env_depth = filter_env_depth_ramp_.getValue();
+    }
+
+    if (reference_render) {
+        renderReference(output_buffer_left, output_buffer_right, sample_count);
+    } else {
+        // Hosts are allowed to send bigger blocks than they announced in prepareToPlay.
+        jassert(max_block_size_ > 0);
+        const int segment_position = block_position_;
+        for (int offset = 0; offset < sample_count; offset += max_block_size_) {
+            const int block_size = std::min(max_block_size_, sample_count - offset);
+            block_position_ = segment_position + offset;
+            renderBlocks(output_buffer_left + offset,
+                         output_buffer_right != nullptr ? output_buffer_right + offset : nullptr,
+                         block_size);
+        }
+    }
+
+    // Drop the voices that went quiet during this block.
+    int num_active = 0;
+    for (int v : active_voices_) {
         Voice& voice = voices_[v];
         if (voice.env.isActive()) {
-            // NOTE:
-            // Synth and Voice share a lot of data. This can potentially be put into a Struct
-            // and the Voice can track a pointer to that struct upon constuction. DON'T USE GLOBAlS.
-            // Another idea is to have Voice hold a pointer back to Synth ... I don't like that approach
-            updatePeriod(voice);
-            voice.glide_rate = glide_rate;
-            voice.filter_q = filter_q * resonance_ctrl;
-            voice.pitch_bend = pitch_bend;
-            voice.filter_env_depth = filter_env_depth;
+            active_voices_[num_active++] = v;
+        } else {
+            voice.env.reset();
+            voice.filter.reset();
         }
     }
+    active_voices_.resize(num_active);
+}
+
+// Moves the synth forward by sample_count samples of silence. With no voices the only state that
+// changes is the LFO (its filter smoothing carries over into the next note), the noise generator
+// and the output level smoother, so those are fast-forwarded instead of rendered.
+void Synth::skip(int sample_count) {
+    jassert(isSilent());
+
+    for (int remaining = sample_count; remaining > 0;) {
+        if (lfo_step <= 1) {
+            applyEvents(block_position_ + sample_count - remaining);
+        }
+
+        advanceLFO();
+        int chunk = std::min(lfo_step, remaining);
+        lfo_step -= chunk - 1;
+        remaining -= chunk;
+    }
+
+    noise_gen.skip(sample_count);
+    noise_mix_ramp_.skip(sample_count);
+    output_level_smoother.skip(sample_count);
+}
+
+void Synth::renderBlocks(float* output_buffer_left, float* output_buffer_right, int sample_count) {
+    // Split the buffer on LFO ticks. Nothing changes the filter coefficients between two ticks,
+    // so each chunk can be rendered from the bank without going back to the voices. The LFO and
+    // the noise are shared by all voices, so they're worked out up front for the whole block.
+    num_chunks_ = 0;
+    for (int offset = 0; offset < sample_count;) {
+        // Controllers that came in since the last tick are applied right before the next one.
+        if (lfo_step <= 1) {
+            applyEvents(block_position_ + offset);
+        }
+
+        CX11_PROFILE_ZONE(LFO);
+        LFOChunk& chunk = lfo_chunks_[num_chunks_++];
+        chunk.tick = advanceLFO();
+        chunk.offset = offset;
+        chunk.length = std::min(lfo_step, sample_count - offset);
+        chunk.modulation = currentModulation();
+
+        lfo_step -= chunk.length - 1;
+        offset += chunk.length;
+    }
+
+    // Most patches don't use the noise at all. Then there's nothing to mix in, but the generator
+    // still has to end up where it would have been.
+    noise_on_ = noise_mix_ramp_.isMoving() || noise_mix_ramp_.getValue() != 0.0f;
+    if (noise_mix_ramp_.isMoving()) {
+        CX11_PROFILE_ZONE(FILTER);
+        noise_mix_ramp_.fill(noise_mix_buffer_.data(), sample_count);
+        for (int sample = 0; sample < sample_count; ++sample) {
+            noise_buffer_[sample] = noise_gen.next_value() * noise_mix_buffer_[sample];
+        }
+    } else if (noise_on_) {
+        CX11_PROFILE_ZONE(FILTER);
+        const float mix = noise_mix_ramp_.getValue();
+        for (int sample = 0; sample < sample_count; ++sample) {
+            noise_buffer_[sample] = noise_gen.next_value() * mix;
+        }
+    } else {
+        noise_gen.skip(sample_count);
+    }
+
+    // Pack the sounding voices into as few banks as possible, in voice order. Notes only start
+    // between segments (see render()), so nothing joins the list halfway through the block.
+    const int num_active = int(active_voices_.size());
+    num_banks_ = (num_active + VoiceBank::LANES - 1) / VoiceBank::LANES;
+
+    for (int lane = 0; lane < num_banks_ * VoiceBank::LANES; ++lane) {
+        bank_voices_[lane] = lane < num_active ? &voices_[active_voices_[lane]] : nullptr;
+    }
 
+    // Which kernel each bank runs with. The second oscillator's level is set when a note starts,
+    // so this holds for the whole block.
+    for (int b = 0; b < num_banks_; ++b) {
+        bool osc2 = false;
+        for (int v = b * VoiceBank::LANES; v < (b + 1) * VoiceBank::LANES; ++v) {
+            osc2 = osc2 || (bank_voices_[v] != nullptr && hasOsc2(bank_voices_[v]->osc2));
+        }
+        bank_kernels_[b] = render_chunks_[kernelIndex({ osc2, noise_on_ })];
+    }
+
+    // Handing out one bank isn't worth waking anybody up for.
+    if (num_banks_ > 1 && pool_.size() > 0) {
+        pool_.run(renderBankJob, this, num_banks_);
+    } else {
+        for (int b = 0; b < num_banks_; ++b) {
+            renderBank(b);
+        }
+    }
+
+    // Sum the banks into the first one. Always in bank order, whichever thread rendered them, so
+    // the multi-threaded output is the same as the single-threaded one down to the last bit.
+    // (With more than one bank this is a different summation order than renderReference(), so
+    // those two can differ in the last bit.)
+    CX11_PROFILE_ZONE(MIXDOWN);
+    const float* mix_left = nullptr;
+    const float* mix_right = nullptr;
+
+    if (num_banks_ > 0) {
+        float* left = bank_left_.data();
+        float* right = bank_right_.data();
+
+        for (int b = 1; b < num_banks_; ++b) {
+            juce::FloatVectorOperations::add(left, bank_left_.data() + b * max_block_size_, sample_count);
+            juce::FloatVectorOperations::add(right, bank_right_.data() + b * max_block_size_, sample_count);
+        }
+
+        mix_left = left;
+        mix_right = right;
+    }
+
+    if (output_buffer_right != nullptr) {
+        writeOutput<true>(output_buffer_left, output_buffer_right, mix_left, mix_right, output_level_smoother, sample_count);
+    } else {
+        writeOutput<false>(output_buffer_left, nullptr, mix_left, mix_right, output_level_smoother, sample_count);
+    }
+}
+
+// Renders the whole block for the voices in bank b into its row of bank_left_/bank_right_.
+// Only touches that bank's voices, so banks can be rendered on different threads.
+void Synth::renderBank(int b) {
+    VoiceBank& bank = banks_[b];
+    Voice* const* voices = bank_voices_.data() + b * VoiceBank::LANES;
+    float* output_left = bank_left_.data() + b * max_block_size_;
+    float* output_right = bank_right_.data() + b * max_block_size_;
+
+    for (int c = 0; c < num_chunks_; ++c) {
+        const LFOChunk& chunk = lfo_chunks_[c];
+
+        if (chunk.tick) {
+            CX11_PROFILE_ZONE(LFO);
+            for (int v = 0; v < VoiceBank::LANES; ++v) {
+                if (voices[v] != nullptr && voices[v]->env.isActive()) {
+                    applyLFO(*voices[v], chunk.modulation);
+                }
+            }
+        }
+
+        for (int v = 0; v < VoiceBank::LANES; ++v) {
+            if (voices[v] != nullptr) {
+                bank.load(v, *voices[v]);
+            } else {
+                bank.clear(v);
+            }
+        }
+
+        bank_kernels_[b](bank, voices, noise_buffer_.data() + chunk.offset, chunk.length);
+
+        for (int v = 0; v < VoiceBank::LANES; ++v) {
+            if (voices[v] != nullptr) {
+                bank.store(v, *voices[v]);
+            }
+        }
+
+        // Pan and mix. Voices are added one after the other, so every output sample is summed in
+        // the same order as the reference loop and the result is bit-identical on x86. Hosts where
+        // FloatVectorOperations goes through a fused multiply-add (Accelerate on macOS) can be off
+        // by the last bit of the mantissa, nothing audible.
+        CX11_PROFILE_ZONE(MIXDOWN);
+        float* left = output_left + chunk.offset;
+        float* right = output_right + chunk.offset;
+        juce::FloatVectorOperations::clear(left, chunk.length);
+        juce::FloatVectorOperations::clear(right, chunk.length);
+
+        for (int v = 0; v < VoiceBank::LANES; ++v) {
+            if (bank.active_samples[v] > 0) {
+                juce::FloatVectorOperations::addWithMultiply(left, bank.output[v], bank.pan_left[v], chunk.length);
+                juce::FloatVectorOperations::addWithMultiply(right, bank.output[v], bank.pan_right[v], chunk.length);
+            }
+        }
+    }
+}
+
+void Synth::renderBankJob(void* context, int index) {
+    static_cast<Synth*>(context)->renderBank(index);
+}
+
+// The original per-sample loop. Every voice is visited for every sample through Voice::render().
+// Much slower than renderBlocks() but easy to follow, so it's kept around to A/B the block renderer.
+void Synth::renderReference(float* output_buffer_left, float* output_buffer_right, int sample_count) {
     for (int sample = 0; sample < sample_count; ++sample) {
+        if (lfo_step <= 1) {
+            applyEvents(block_position_ + sample);
+        }
+
         updateLFO();
-        float noise = noise_gen.next_value() * noise_mix;
+        float noise = noise_gen.next_value() * noise_mix_ramp_.next();
 
         float output_left = 0.0f;
         float output_right = 0.0f;
 
-        for (int v = 0; v < MAX_VOICES; ++v) {
+        for (int v : active_voices_) {
             Voice& voice = voices_[v];
             if (voice.env.isActive()) {
                 float output = voice.render(noise);
@@ -86,52 +564,105 @@ void Synth::render(float** output_buffers, int sample_count) {
         if (output_buffer_right != nullptr) {
             output_buffer_left[sample] = output_left;
             output_buffer_right[sample] = output_right;
-        } else {            
-            output_buffer_left[sample] = (output_left + output_right) * 0.5f;;
+        } else {
+            output_buffer_left[sample] = (output_left + output_right) * 0.5f;
         }
     }
+}
 
-    for (int v = 0; v < MAX_VOICES; ++v) {
-        Voice& voice = voices_[v];
-        if (!voice.env.isActive()) {
-            voice.env.reset();
-            voice.filter.reset();
+void Synth::updateLFO() {
+    if (advanceLFO()) {
+        for (int v : active_voices_) {
+            Voice& voice = voices_[v];
+            if (voice.env.isActive()) {
+                applyLFO(voice, currentModulation());
+            }
         }
     }
-
-    protectYourEars(output_buffer_left, sample_count);
-    protectYourEars(output_buffer_right, sample_count);
 }
 
-void Synth::updateLFO() {
-    if (--lfo_step <= 0) {
-        lfo_step = LFO_MAX;
-        lfo_phase += lfo_inc;
+// Steps the LFO by one sample. Returns true on a tick, i.e. when the voices need the new values.
+bool Synth::advanceLFO() {
+    if (--lfo_step > 0) {
+        return false;
+    }
 
-        if (lfo_phase > PI){
-            lfo_phase -= TAU;
-        }
+    lfo_step = LFO_MAX;
+    lfo_phase += lfo_inc;
 
-        const float sine = std::sin(lfo_phase);
-        float vibrato_mod = 1.0f + sine * (mod_wheel + vibrato);
-        float pwm = 1.0f + sine * (mod_wheel + pwm_depth);
-        float filter_mod = filter_key_tracking + filter_ctrl + (filter_lfo_depth + pressure) * sine;
-        
-        // one-pole filter to make filter mod transitions exponentially smooth
-        // 0.005 coefficient is sample-rate dependent
-        filter_zip += 0.005f * (filter_mod - filter_zip); 
+    if (lfo_phase > PI){
+        lfo_phase -= TAU;
+    }
 
-        for (int v = 0; v < MAX_VOICES; ++v) {
-            Voice& voice = voices_[v];
-            if (voice.env.isActive()) {
-                voice.osc1.modulation = vibrato_mod;
-                voice.osc2.modulation = pwm;
-                voice.filter_mod = filter_zip;
-                voice.update_LFO();
-                updatePeriod(voice);
-            }
-        }
+    const float sine = SynthMath::sin(lfo_phase);
+    if (tick_ramps_moving_) {
+        stepTickRamps();
     }
+
+    vibrato_mod_ = 1.0f + sine * (mod_wheel + vibrato_ramp_.getValue());
+    pwm_ = 1.0f + sine * (mod_wheel + pwm_depth_ramp_.getValue());
+    float filter_mod = filter_key_tracking + filter_ctrl + (filter_lfo_depth_ramp_.getValue() + pressure) * sine;
+
+    // one-pole filter to make filter mod transitions exponentially smooth
+    // 0.005 coefficient is sample-rate dependent
+    filter_zip += 0.005f * (filter_mod - filter_zip);
+    return true;
+}
+
+Synth::Modulation Synth::currentModulation() const {
+    return { vibrato_mod_, pwm_, filter_zip, pitch_bend, filter_q_ramp_.getValue() * resonance_ctrl,
+             filter_env_depth_ramp_.getValue(), detune_ramp_.getValue() };
+}
+
+void Synth::updateRamps() {
+    if (!ramps_started_) {
+        noise_mix_ramp_.jump(noise_mix);
+        vibrato_ramp_.jump(vibrato);
+        pwm_depth_ramp_.jump(pwm_depth);
+        filter_lfo_depth_ramp_.jump(filter_lfo_depth);
+        filter_q_ramp_.jump(filter_q);
+        filter_env_depth_ramp_.jump(filter_env_depth);
+        detune_ramp_.jump(detune);
+        ramps_started_ = true;
+        return;
+    }
+
+    noise_mix_ramp_.setTarget(noise_mix);
+    vibrato_ramp_.setTarget(vibrato);
+    pwm_depth_ramp_.setTarget(pwm_depth);
+    filter_lfo_depth_ramp_.setTarget(filter_lfo_depth);
+    filter_q_ramp_.setTarget(filter_q);
+    filter_env_depth_ramp_.setTarget(filter_env_depth);
+    detune_ramp_.setTarget(detune);
+
+    tick_ramps_moving_ = tickRampsMoving();
+}
+
+bool Synth::tickRampsMoving() const {
+    return vibrato_ramp_.isMoving() || pwm_depth_ramp_.isMoving() || filter_lfo_depth_ramp_.isMoving()
+        || filter_q_ramp_.isMoving() || filter_env_depth_ramp_.isMoving() || detune_ramp_.isMoving();
+}
+
+void Synth::stepTickRamps() {
+    vibrato_ramp_.next();
+    pwm_depth_ramp_.next();
+    filter_lfo_depth_ramp_.next();
+    filter_q_ramp_.next();
+    filter_env_depth_ramp_.next();
+    detune_ramp_.next();
+
+    tick_ramps_moving_ = tickRampsMoving();
+}
+
+void Synth::applyLFO(Voice& voice, const Modulation& modulation) {
+    voice.osc1.modulation = modulation.vibrato_mod;
+    voice.osc2.modulation = modulation.pwm;
+    voice.filter_mod = modulation.filter_mod;
+    voice.pitch_bend = modulation.pitch_bend;
+    voice.filter_q = modulation.filter_q;
+    voice.filter_env_depth = modulation.filter_env_depth;
+    voice.update_LFO();
+    updatePeriod(voice, modulation.pitch_bend, modulation.detune);
 }
 
 void Synth::midi_message(uint8_t data0, uint8_t data1, uint8_t data2) {
@@ -179,23 +710,26 @@ void Synth::startVoice(int v, int note, int velocity) {
         }
     }
 
-    voice.period = period * std::pow(1.059463094359f, float(note_distance) - glide_bend);
+    voice.period = period * SynthMath::semitoneRatio(float(note_distance) - glide_bend);
     if (voice.period < 6.0f) { voice.period = 6.0f; }
 
     last_note = note;
-    voice.note = note;
+    setVoiceNote(v, note);
     voice.updatePanning();
 
     float velocity_curve = 0.004f * float((velocity + 64) * (velocity + 64)) - 8.0f;
     voice.osc1.amplitude = volume_trim * velocity_curve;
     voice.osc2.amplitude = voice.osc1.amplitude * osc_mix;
+    voice.wavetable = (osc_engine == 1);
 
     if (vibrato == 0.0f && pwm_depth > 0.0f) {
         voice.osc2.squareWave(voice.osc1, voice.period);
+        voice.syncWavetables();
+        voice.wavetable2.squareWave(voice.wavetable1, voice.period);
     }
 
     voice.cutoff = sample_rate / (period * PI);
-    voice.cutoff *= std::exp(velocity_sensitivity * float(velocity - 64));
+    voice.cutoff *= SynthMath::exp(velocity_sensitivity * float(velocity - 64));
 
     // OPTIONAL: Resetting the phase on notes between the oscillators changes the way the notes sound
     // when you play the same thing repeatedly. See which one sounds better.
@@ -215,14 +749,29 @@ void Synth::startVoice(int v, int note, int velocity) {
     filter_env.sustain_level = filter_sustain;
     filter_env.release_multiplier = filter_release;
     filter_env.attack();
+
+    activateVoice(v);
 }
 
 // Finds a voice to use that has the lowest level and is not in attack portion of the envelope.
 int Synth::findFreeVoice() const {
+    // Silent voices are always the quietest, so take the first one that isn't in the (sorted)
+    // active list.
     int v = 0;
+    for (int i : active_voices_) {
+        if (i != v) { break; }
+        ++v;
+    }
+
+    if (v < getVoiceCapacity()) {
+        return v;
+    }
+
+    // All of them are sounding, steal one.
+    v = 0;
     float l = 100.0f; // louder than any envelope;
 
-    for (int i = 0; i < MAX_VOICES; ++i) {
+    for (int i : active_voices_) {
         if (voices_[i].env.level < l && !voices_[i].env.isInAttack()) {
             l = voices_[i].env.level;
             v = i;
@@ -244,7 +793,7 @@ void Synth::noteOn(int note, int velocity) {
             return;
         }
     } else {
-        // Polyphonic, num_voices will either be 0 or 8 (MAX_VOICES)
+        // Polyphonic, num_voices is the voice capacity
         v = findFreeVoice();
     }
 
@@ -260,14 +809,15 @@ void Synth::noteOff(int note) {
         }
     }
 
-    for (int v = 0; v < MAX_VOICES; v++) {
-        if (voices_[v].note == note) {
-            if (sustained_pedal_pressed) {
-                voices_[v].note = SUSTAIN;
-            } else {
-                voices_[v].release();
-                voices_[v].note = 0;
-            }
+    // Moving a voice to another note takes it off this note's list, so keep taking the first one.
+    const int list = (note == SUSTAIN) ? SUSTAIN_LIST : note;
+    while (note_voices_[list] != NO_VOICE) {
+        int v = note_voices_[list];
+        if (sustained_pedal_pressed && note != SUSTAIN) {
+            setVoiceNote(v, SUSTAIN);
+        } else {
+            voices_[v].release();
+            setVoiceNote(v, 0);
         }
     }
 }
@@ -294,9 +844,7 @@ void Synth::controlChange(uint8_t data1, uint8_t data2) {
             break;
         default:
             if (data1 >= 0x78) {
-                for (int v = 0; v < MAX_VOICES; ++v) {
-                    voices_[v].reset();
-                }
+                resetVoices();
                 sustained_pedal_pressed = false;            
             }
             break;
@@ -309,7 +857,9 @@ void Synth::controlChange(uint8_t data1, uint8_t data2) {
 
 float Synth::calcPeriod(int v, int note) const {
     // Adding the analog constant keeps it ever so slightly out of tune.
-    float period = tune * std::exp(-0.05776226505f * (float(note) + ANALOG * float(v)));
+    // Only the position within a bank counts, otherwise the top voices of a big voice pool would
+    // end up a quarter semitone sharp.
+    float period = tune * SynthMath::exp(-0.05776226505f * (float(note) + ANALOG * float(v % VoiceBank::LANES)));
 
     // Ensure the period or detuned period is at least 6 samples long.
     // at 44.1kHz, the highest freq we can produce is 7350Hz (44100 / 6)
@@ -321,23 +871,19 @@ float Synth::calcPeriod(int v, int note) const {
 }
 
 void Synth::shiftQueuedNotes() {
-    for (int tmp =  MAX_VOICES - 1; tmp > 0; tmp--) {
-        voices_[tmp].note = voices_[tmp - 1].note;
+    for (int tmp =  NOTE_QUEUE_SIZE - 1; tmp > 0; tmp--) {
+        setVoiceNote(tmp, voices_[tmp - 1].note);
         voices_[tmp].release();
     }
 }
 
 int Synth::nextQueuedNote() {
-    int held = 0;
-
-    for (int v = MAX_VOICES - 1; v > 0; v--) {
-        if (voices_[v].note > 0) { held = v; }
-    }
-
-    if (held > 0)  {
-        int note = voices_[held].note;
-        voices_[held].note = 0;
-        return note;
+    for (int v = 1; v < NOTE_QUEUE_SIZE; ++v) {
+        if (voices_[v].note > 0) {
+            int note = voices_[v].note;
+            setVoiceNote(v, 0);
+            return note;
+        }
     }
 
     return 0;
@@ -356,19 +902,58 @@ void Synth::restartMonoVoice(int note, int velocity) {
 
     voice.cutoff = sample_rate / (period * PI);
     if (velocity > 0) {
-        voice.cutoff *= std::exp(velocity_sensitivity * float(velocity - 64));
+        voice.cutoff *= SynthMath::exp(velocity_sensitivity * float(velocity - 64));
     }
 
     voice.env.level += SILENCE + SILENCE;
-    voice.note = note;
+    setVoiceNote(0, note);
     voice.updatePanning();
+
+    activateVoice(0);
 }
 
 bool Synth::isPlayingLegatoStyle() const {
-    int held = 0;
-    for (int i = 0; i < MAX_VOICES; ++i) {
-        if (voices_[i].note > 0) { held += 1; }
+    return held_notes_ > 0;
+}
+
+// Adds voice v to the active list unless it's already in there.
+void Synth::activateVoice(int v) {
+    auto it = std::lower_bound(active_voices_.begin(), active_voices_.end(), v);
+    if (it == active_voices_.end() || *it != v) {
+        active_voices_.insert(it, v); // reserved for every voice in allocate_resources()
     }
-    return held > 0;
+}
+
+void Synth::setVoiceNote(int v, int note) {
+    Voice& voice = voices_[v];
+    if (voice.note == note) { return; }
+
+    if (voice.note != 0) {
+        // unlink from the old note's list
+        int* link = &note_voices_[(voice.note == SUSTAIN) ? SUSTAIN_LIST : voice.note];
+        while (*link != v) {
+            link = &next_voice_[*link];
+        }
+        *link = next_voice_[v];
+    }
+
+    if (note != 0) {
+        int& head = note_voices_[(note == SUSTAIN) ? SUSTAIN_LIST : note];
+        next_voice_[v] = head;
+        head = v;
+    }
+
+    held_notes_ += int(note > 0) - int(voice.note > 0);
+    voice.note = note;
+}
+
+void Synth::resetVoices() {
+    for (Voice& voice : voices_) {
+        voice.reset();
+    }
+
+    active_voices_.clear();
+    note_voices_.fill(NO_VOICE);
+    held_notes_ = 0;
 }
 //} // End namespace
\ No newline at end of file
@@ -0,0 +1,157 @@
+#include "CX11Synth/SynthParameters.h"
+
+void SynthParameters::update(const float (&values)[NUM_PARAMS], uint32_t dirty, float sample_rate) {
+    auto changed = [dirty](Preset::Param param) {
+        return (dirty & (1u << param)) != 0;
+    };
+
+    float inverse_sample_rate = 1.0f / sample_rate;
+
+    // Choices (glide mode, poly mode, osc engine) come as their index.
+    // Mono = 0, Poly = 1
+
+    // 5.5 - 0.075 scales the time
+    if (changed(Preset::ENV_ATTACK)) {
+        env_attack = std::exp(-inverse_sample_rate * std::exp(5.5f - 0.075f * values[Preset::ENV_ATTACK]));
+    }
+    if (changed(Preset::ENV_DECAY)) {
+        env_decay = std::exp(-inverse_sample_rate * std::exp(5.5f - 0.075f * values[Preset::ENV_DECAY]));
+    }
+    if (changed(Preset::ENV_SUSTAIN)) {
+        env_sustain = values[Preset::ENV_SUSTAIN] / 100.0f;
+    }
+
+    if (changed(Preset::ENV_RELEASE)) {
+        float release = values[Preset::ENV_RELEASE];
+
+        if (release < 1.0f) {
+            env_release = 0.75f; // extra fast release fades out over ~32 samples. 0.75^32 = 0.0001 aka SILENCE
+        } else {
+            env_release = std::exp(-inverse_sample_rate * std::exp(5.5f - 0.075f * release));
+        }
+    }
+
+    if (changed(Preset::NOISE)) {
+        float noise = values[Preset::NOISE] / 100.0f;
+        noise *= noise;
+        noise_mix = noise * 0.06f;
+    }
+
+    if (changed(Preset::FILTER_FREQ)) {
+        filter_key_tracking = 0.08f * values[Preset::FILTER_FREQ] - 1.5f; // multiplier range -1.5..6.5
+    }
+
+    float filter_reso = values[Preset::FILTER_RESO] / 100.0f;
+    if (changed(Preset::FILTER_RESO)) {
+        filter_q = std::exp(3.0f * filter_reso);
+    }
+
+    if (changed(Preset::OSC_MIX)) {
+        osc_mix = values[Preset::OSC_MIX] / 100.0f;
+    }
+
+    if (changed(Preset::OSC_MIX) || changed(Preset::NOISE) || changed(Preset::FILTER_RESO)) {
+        volume_trim = 0.0008f * (3.2f - osc_mix - 25.0f * noise_mix) * (1.5f - 0.5f * filter_reso);
+    }
+
+    if (changed(Preset::OSC_TUNE) || changed(Preset::OSC_FINE)) {
+        float semi = values[Preset::OSC_TUNE];
+        float cent = values[Preset::OSC_FINE];
+        detune = std::pow(1.059463094359f, -semi - 0.01f * cent);
+    }
+
+    if (changed(Preset::OCTAVE) || changed(Preset::TUNING)) {
+        float octave = values[Preset::OCTAVE];
+        float tuning = values[Preset::TUNING];
+        float tune_in_semi = -36.3763f - 12.0f * octave - tuning / 100.0f;
+        tune = sample_rate * std::exp(0.05776226505f * tune_in_semi);
+    }
+
+    if (changed(Preset::POLY_MODE)) {
+        poly = int(values[Preset::POLY_MODE]) != 0;
+    }
+    if (changed(Preset::OSC_ENGINE)) {
+        osc_engine = int(values[Preset::OSC_ENGINE]);
+    }
+    if (changed(Preset::OUTPUT_LEVEL)) {
+        output_level = juce::Decibels::decibelsToGain(values[Preset::OUTPUT_LEVEL]);
+    }
+
+    if (changed(Preset::VIBRATO)) {
+        float amount = values[Preset::VIBRATO] / 200.0f;
+        vibrato = 0.2f * amount * amount;
+
+        pwm_depth = vibrato;
+        if (amount < 0.0f) { vibrato = 0.0f; }
+    }
+
+    if (changed(Preset::FILTER_VELOCITY)) {
+        float filter_velocity = values[Preset::FILTER_VELOCITY];
+        if (filter_velocity < -90.0f) {
+            velocity_sensitivity = 0.0f;
+            ignore_velocity = true;
+        } else {
+            velocity_sensitivity = 0.0005f * filter_velocity;
+            ignore_velocity = false;
+        }
+    }
+
+    const float inverse_update_rate = inverse_sample_rate * Synth::LFO_MAX;
+    if (changed(Preset::LFO_RATE)) {
+        float lfo_rate = std::exp(7.0f * values[Preset::LFO_RATE] - 4.0f); // exp(7x - 4)
+        lfo_inc = lfo_rate * inverse_update_rate * float(TAU);
+    }
+
+    if (changed(Preset::GLIDE_MODE)) {
+        glide_mode = int(values[Preset::GLIDE_MODE]);
+    }
+
+    if (changed(Preset::GLIDE_RATE)) {
+        float rate = values[Preset::GLIDE_RATE];
+        if (rate < 2.0f) {
+            glide_rate = 1.0f; // No glide
+        } else {
+            glide_rate = 1.0f - std::exp(-inverse_update_rate * std::exp(6.0f - 0.07f * rate));
+        }
+    }
+
+    if (changed(Preset::GLIDE_BEND)) {
+        glide_bend = values[Preset::GLIDE_BEND];
+    }
+    if (changed(Preset::FILTER_LFO)) {
+        float filter_lfo = values[Preset::FILTER_LFO] / 100.0f;
+        filter_lfo_depth = 2.5f * filter_lfo * filter_lfo; // parabolic curve [0..2.5]
+    }
+
+    if (changed(Preset::FILTER_ATTACK)) {
+        filter_attack = std::exp(-inverse_update_rate * std::exp(5.5f - 0.075f * values[Preset::FILTER_ATTACK]));
+    }
+    if (changed(Preset::FILTER_DECAY)) {
+        filter_decay  = std::exp(-inverse_update_rate * std::exp(5.5f - 0.075f * values[Preset::FILTER_DECAY]));
+    }
+    if (changed(Preset::FILTER_SUSTAIN)) {
+        filter_sustain = values[Preset::FILTER_SUSTAIN] / 100.0f;
+        filter_sustain = filter_sustain * filter_sustain; // logarithmic nature of frequencies?
+    }
+    if (changed(Preset::FILTER_RELEASE)) {
+        filter_release  = std::exp(-inverse_update_rate * std::exp(5.5f - 0.075f * values[Preset::FILTER_RELEASE]));
+    }
+    if (changed(Preset::FILTER_ENV)) {
+        filter_env_depth = 0.06f * values[Preset::FILTER_ENV];
+    }
+
+    // starting pitch is 2^(n/12) where n is the number of fractional semitones. Alternate is 2.0 ^((-semi - 0.01f * cent) / 12.0f)
+    // 1.059463094359f == 2^(1/12)
+    // Using -semi because we specify the oscillator's period and not frequency. Making the period larger decreases the frequency.
+    /*
+      OLD DECAY LPF
+      // Need our exp(-x) function to go from 1.0 down to 0.0001 in a certain amount of time.
+      // Figure out the number of samples in the time period (ie. sample count for two seconds at 44.1kHz = 2.0 * 44100)
+      // log is the ln in multiplier  = exp(log(SILENCE) / sample_count)
+      // The decay param is a percentage, so bring it into 0.0..1.0. Dividing by 5.0 means 100% = 5 seconds
+      float decay_time = env_decay_param->get() / 100.0f * 5.0f;
+      float decay_samples = sample_rate * decay_time;
+      synth.env_decay = std::exp(std::log(SILENCE) / decay_samples);
+
+    */
+}
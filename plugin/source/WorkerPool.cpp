@@ -0,0 +1,157 @@
+#include "CX11Synth/WorkerPool.h"
+
+#if JUCE_INTEL
+    #include <immintrin.h>
+#endif
+
+namespace {
+    // Tells the CPU we're in a spin loop (saves power and lets the other hyperthread run).
+    inline void cpuRelax() {
+    #if JUCE_INTEL
+        _mm_pause();
+    #elif JUCE_ARM && (JUCE_GCC || JUCE_CLANG)
+        __asm__ __volatile__("yield");
+    #endif
+    }
+
+    // How long a worker stays hot after its last job. Anything under a couple of host buffers
+    // means it is still spinning when the next block comes in; after that it naps so an idle
+    // plugin doesn't keep the cores busy.
+    constexpr double STAY_AWAKE_MS = 20.0;
+    constexpr int SPIN_COUNT = 2000;
+
+    // How long run() waits for the workers before it takes back the jobs they claimed but haven't
+    // started. A few microseconds: much longer than it takes a running worker to start a job it
+    // just claimed, much shorter than a time slice it lost to another thread.
+    constexpr int STEAL_SPINS = 200;
+}
+
+class WorkerPool::Worker : public juce::Thread {
+    public:
+        Worker(WorkerPool& pool, int index)
+            : juce::Thread("CX11 render worker " + juce::String(index)), pool_(pool) {}
+
+        void run() override {
+            uint32_t seen = generationOf(pool_.ticket_.load(std::memory_order_acquire));
+            double last_work = juce::Time::getMillisecondCounterHiRes();
+            int spins = 0;
+
+            while (!threadShouldExit()) {
+                const uint64_t ticket = pool_.ticket_.load(std::memory_order_acquire);
+
+                if (generationOf(ticket) != seen) {
+                    seen = generationOf(ticket);
+                    pool_.runJobs(ticket);
+                    last_work = juce::Time::getMillisecondCounterHiRes();
+                    spins = 0;
+                } else if (spins < SPIN_COUNT) {
+                    ++spins;
+                    cpuRelax();
+                } else if (juce::Time::getMillisecondCounterHiRes() - last_work < STAY_AWAKE_MS) {
+                    juce::Thread::yield();
+                } else {
+                    wait(1);
+                }
+            }
+        }
+
+    private:
+        WorkerPool& pool_;
+};
+
+WorkerPool::WorkerPool() = default;
+
+WorkerPool::~WorkerPool() {
+    stop();
+}
+
+void WorkerPool::start(int num_threads) {
+    stop();
+
+    for (int i = 0; i < num_threads; ++i) {
+        workers_.push_back(std::make_unique<Worker>(*this, i));
+    }
+
+    for (auto& worker : workers_) {
+        if (!worker->startRealtimeThread(juce::Thread::RealtimeOptions{}.withPriority(8))) {
+            // No realtime scheduling (e.g. Linux without rtprio), a normal thread still helps.
+            worker->startThread();
+        }
+    }
+}
+
+void WorkerPool::stop() {
+    for (auto& worker : workers_) {
+        worker->signalThreadShouldExit();
+    }
+
+    for (auto& worker : workers_) {
+        worker->stopThread(1000);
+    }
+
+    workers_.clear();
+}
+
+void WorkerPool::run(Job job, void* context, int count) {
+    if (count <= 0) { return; }
+    jassert(count <= MAX_JOBS);
+
+    job_ = job;
+    context_ = context;
+    remaining_.store(count, std::memory_order_relaxed);
+
+    // 0 marks a job that has been taken, so skip it when the generation wraps around.
+    const uint64_t previous = ticket_.load(std::memory_order_relaxed);
+    uint32_t generation = generationOf(previous) + 1;
+    if (generation == 0) { generation = 1; }
+
+    for (int i = 0; i < count; ++i) {
+        open_[size_t(i)].store(generation, std::memory_order_relaxed);
+    }
+
+    // Publishing a new generation with index 0 is what hands the batch to the workers.
+    const uint64_t ticket = (uint64_t(generation) << GENERATION_SHIFT) | (uint64_t(count) << COUNT_SHIFT);
+    ticket_.store(ticket, std::memory_order_release);
+
+    runJobs(ticket);
+
+    // Whatever is left has been claimed by a worker. If it hasn't started on it by now the worker
+    // has most likely been preempted, so render those here.
+    for (int spins = 0; remaining_.load(std::memory_order_acquire) > 0; ++spins) {
+        if (spins == STEAL_SPINS) {
+            for (int i = 0; i < count; ++i) {
+                takeJob(i, generation);
+            }
+        }
+        cpuRelax();
+    }
+}
+
+bool WorkerPool::runJobs(uint64_t ticket) {
+    const uint32_t generation = generationOf(ticket);
+    bool ran_any = false;
+
+    uint64_t current = ticket_.load(std::memory_order_acquire);
+    while (generationOf(current) == generation) {
+        const int index = int(current & INDEX_MASK);
+        const int count = int((current >> COUNT_SHIFT) & INDEX_MASK);
+        if (index >= count) { break; }
+
+        if (ticket_.compare_exchange_weak(current, current + 1, std::memory_order_acq_rel, std::memory_order_acquire)) {
+            ran_any = takeJob(index, generation) || ran_any;
+        }
+    }
+
+    return ran_any;
+}
+
+bool WorkerPool::takeJob(int index, uint32_t generation) {
+    uint32_t expected = generation;
+    if (!open_[size_t(index)].compare_exchange_strong(expected, 0, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+        return false;
+    }
+
+    job_(context_, index);
+    remaining_.fetch_sub(1, std::memory_order_release);
+    return true;
+}
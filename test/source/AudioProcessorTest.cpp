@@ -1,8 +1,303 @@
 #include <CX11Synth/PluginProcessor.h>
 #include <gtest/gtest.h>
 
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "LibraryDirectory.h"
+
 namespace audio_plugin_test {
+namespace {
+// 16 notes that all keep sounding, one coming in every block, through a processor with room for
+// `polyphony` voices. Returns the left channel.
+std::vector<float> playSixteenNotes(int polyphony) {
+  constexpr double sampleRate = 48000.0;
+  constexpr int blockSize = 64;
+
+  audio_plugin::CX11SynthAudioProcessor processor;
+  processor.polyphony = polyphony;
+  processor.setNonRealtime(true);
+  processor.setRateAndBufferSizeDetails(sampleRate, blockSize);
+  processor.prepareToPlay(sampleRate, blockSize);
+
+  juce::AudioBuffer<float> buffer(2, blockSize);
+  juce::MidiBuffer midi;
+  std::vector<float> output;
+  for (int i = 0; i < 40; ++i) {
+    if (i < 16) {
+      midi.addEvent(juce::MidiMessage::noteOn(1, 48 + i, uint8_t(100)), 0);
+    }
+    buffer.clear();
+    processor.processBlock(buffer, midi);
+    output.insert(output.end(), buffer.getReadPointer(0), buffer.getReadPointer(0) + blockSize);
+  }
+  return output;
+}
+}  // namespace
+
 TEST(AudioProcessor, Foo) {
   audio_plugin::CX11SynthAudioProcessor processor{};
 }
+
+TEST(AudioProcessor, ProgramChangeFadesOutBeforeSwitching) {
+  constexpr double sampleRate = 48000.0;
+  constexpr int blockSize = 64;
+
+  audio_plugin::CX11SynthAudioProcessor processor;
+  processor.setNonRealtime(true);  // picks up the program without waiting for the timer
+  processor.setRateAndBufferSizeDetails(sampleRate, blockSize);
+  processor.prepareToPlay(sampleRate, blockSize);
+
+  juce::AudioBuffer<float> buffer(2, blockSize);
+  juce::MidiBuffer midi;
+  const auto processBlock = [&]() {
+    buffer.clear();
+    processor.processBlock(buffer, midi);
+    return buffer.getMagnitude(0, 0, blockSize);
+  };
+
+  midi.addEvent(juce::MidiMessage::noteOn(1, 60, uint8_t(100)), 0);
+  float playing = 0.0f;
+  for (int i = 0; i < 20; ++i) {
+    playing = std::max(playing, processBlock());  // the last few cover a whole cycle of the note
+  }
+  ASSERT_GT(playing, 0.0f);
+
+  // The audio thread only notes the program...
+  midi.addEvent(juce::MidiMessage::programChange(1, 3), 0);
+  processBlock();
+  EXPECT_EQ(processor.getCurrentProgram(), 0);
+
+  // ...the next block applies it and starts the fade, which takes 480 samples.
+  const float fading = processBlock();
+  EXPECT_EQ(processor.getCurrentProgram(), 3);
+  EXPECT_GT(fading, 0.0f);
+
+  float last = fading;
+  for (int i = 0; i < 6; ++i) {
+    last = processBlock();
+  }
+  EXPECT_LT(last, playing * 0.25f);
+  processBlock();  // the last 32 samples of the fade
+
+  // Faded out, then the voices are reset at the start of a block.
+  EXPECT_EQ(processBlock(), 0.0f);
+  EXPECT_EQ(processBlock(), 0.0f);
+}
+
+TEST(AudioProcessor, NotesAfterAProgramChangePlayOnTheNewProgram) {
+  constexpr double sampleRate = 48000.0;
+  constexpr int blockSize = 64;
+
+  audio_plugin::CX11SynthAudioProcessor processor;
+  processor.setNonRealtime(true);
+  processor.setRateAndBufferSizeDetails(sampleRate, blockSize);
+  processor.prepareToPlay(sampleRate, blockSize);
+
+  juce::AudioBuffer<float> buffer(2, blockSize);
+  juce::MidiBuffer midi;
+  const auto processBlock = [&]() {
+    buffer.clear();
+    processor.processBlock(buffer, midi);
+    return buffer.getMagnitude(0, 0, blockSize);
+  };
+
+  midi.addEvent(juce::MidiMessage::noteOn(1, 60, uint8_t(100)), 0);
+  for (int i = 0; i < 20; ++i) {
+    processBlock();
+  }
+
+  // The way a MIDI file starts a new section: the program, then the notes. "Solid Backing"
+  // sustains at full level.
+  midi.addEvent(juce::MidiMessage::programChange(1, 4), 0);
+  midi.addEvent(juce::MidiMessage::noteOn(1, 64, uint8_t(100)), 10);
+  processBlock();
+
+  // The old note fades out, the new one waits for the switch and then keeps sounding.
+  for (int i = 0; i < 12; ++i) {
+    processBlock();
+  }
+  EXPECT_EQ(processor.getCurrentProgram(), 4);
+
+  float quietest = 1.0f;
+  for (int i = 0; i < 20; ++i) {
+    quietest = std::min(quietest, processBlock());
+  }
+  EXPECT_GT(quietest, 0.0f);
+}
+
+TEST(AudioProcessor, StateRoundTrip) {
+  audio_plugin::CX11SynthAudioProcessor saved;
+  saved.setCurrentProgram(5);
+  saved.midi_learn_cc = 74;
+  saved.polyphony = 32;
+
+  juce::MemoryBlock state;
+  saved.getStateInformation(state);
+  ASSERT_GT(state.getSize(), 4u);
+  EXPECT_EQ(std::memcmp(state.getData(), "CX1S", 4), 0);
+
+  audio_plugin::CX11SynthAudioProcessor loaded;
+  loaded.setStateInformation(state.getData(), int(state.getSize()));
+  for (int i = 0; i < saved.getParameters().size(); ++i) {
+    EXPECT_EQ(loaded.getParameters()[i]->getValue(), saved.getParameters()[i]->getValue()) << "parameter " << i;
+  }
+  EXPECT_EQ(loaded.midi_learn_cc.load(), 74);
+  EXPECT_EQ(loaded.polyphony, 32);
+
+  // Cut short, nothing changes.
+  audio_plugin::CX11SynthAudioProcessor untouched;
+  const audio_plugin::CX11SynthAudioProcessor fresh;
+  untouched.setStateInformation(state.getData(), int(state.getSize()) - 40);
+  for (int i = 0; i < fresh.getParameters().size(); ++i) {
+    EXPECT_EQ(untouched.getParameters()[i]->getValue(), fresh.getParameters()[i]->getValue()) << "parameter " << i;
+  }
+}
+
+TEST(AudioProcessor, LoadsXmlStateOfEarlierVersions) {
+  audio_plugin::CX11SynthAudioProcessor saved;
+  saved.setCurrentProgram(7);
+
+  juce::XmlElement xml("PLUGIN");
+  xml.addChildElement(saved.apvts.copyState().createXml().release());
+  xml.createNewChildElement("EXTRA")->setAttribute("midCC", 11);
+  juce::MemoryBlock state;
+  juce::AudioProcessor::copyXmlToBinary(xml, state);
+
+  audio_plugin::CX11SynthAudioProcessor loaded;
+  loaded.setStateInformation(state.getData(), int(state.getSize()));
+  for (int i = 0; i < saved.getParameters().size(); ++i) {
+    EXPECT_EQ(loaded.getParameters()[i]->getValue(), saved.getParameters()[i]->getValue()) << "parameter " << i;
+  }
+  EXPECT_EQ(loaded.midi_learn_cc.load(), 11);
+}
+
+TEST(AudioProcessor, MorphMovesWithoutResettingTheVoices) {
+  constexpr double sampleRate = 48000.0;
+  constexpr int blockSize = 100;  // not a whole number of morph steps
+
+  audio_plugin::CX11SynthAudioProcessor processor;
+  processor.setRateAndBufferSizeDetails(sampleRate, blockSize);
+  processor.prepareToPlay(sampleRate, blockSize);
+
+  // Full sustain on both, so the note is heard for as long as nothing resets it.
+  const std::vector<Preset> presets = {
+      Preset("Dark", 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 20.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 30.0f, 0.0f, 30.0f,
+             0.0f, 50.0f, 100.0f, 30.0f, 0.3f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f),
+      Preset("Bright", 100.0f, 7.0f, 0.0f, 0.0f, 0.0f, 0.0f, 90.0f, 80.0f, 0.0f, 0.0f, 0.0f, 0.0f, 30.0f, 0.0f, 30.0f,
+             0.0f, 50.0f, 100.0f, 30.0f, 0.8f, 0.0f, 0.0f, 1.0f, 0.0f, -3.0f, 1.0f),
+  };
+  processor.setMorphPresets(presets);
+  auto* morph = processor.apvts.getParameter(ParameterId::morph.getParamID());
+
+  juce::AudioBuffer<float> buffer(2, blockSize);
+  juce::MidiBuffer midi;
+  const auto processBlock = [&]() {
+    buffer.clear();
+    processor.processBlock(buffer, midi);
+    return buffer.getMagnitude(0, 0, blockSize);
+  };
+
+  midi.addEvent(juce::MidiMessage::noteOn(1, 60, uint8_t(100)), 0);
+  for (int i = 0; i < 20; ++i) {
+    processBlock();
+  }
+
+  // Swept across in small steps like automation would, with a note coming in halfway through a
+  // block while the morph moves.
+  for (int i = 1; i <= 40; ++i) {
+    morph->setValueNotifyingHost(float(i) / 40.0f);
+    if (i == 20) {
+      midi.addEvent(juce::MidiMessage::noteOn(1, 67, uint8_t(100)), 50);
+    }
+
+    const float level = processBlock();
+    EXPECT_GT(level, 0.0f) << "block " << i;
+    EXPECT_TRUE(std::isfinite(level)) << "block " << i;
+  }
+
+  // Back to the parameters, still without a reset.
+  processor.setMorphPresets({});
+  EXPECT_GT(processBlock(), 0.0f);
+  EXPECT_GT(processBlock(), 0.0f);
+}
+
+TEST(AudioProcessor, PolyphonyHoldsOverlappingNotesWithoutStealing) {
+  // With room for all of them, 32 voices sound exactly like the most the synth has.
+  const std::vector<float> roomy = playSixteenNotes(32);
+  EXPECT_TRUE(roomy == playSixteenNotes(Synth::MAX_VOICES));
+
+  // The default 8 has to steal, which is what the setting is for.
+  EXPECT_FALSE(roomy == playSixteenNotes(Synth::DEFAULT_VOICES));
+}
+
+TEST(AudioProcessor, MorphIsSavedWithTheState) {
+  audio_plugin::CX11SynthAudioProcessor saved;
+  saved.setMorphPresets({ Preset("A", 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 20.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 30.0f,
+                                 0.0f, 30.0f, 0.0f, 50.0f, 100.0f, 30.0f, 0.3f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f),
+                          Preset("B", 100.0f, 7.0f, 0.0f, 0.0f, 0.0f, 0.0f, 90.0f, 80.0f, 0.0f, 0.0f, 0.0f, 0.0f, 30.0f,
+                                 0.0f, 30.0f, 0.0f, 50.0f, 100.0f, 30.0f, 0.8f, 0.0f, 0.0f, 1.0f, 0.0f, -3.0f, 1.0f),
+                          Preset("C", 50.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 60.0f, 40.0f, 0.0f, 0.0f, 0.0f, 0.0f, 30.0f,
+                                 0.0f, 30.0f, 0.0f, 50.0f, 100.0f, 30.0f, 0.5f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f) });
+  auto* morph = saved.apvts.getParameter(ParameterId::morph.getParamID());
+  morph->setValueNotifyingHost(0.75f);
+
+  juce::MemoryBlock state;
+  saved.getStateInformation(state);
+
+  // The morph's presets aren't visible from outside, but saving again has to give the same bytes.
+  audio_plugin::CX11SynthAudioProcessor loaded;
+  loaded.setStateInformation(state.getData(), int(state.getSize()));
+  EXPECT_EQ(loaded.apvts.getParameter(ParameterId::morph.getParamID())->getValue(), 0.75f);
+
+  juce::MemoryBlock again;
+  loaded.getStateInformation(again);
+  EXPECT_TRUE(again == state);
+
+  // Ending the morph ends it in the state too.
+  saved.setMorphPresets({});
+  juce::MemoryBlock without;
+  saved.getStateInformation(without);
+  EXPECT_LT(without.getSize(), state.getSize());
+}
+
+TEST(AudioProcessor, ProgramsComeFromThePresetLibrary) {
+  const LibraryDirectory directory;
+  const auto preset = [](const char* name, float osc_mix) {
+    Preset preset;
+    preset.setName(name);
+    preset.param[Preset::OSC_MIX] = osc_mix;
+    return preset;
+  };
+  directory.write("Pads.cx11bank", { preset("Warm Pad", 30.0f), preset("Glass Pad", 60.0f) });
+  directory.write("Leads.cx11bank", { preset("Saw Lead", 90.0f) });
+
+  auto library = std::make_shared<PresetLibrary>(directory.root.getChildFile("library.index"));
+  library->setDirectories({ directory.root });
+  ASSERT_TRUE(library->waitForScan(5000));
+
+  audio_plugin::CX11SynthAudioProcessor processor;
+  const int factoryPrograms = processor.getNumPrograms();
+
+  // The host pages through the library's index, sorted by name...
+  processor.usePresetLibrary(library);
+  ASSERT_EQ(processor.getNumPrograms(), 3);
+  EXPECT_EQ(processor.getProgramName(0), "Glass Pad");
+  EXPECT_EQ(processor.getProgramName(1), "Saw Lead");
+  EXPECT_EQ(processor.getProgramName(2), "Warm Pad");
+
+  // ...and picking one opens its bank.
+  processor.setCurrentProgram(2);
+  EXPECT_EQ(processor.getCurrentProgram(), 2);
+  const auto* oscMix = processor.apvts.getParameter(ParameterId::osc_mix.getParamID());
+  EXPECT_FLOAT_EQ(oscMix->convertFrom0to1(oscMix->getValue()), 30.0f);
+
+  processor.setCurrentProgram(1);
+  EXPECT_FLOAT_EQ(oscMix->convertFrom0to1(oscMix->getValue()), 90.0f);
+
+  // Without the library it's the bank's programs again.
+  processor.usePresetLibrary(nullptr);
+  EXPECT_EQ(processor.getNumPrograms(), factoryPrograms);
+}
 }  // namespace audio_plugin_test
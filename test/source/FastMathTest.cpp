@@ -0,0 +1,81 @@
+#include <CX11Synth/FastMath.h>
+#include <gtest/gtest.h>
+
+#include <cmath>
+
+namespace audio_plugin_test {
+namespace {
+// Largest error of `fast` against the double precision libm function over [from, to].
+// Relative or absolute, matching how the bounds in FastMath.h are stated.
+template <typename Fast, typename Exact>
+double maxError(Fast fast, Exact exact, float from, float to, bool relative) {
+  constexpr int STEPS = 200000;
+  double max_error = 0.0;
+
+  for (int i = 0; i <= STEPS; ++i) {
+    const float x = from + (to - from) * float(i) / float(STEPS);
+    const double expected = exact(double(x));
+    double error = std::abs(double(fast(x)) - expected);
+    if (relative && expected != 0.0) {
+      error /= std::abs(expected);
+    }
+    max_error = std::max(max_error, error);
+  }
+
+  return max_error;
+}
+}  // namespace
+
+TEST(FastMath, Exp2) {
+  const auto fast = [](float x) { return FastMath::exp2(x); };
+  const auto exact = [](double x) { return std::exp2(x); };
+  EXPECT_LT(maxError(fast, exact, -126.0f, 127.0f, true), 3e-7);
+  EXPECT_LT(maxError(fast, exact, -1.0f, 1.0f, true), 3e-7);
+}
+
+// Whole octaves have to stay in tune.
+TEST(FastMath, Exp2IsExactOnIntegers) {
+  for (int i = -126; i <= 127; ++i) {
+    EXPECT_EQ(FastMath::exp2(float(i)), std::exp2(float(i))) << "2^" << i;
+  }
+}
+
+TEST(FastMath, Exp) {
+  const auto fast = [](float x) { return FastMath::exp(x); };
+  const auto exact = [](double x) { return std::exp(x); };
+  EXPECT_LT(maxError(fast, exact, -20.0f, 20.0f, true), 1.5e-6);
+  EXPECT_LT(maxError(fast, exact, -1.0f, 1.0f, true), 4e-7);
+}
+
+TEST(FastMath, Sin) {
+  const auto fast = [](float x) { return FastMath::sin(x); };
+  const auto exact = [](double x) { return std::sin(x); };
+  EXPECT_LT(maxError(fast, exact, -FastMath::PI, FastMath::PI, false), 3e-7);
+  EXPECT_LT(maxError(fast, exact, -1000.0f, 1000.0f, false), 3e-7);
+  EXPECT_EQ(FastMath::sin(0.0f), 0.0f);
+}
+
+TEST(FastMath, Tan) {
+  const auto fast = [](float x) { return FastMath::tan(x); };
+  const auto exact = [](double x) { return std::tan(x); };
+  EXPECT_LT(maxError(fast, exact, -1.5f, 1.5f, true), 1e-6);
+  EXPECT_EQ(FastMath::tan(0.0f), 0.0f);
+}
+
+// The default build has to render exactly what it did before FastMath.h existed.
+TEST(FastMath, SynthMathIsLibmUnlessFastMathIsOn) {
+#if !CX11_FAST_MATH
+  for (float x = -10.0f; x <= 10.0f; x += 0.37f) {
+    EXPECT_EQ(SynthMath::exp(x), std::exp(x));
+    EXPECT_EQ(SynthMath::exp2(x), std::exp2(x));
+    EXPECT_EQ(SynthMath::sin(x), std::sin(x));
+    EXPECT_EQ(SynthMath::semitoneRatio(x), std::pow(1.059463094359f, x));
+  }
+  for (float x = -1.5f; x <= 1.5f; x += 0.037f) {
+    EXPECT_EQ(SynthMath::tan(x), std::tan(x));
+  }
+#else
+  GTEST_SKIP() << "built with CX11_FAST_MATH";
+#endif
+}
+}  // namespace audio_plugin_test
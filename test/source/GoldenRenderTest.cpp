@@ -0,0 +1,313 @@
+#include <CX11Synth/OutputGuard.h>
+#include <CX11Synth/Synth.h>
+#include <CX11Synth/SynthParameters.h>
+#include <gtest/gtest.h>
+#include <juce_audio_formats/juce_audio_formats.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Renders a fixed set of patches and MIDI phrases through Synth::render and compares the audio
+// with the golden renders in test/golden. A change to the voice engine has to come out bit-exact
+// or within the tolerances below, which are well under what anyone can hear.
+//
+// After a change that's meant to sound different, write new golden files with
+//   CX11_UPDATE_GOLDEN=1 ctest -R GoldenRender
+// and listen to them before committing.
+//
+// Timings are only compared when CX11_PERF_BASELINE names a baseline file, since they only mean
+// something on the machine the baseline was made on (and in a Release build). Make one with
+//   CX11_UPDATE_PERF_BASELINE=1 CX11_PERF_BASELINE=timing.json ctest -R GoldenRender
+// CX11_PERF_THRESHOLD sets how much slower a render may get, default 0.15 (15%).
+
+namespace audio_plugin_test {
+namespace {
+constexpr double SAMPLE_RATE = 48000.0;
+constexpr int BLOCK_SIZE = 256;
+constexpr int LENGTH = 9600;  // 0.2 s, enough for attack, decay and release
+
+constexpr float MAX_ERROR = 1e-3f;     // largest difference for any one sample
+constexpr double MIN_SNR_DB = 60.0;    // golden signal against the difference, over the whole render
+constexpr int TIMING_RUNS = 5;         // the fastest one counts
+
+struct Event {
+  int position;
+  uint8_t data0, data1, data2;
+};
+
+struct Case {
+  const char* name;
+  void (*patch)(Preset&);
+  std::vector<Event> phrase;
+};
+
+// Two detuned oscillators through a filter with an envelope on it, the patches below change
+// what they're about. Preset values, worked out through SynthParameters::update like the
+// processor does.
+Preset basePreset() {
+  return Preset("Golden", 80.0f, 0.0f, 10.0f, 0.0f, 0.0f, 0.0f, 60.0f, 30.0f, 33.0f, 0.0f, 0.0f, 10.0f, 40.0f, 45.0f,
+                30.0f, 0.0f, 40.0f, 70.0f, 20.0f, 0.8f, 0.0f, 0.0f, 0.0f, 0.0f, -6.0f, 1.0f, 0.0f);
+}
+
+const std::vector<Event> CHORD = {
+    {0, 0x90, 48, 100}, {0, 0x90, 55, 90}, {40, 0x90, 60, 80}, {80, 0x90, 64, 110},
+    {5000, 0x80, 48, 0}, {5000, 0x80, 55, 0}, {5200, 0x80, 60, 0}, {5400, 0x80, 64, 0},
+};
+
+const std::vector<Event> MELODY = {
+    {0, 0x90, 60, 100}, {1500, 0x90, 62, 90}, {1600, 0x80, 60, 0}, {2000, 0xB0, 0x01, 90},
+    {3000, 0x90, 67, 120}, {3100, 0x80, 62, 0}, {4000, 0xE0, 0x00, 0x50}, {4700, 0xD0, 80, 0},
+    {6000, 0x80, 67, 0},
+};
+
+const std::vector<Event> PEDAL = {
+    {0, 0x90, 48, 100}, {500, 0xB0, 0x40, 127}, {1000, 0x80, 48, 0}, {2000, 0x90, 52, 100},
+    {2500, 0x80, 52, 0}, {3000, 0xB0, 0x4A, 60}, {6000, 0xB0, 0x40, 0},
+};
+
+// 40 notes piling up over the first 2000 samples, enough to fill five voice banks.
+std::vector<Event> cluster() {
+  std::vector<Event> phrase;
+  for (int note = 0; note < 40; ++note) {
+    phrase.push_back({note * 50, 0x90, uint8_t(36 + note), uint8_t(60 + note)});
+  }
+  for (int note = 0; note < 40; ++note) {
+    phrase.push_back({6000 + note * 20, 0x80, uint8_t(36 + note), 0});
+  }
+  return phrase;
+}
+
+const std::vector<Case>& cases() {
+  static const std::vector<Case> all = {
+      {"poly_chord", [](Preset&) {}, CHORD},
+      {"mono_glide",
+       [](Preset& preset) {
+         preset.param[Preset::POLY_MODE] = 0.0f;
+         preset.param[Preset::OSC_MIX] = 0.0f;
+         preset.param[Preset::GLIDE_MODE] = 2.0f;
+         preset.param[Preset::GLIDE_RATE] = 46.0f;
+         preset.param[Preset::GLIDE_BEND] = -2.0f;
+       },
+       MELODY},
+      {"pwm_vibrato",
+       [](Preset& preset) {
+         preset.param[Preset::VIBRATO] = 30.0f;
+         preset.param[Preset::OSC_FINE] = 0.0f;
+       },
+       MELODY},
+      {"resonant_noise",
+       [](Preset& preset) {
+         preset.param[Preset::FILTER_RESO] = 85.0f;
+         preset.param[Preset::NOISE] = 50.0f;
+         preset.param[Preset::FILTER_LFO] = 40.0f;
+         preset.param[Preset::FILTER_VELOCITY] = 50.0f;
+       },
+       CHORD},
+      {"wavetable", [](Preset& preset) { preset.param[Preset::OSC_ENGINE] = 1.0f; }, CHORD},
+      {"sustain_pedal", [](Preset& preset) { preset.param[Preset::ENV_RELEASE] = 0.0f; }, PEDAL},
+  };
+  return all;
+}
+
+// Stereo, one channel after the other. `configure` gets the synth before its resources are
+// allocated, for settings like the voice capacity.
+std::vector<float> render(const Case& test_case, const std::function<void(Synth&)>& configure = {}) {
+  Synth synth;
+  if (configure) {
+    configure(synth);
+  }
+  synth.allocate_resources(SAMPLE_RATE, BLOCK_SIZE);
+  synth.reset();
+
+  Preset preset = basePreset();
+  test_case.patch(preset);
+  const SynthParameters params = SynthParameters::fromPreset(preset, float(SAMPLE_RATE));
+  params.applyTo(synth);
+  synth.output_level_smoother.setCurrentAndTargetValue(params.output_level);
+
+  // The processor runs the output guard after every block, the golden files were made with it.
+  OutputGuard guard;
+  std::vector<float> output(2 * LENGTH, 0.0f);
+  size_t next_event = 0;
+
+  for (int position = 0; position < LENGTH; position += BLOCK_SIZE) {
+    const int sample_count = std::min(BLOCK_SIZE, LENGTH - position);
+
+    const auto& phrase = test_case.phrase;
+    for (; next_event < phrase.size() && phrase[next_event].position < position + sample_count; ++next_event) {
+      const Event& event = phrase[next_event];
+      synth.queueMidiMessage(event.position - position, event.data0, event.data1, event.data2);
+    }
+
+    float* outputs[2] = {output.data() + position, output.data() + LENGTH + position};
+    synth.render(outputs, sample_count);
+    guard.process(outputs[0], outputs[1], sample_count);
+  }
+
+  synth.deallocate_resources();
+  return output;
+}
+
+juce::File goldenFile(const Case& test_case) {
+  return juce::File(CX11_GOLDEN_DIR).getChildFile(juce::String(test_case.name) + ".wav");
+}
+
+bool isSet(const char* variable) {
+  const char* value = std::getenv(variable);
+  return value != nullptr && *value != '\0' && std::string(value) != "0";
+}
+
+// 32 bit float, so a golden file holds exactly what was rendered.
+void writeGolden(const juce::File& file, const std::vector<float>& audio) {
+  file.getParentDirectory().createDirectory();
+  file.deleteFile();
+
+  std::unique_ptr<juce::OutputStream> stream = file.createOutputStream();
+  ASSERT_NE(stream, nullptr) << file.getFullPathName();
+
+  juce::WavAudioFormat format;
+  std::unique_ptr<juce::AudioFormatWriter> writer(format.createWriterFor(stream.get(), SAMPLE_RATE, 2, 32, {}, 0));
+  ASSERT_NE(writer, nullptr);
+  stream.release();
+
+  const float* channels[2] = {audio.data(), audio.data() + LENGTH};
+  ASSERT_TRUE(writer->writeFromFloatArrays(channels, 2, LENGTH));
+}
+
+bool readGolden(const juce::File& file, std::vector<float>& audio) {
+  juce::WavAudioFormat format;
+  std::unique_ptr<juce::AudioFormatReader> reader(format.createReaderFor(new juce::FileInputStream(file), true));
+  if (reader == nullptr || reader->numChannels != 2 || reader->lengthInSamples != LENGTH) {
+    return false;
+  }
+
+  audio.assign(2 * LENGTH, 0.0f);
+  float* channels[2] = {audio.data(), audio.data() + LENGTH};
+  return reader->read(channels, 2, 0, LENGTH);
+}
+}  // namespace
+
+TEST(GoldenRender, MatchesTheGoldenFiles) {
+  const bool update = isSet("CX11_UPDATE_GOLDEN");
+
+  for (const Case& test_case : cases()) {
+    const std::vector<float> rendered = render(test_case);
+    const juce::File golden = goldenFile(test_case);
+
+    if (update) {
+      writeGolden(golden, rendered);
+      continue;
+    }
+
+    std::vector<float> expected;
+    ASSERT_TRUE(readGolden(golden, expected)) << "can't read " << golden.getFullPathName();
+
+    double signal = 0.0;
+    double noise = 0.0;
+    float max_error = 0.0f;
+    for (size_t i = 0; i < expected.size(); ++i) {
+      const float error = std::abs(rendered[i] - expected[i]);
+      max_error = std::max(max_error, error);
+      signal += double(expected[i]) * double(expected[i]);
+      noise += double(error) * double(error);
+    }
+
+    if (noise == 0.0) {
+      std::cout << test_case.name << ": bit-exact\n";
+      continue;
+    }
+
+    const double snr_db = 10.0 * std::log10(signal / noise);
+    std::cout << test_case.name << ": max error " << max_error << ", " << snr_db << " dB SNR\n";
+
+    EXPECT_LE(max_error, MAX_ERROR) << test_case.name;
+    EXPECT_GE(snr_db, MIN_SNR_DB) << test_case.name;
+  }
+}
+
+// The golden files were made with the block renderer, so on their own they only hold it to
+// itself. These hold it to the per-sample reference loop it replaced, and the voice banks to the
+// fixed 8 voices the synth used to have.
+TEST(GoldenRender, BlockRendererMatchesTheReferenceLoop) {
+  for (const Case& test_case : cases()) {
+    const std::vector<float> block = render(test_case);
+    const std::vector<float> reference = render(test_case, [](Synth& synth) { synth.reference_render = true; });
+    EXPECT_TRUE(block == reference) << test_case.name;
+  }
+}
+
+TEST(GoldenRender, VoiceCapacityDoesNotChangeTheSound) {
+  for (const Case& test_case : cases()) {
+    const std::vector<float> eight = render(test_case, [](Synth& synth) { synth.voice_capacity = 8; });
+    const std::vector<float> more = render(test_case, [](Synth& synth) { synth.voice_capacity = 32; });
+    EXPECT_TRUE(eight == more) << test_case.name;
+  }
+}
+
+// Helper threads render whole voice banks and the banks are summed in the same order either way,
+// so the output can't change by a single bit.
+TEST(GoldenRender, HelperThreadsRenderTheSameAsTheAudioThread) {
+  const Case dense = {"cluster", [](Preset&) {}, cluster()};
+  const std::vector<float> serial = render(dense, [](Synth& synth) { synth.voice_capacity = 40; });
+
+  for (int threads : {1, 3}) {
+    const std::vector<float> threaded = render(dense, [threads](Synth& synth) {
+      synth.voice_capacity = 40;
+      synth.render_threads = threads;
+    });
+    EXPECT_TRUE(threaded == serial) << threads << " threads";
+  }
+}
+
+TEST(GoldenRender, IsNotSlowerThanTheBaseline) {
+  const char* baseline_path = std::getenv("CX11_PERF_BASELINE");
+  if (baseline_path == nullptr || *baseline_path == '\0') {
+    GTEST_SKIP() << "set CX11_PERF_BASELINE to compare timings against a baseline file";
+  }
+
+  const juce::File baseline_file = juce::File::getCurrentWorkingDirectory().getChildFile(baseline_path);
+  const bool update = isSet("CX11_UPDATE_PERF_BASELINE");
+  const char* threshold_value = std::getenv("CX11_PERF_THRESHOLD");
+  const double threshold = threshold_value != nullptr ? std::atof(threshold_value) : 0.15;
+
+  juce::var baseline;
+  if (!update) {
+    baseline = juce::JSON::parse(baseline_file);
+    ASSERT_TRUE(baseline.isObject()) << "can't read " << baseline_file.getFullPathName();
+  }
+
+  auto timings = std::make_unique<juce::DynamicObject>();
+
+  for (const Case& test_case : cases()) {
+    double fastest = 0.0;
+    for (int run = 0; run < TIMING_RUNS; ++run) {
+      const auto start = std::chrono::steady_clock::now();
+      const std::vector<float> rendered = render(test_case);
+      const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+      fastest = run == 0 ? elapsed.count() : std::min(fastest, elapsed.count());
+    }
+
+    const double ns_per_sample = fastest / LENGTH;
+    timings->setProperty(test_case.name, ns_per_sample);
+
+    if (!update) {
+      const juce::var expected = baseline[test_case.name];
+      ASSERT_FALSE(expected.isVoid()) << test_case.name << " isn't in " << baseline_file.getFullPathName();
+
+      std::cout << test_case.name << ": " << ns_per_sample << " ns/sample, baseline "
+                << double(expected) << "\n";
+      EXPECT_LE(ns_per_sample, double(expected) * (1.0 + threshold)) << test_case.name;
+    }
+  }
+
+  if (update) {
+    ASSERT_TRUE(baseline_file.replaceWithText(juce::JSON::toString(juce::var(timings.release()))))
+        << "can't write " << baseline_file.getFullPathName();
+  }
+}
+}  // namespace audio_plugin_test
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <CX11Synth/PresetBank.h>
+#include <gtest/gtest.h>
+
+#include <vector>
+
+namespace audio_plugin_test {
+// A temporary directory of banks for the preset library tests, deleted again at the end of the
+// test.
+struct LibraryDirectory {
+  const juce::File root = juce::File::getSpecialLocation(juce::File::tempDirectory)
+                              .getNonexistentChildFile("cx11-library-test", "", false);
+
+  LibraryDirectory() { root.createDirectory(); }
+  ~LibraryDirectory() { root.deleteRecursively(); }
+
+  juce::File write(const juce::String& path, const std::vector<Preset>& presets) const {
+    const juce::File file = root.getChildFile(path);
+    file.getParentDirectory().createDirectory();
+    juce::String error;
+    EXPECT_TRUE(PresetBank::write(presets, file, error)) << error;
+    return file;
+  }
+};
+}  // namespace audio_plugin_test
@@ -0,0 +1,61 @@
+#include <CX11Synth/LoadMonitor.h>
+#include <gtest/gtest.h>
+
+namespace audio_plugin_test {
+namespace {
+// A block of `load` times its budget: 480 samples at 48 kHz is 10 ms.
+void fakeBlock(LoadMonitor& monitor, double load, int note_ons = 0, uint32_t flags = 0) {
+  const auto took = std::chrono::duration_cast<LoadMonitor::Clock::duration>(std::chrono::duration<double>(0.01 * load));
+  monitor.endBlock(LoadMonitor::Clock::now() - took, 480, 48000.0, note_ons, flags);
+}
+}  // namespace
+
+TEST(LoadMonitor, CountsBlocksAndDeadlineMisses) {
+  LoadMonitor monitor;
+  fakeBlock(monitor, 0.25);
+  fakeBlock(monitor, 0.55);
+  fakeBlock(monitor, 1.5);
+
+  const LoadMonitor::Stats stats = monitor.getStats();
+  EXPECT_EQ(stats.blocks, 3u);
+  EXPECT_EQ(stats.deadline_misses, 1u);
+  EXPECT_GE(stats.peak_load, 1.5f);
+  EXPECT_GE(stats.worst_block_seconds, 0.015);
+
+  EXPECT_EQ(stats.histogram[2], 1u);
+  EXPECT_EQ(stats.histogram[5], 1u);
+  EXPECT_EQ(stats.histogram[LoadMonitor::NUM_BUCKETS - 1], 1u);
+}
+
+TEST(LoadMonitor, RemembersWhatCameWithASpike) {
+  LoadMonitor monitor;
+  fakeBlock(monitor, 0.1, 3);
+  fakeBlock(monitor, 0.9, 12, LoadMonitor::PROGRAM_CHANGED);
+  fakeBlock(monitor, 1.2, 40, LoadMonitor::PARAMETERS_CHANGED);
+
+  const LoadMonitor::Stats stats = monitor.getStats();
+  ASSERT_EQ(stats.num_spikes, 2);
+
+  EXPECT_EQ(stats.spikes[0].block, 3u);
+  EXPECT_EQ(stats.spikes[0].note_ons, 40);
+  EXPECT_EQ(stats.spikes[0].flags, uint32_t(LoadMonitor::PARAMETERS_CHANGED));
+  EXPECT_GE(stats.spikes[0].load, 1.2f - 0.001f);
+
+  EXPECT_EQ(stats.spikes[1].block, 2u);
+  EXPECT_EQ(stats.spikes[1].note_ons, 12);
+  EXPECT_EQ(stats.spikes[1].flags, uint32_t(LoadMonitor::PROGRAM_CHANGED));
+}
+
+TEST(LoadMonitor, StartsOverAfterAReset) {
+  LoadMonitor monitor;
+  fakeBlock(monitor, 2.0);
+  monitor.reset();
+  fakeBlock(monitor, 0.05);
+
+  const LoadMonitor::Stats stats = monitor.getStats();
+  EXPECT_EQ(stats.blocks, 1u);
+  EXPECT_EQ(stats.deadline_misses, 0u);
+  EXPECT_EQ(stats.num_spikes, 0);
+  EXPECT_LT(stats.peak_load, 1.0f);
+}
+}  // namespace audio_plugin_test
@@ -0,0 +1,128 @@
+#include <CX11Synth/OutputGuard.h>
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace audio_plugin_test {
+namespace {
+// Odd length so the samples past the last whole SIMD register are checked too.
+constexpr int LENGTH = 67;
+
+std::vector<float> quietBlock() {
+  std::vector<float> block(LENGTH);
+  for (int i = 0; i < LENGTH; ++i) {
+    block[size_t(i)] = 0.5f * std::sin(0.3f * float(i));
+  }
+  return block;
+}
+
+bool isSilent(const std::vector<float>& block) {
+  for (float x : block) {
+    if (x != 0.0f) {
+      return false;
+    }
+  }
+  return true;
+}
+}  // namespace
+
+TEST(OutputGuard, LeavesNormalAudioAlone) {
+  for (auto policy : {OutputGuard::MUTE, OutputGuard::CLAMP, OutputGuard::SOFT_CLIP}) {
+    OutputGuard guard;
+    guard.setPolicy(policy);
+    std::vector<float> left = quietBlock();
+    std::vector<float> right = quietBlock();
+    guard.process(left.data(), right.data(), LENGTH);
+
+    EXPECT_TRUE(left == quietBlock());
+    EXPECT_TRUE(right == quietBlock());
+    EXPECT_EQ(guard.getCounts().muted_blocks, 0u);
+    EXPECT_EQ(guard.getCounts().clipped_blocks, 0u);
+  }
+}
+
+TEST(OutputGuard, MutesNaNAndInfinityWhateverThePolicy) {
+  for (auto policy : {OutputGuard::MUTE, OutputGuard::CLAMP, OutputGuard::SOFT_CLIP}) {
+    // Anywhere in the block, in the SIMD part or the tail, on either channel. Only the channel
+    // that went bad is silenced.
+    for (int position : {0, 5, LENGTH - 1}) {
+      for (float bad : {std::numeric_limits<float>::quiet_NaN(), std::numeric_limits<float>::infinity(),
+                        -std::numeric_limits<float>::infinity()}) {
+        for (int channel : {0, 1}) {
+          OutputGuard guard;
+          guard.setPolicy(policy);
+          std::vector<float> blocks[2] = {quietBlock(), quietBlock()};
+          blocks[channel][size_t(position)] = bad;
+          guard.process(blocks[0].data(), blocks[1].data(), LENGTH);
+
+          EXPECT_TRUE(isSilent(blocks[channel]));
+          EXPECT_TRUE(blocks[1 - channel] == quietBlock());
+          EXPECT_EQ(guard.getCounts().muted_blocks, 1u);
+        }
+      }
+    }
+  }
+}
+
+TEST(OutputGuard, MutePolicyClampsUpToTheMuteLevel) {
+  OutputGuard guard;
+  std::vector<float> block = quietBlock();
+  block[3] = 1.5f;
+  block[LENGTH - 2] = -1.2f;
+  guard.process(block.data(), nullptr, LENGTH);
+
+  EXPECT_EQ(block[3], 1.0f);
+  EXPECT_EQ(block[LENGTH - 2], -1.0f);
+  EXPECT_EQ(block[4], quietBlock()[4]);
+  EXPECT_EQ(guard.getCounts().clipped_blocks, 1u);
+
+  block[10] = 2.5f;
+  guard.process(block.data(), nullptr, LENGTH);
+  EXPECT_TRUE(isSilent(block));
+  EXPECT_EQ(guard.getCounts().muted_blocks, 1u);
+}
+
+TEST(OutputGuard, ClampPolicyNeverMutesForLevel) {
+  OutputGuard guard;
+  guard.setPolicy(OutputGuard::CLAMP);
+  std::vector<float> block = quietBlock();
+  block[10] = 30.0f;
+  block[11] = -30.0f;
+  guard.process(block.data(), nullptr, LENGTH);
+
+  EXPECT_EQ(block[10], 1.0f);
+  EXPECT_EQ(block[11], -1.0f);
+  EXPECT_EQ(block[12], quietBlock()[12]);
+  EXPECT_EQ(guard.getCounts().muted_blocks, 0u);
+  EXPECT_EQ(guard.getCounts().clipped_blocks, 1u);
+}
+
+TEST(OutputGuard, SoftClipIsSmoothAndStaysUnderFullScale) {
+  EXPECT_EQ(OutputGuard::softClip(0.5f), 0.5f);
+  EXPECT_EQ(OutputGuard::softClip(-OutputGuard::KNEE), -OutputGuard::KNEE);
+
+  float previous = OutputGuard::softClip(0.0f);
+  for (float x = 0.001f; x < 100.0f; x *= 1.01f) {
+    const float y = OutputGuard::softClip(x);
+    EXPECT_GE(y, previous);
+    EXPECT_LT(y, 1.0f);
+    EXPECT_EQ(OutputGuard::softClip(-x), -y);
+    previous = y;
+  }
+
+  // No kink at the knee.
+  const float step = 1e-3f;
+  const float slope = (OutputGuard::softClip(OutputGuard::KNEE + step) - OutputGuard::KNEE) / step;
+  EXPECT_NEAR(slope, 1.0f, 0.01f);
+
+  OutputGuard guard;
+  guard.setPolicy(OutputGuard::SOFT_CLIP);
+  std::vector<float> block = quietBlock();
+  block[7] = 1.5f;
+  guard.process(block.data(), nullptr, LENGTH);
+  EXPECT_EQ(block[7], OutputGuard::softClip(1.5f));
+  EXPECT_EQ(guard.getCounts().clipped_blocks, 1u);
+}
+}  // namespace audio_plugin_test
@@ -0,0 +1,81 @@
+#include <CX11Synth/ParameterRamp.h>
+#include <gtest/gtest.h>
+
+#include <vector>
+
+namespace audio_plugin_test {
+TEST(ParameterRamp, ReachesTheTargetExactly) {
+  for (auto shape : {ParameterRamp::LINEAR, ParameterRamp::EXPONENTIAL}) {
+    ParameterRamp ramp;
+    ramp.prepare(shape, 100);
+    ramp.jump(0.3f);
+    ramp.setTarget(7.1f);
+
+    float previous = ramp.getValue();
+    for (int i = 0; i < 100; ++i) {
+      ASSERT_TRUE(ramp.isMoving());
+      const float value = ramp.next();
+      EXPECT_GT(value, previous);
+      previous = value;
+    }
+
+    EXPECT_FALSE(ramp.isMoving());
+    EXPECT_EQ(ramp.getValue(), 7.1f);
+  }
+}
+
+TEST(ParameterRamp, FillMatchesNext) {
+  for (auto shape : {ParameterRamp::LINEAR, ParameterRamp::EXPONENTIAL}) {
+    ParameterRamp stepped;
+    ParameterRamp filled;
+    for (ParameterRamp* ramp : {&stepped, &filled}) {
+      ramp->prepare(shape, 50);
+      ramp->jump(2.0f);
+      ramp->setTarget(0.3f);
+      ramp->next();
+    }
+
+    // Runs past the end of the ramp, the rest has to be the target.
+    std::vector<float> values(80);
+    filled.fill(values.data(), 80);
+    for (int i = 0; i < 80; ++i) {
+      EXPECT_EQ(values[i], stepped.next()) << "step " << i;
+    }
+  }
+}
+
+TEST(ParameterRamp, NewTargetStartsFromWhereTheRampIs) {
+  ParameterRamp ramp;
+  ramp.prepare(ParameterRamp::LINEAR, 10);
+  ramp.jump(0.0f);
+  ramp.setTarget(1.0f);
+  ramp.skip(5);
+  EXPECT_FLOAT_EQ(ramp.getValue(), 0.5f);
+
+  ramp.setTarget(0.0f);
+  EXPECT_FLOAT_EQ(ramp.next(), 0.45f);
+}
+
+TEST(ParameterRamp, ExponentialFallsBackToLinearThroughZero) {
+  ParameterRamp ramp;
+  ramp.prepare(ParameterRamp::EXPONENTIAL, 4);
+  ramp.jump(0.0f);
+  ramp.setTarget(1.0f);
+  EXPECT_FLOAT_EQ(ramp.next(), 0.25f);
+  EXPECT_FLOAT_EQ(ramp.next(), 0.5f);
+}
+
+TEST(ParameterRamp, StaysPutWithoutANewTarget) {
+  ParameterRamp ramp;
+  ramp.prepare(ParameterRamp::EXPONENTIAL, 10);
+  ramp.jump(3.0f);
+  ramp.setTarget(3.0f);
+  EXPECT_FALSE(ramp.isMoving());
+
+  std::vector<float> values(16);
+  ramp.fill(values.data(), 16);
+  for (float value : values) {
+    EXPECT_EQ(value, 3.0f);
+  }
+}
+}  // namespace audio_plugin_test
@@ -0,0 +1,157 @@
+#include <CX11Synth/PresetBank.h>
+#include <gtest/gtest.h>
+
+namespace audio_plugin_test {
+namespace {
+  std::vector<Preset> testPresets() {
+    std::vector<Preset> presets;
+    presets.emplace_back("First", 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f, 8.0f, 9.0f, 10.0f, 11.0f, 12.0f, 13.0f, 14.0f,
+                         15.0f, 16.0f, 17.0f, 18.0f, 19.0f, 0.81f, 21.0f, 22.0f, 23.0f, 24.0f, 25.0f, 1.0f, 1.0f);
+    presets.emplace_back("Second, with a name that's longer than fits", -1.0f, -12.0f, -6.3f, 0.0f, 0.0f, 0.0f, 0.0f,
+                         0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f,
+                         0.0f, 0.0f, 0.0f);
+    return presets;
+  }
+
+  void expectSame(const Preset& actual, const Preset& expected) {
+    EXPECT_STREQ(actual.name, expected.name);
+    for (int i = 0; i < NUM_PARAMS; ++i) {
+      EXPECT_EQ(actual.param[i], expected.param[i]) << "parameter " << i;
+    }
+  }
+}
+
+TEST(PresetBank, FactoryBankHasTheBuiltInPresets) {
+  const auto bank = PresetBank::factory();
+
+  ASSERT_EQ(bank->size(), 53);
+  EXPECT_EQ(bank->name(0), "Init");
+  EXPECT_EQ(bank->name(52), "Squelchy Frog");
+  EXPECT_EQ(bank->preset(0).param[1], -12.0f);
+  EXPECT_EQ(bank->file(), juce::File());
+
+  // Made once and shared.
+  EXPECT_EQ(PresetBank::factory().get(), bank.get());
+}
+
+TEST(PresetBank, LongNamesAreCut) {
+  const auto bank = PresetBank::fromPresets(testPresets());
+
+  EXPECT_EQ(bank->name(1).length(), PresetBank::NAME_LENGTH - 1);
+  EXPECT_TRUE(bank->name(1).startsWith("Second, with a name"));
+}
+
+TEST(PresetBank, WrittenBankOpensWithTheSamePresets) {
+  const juce::TemporaryFile file(".cx11bank");
+  const std::vector<Preset> presets = testPresets();
+  juce::String error;
+
+  ASSERT_TRUE(PresetBank::write(presets, file.getFile(), error)) << error;
+
+  const auto bank = PresetBank::open(file.getFile(), error);
+  ASSERT_NE(bank, nullptr) << error;
+  ASSERT_EQ(bank->size(), 2);
+  EXPECT_EQ(bank->file(), file.getFile());
+
+  const auto in_memory = PresetBank::fromPresets(presets);
+  for (int i = 0; i < bank->size(); ++i) {
+    expectSame(bank->preset(i), in_memory->preset(i));
+  }
+
+  // A second open shares the first one's map.
+  EXPECT_EQ(PresetBank::open(file.getFile(), error).get(), bank.get());
+}
+
+TEST(PresetBank, RejectsFilesThatArentBanks) {
+  const juce::TemporaryFile file(".cx11bank");
+  juce::String error;
+
+  ASSERT_TRUE(file.getFile().replaceWithText("Init 0 -12 0 0 35"));
+  EXPECT_EQ(PresetBank::open(file.getFile(), error), nullptr);
+  EXPECT_TRUE(error.contains("not a preset bank"));
+
+  // Cut short: the header promises two presets the file hasn't got.
+  juce::MemoryBlock bytes;
+  ASSERT_TRUE(PresetBank::write(testPresets(), file.getFile(), error));
+  ASSERT_TRUE(file.getFile().loadFileAsData(bytes));
+  bytes.setSize(bytes.getSize() - 8);
+  ASSERT_TRUE(file.getFile().replaceWithData(bytes.getData(), bytes.getSize()));
+
+  error.clear();
+  EXPECT_EQ(PresetBank::open(file.getFile(), error), nullptr);
+  EXPECT_TRUE(error.contains("cut short"));
+}
+
+TEST(PresetBank, OlderBanksLoadWithTheMissingParametersAtZero) {
+  // A bank from before Osc Engine was added: 26 parameters per preset.
+  const juce::TemporaryFile file(".cx11bank");
+  {
+    juce::FileOutputStream stream(file.getFile());
+    ASSERT_TRUE(stream.openedOk());
+    stream.write("CX11BANK", 8);
+    for (int value : { 1, 1, 26, 32, 72, 0 }) {
+      stream.writeInt(value);
+    }
+    char name[PresetBank::NAME_LENGTH] = "Old";
+    stream.write(name, sizeof(name));
+    for (int i = 0; i < 26; ++i) {
+      stream.writeFloat(float(i + 1));
+    }
+  }
+
+  juce::String error;
+  const auto bank = PresetBank::open(file.getFile(), error);
+  ASSERT_NE(bank, nullptr) << error;
+
+  const Preset preset = bank->preset(0);
+  EXPECT_STREQ(preset.name, "Old");
+  EXPECT_EQ(preset.param[25], 26.0f);
+  EXPECT_EQ(preset.param[26], 0.0f);
+}
+
+TEST(PresetBank, TextRoundTrip) {
+  const juce::TemporaryFile file(".txt");
+  const auto bank = PresetBank::factory();
+  juce::String error;
+
+  ASSERT_TRUE(PresetBank::writeText(bank->presets(), file.getFile(), error)) << error;
+  EXPECT_TRUE(file.getFile().loadFileAsString().startsWith("name\tosc_mix\tosc_tune\t"));
+
+  std::vector<Preset> presets;
+  ASSERT_TRUE(PresetBank::readText(file.getFile(), presets, error)) << error;
+  ASSERT_EQ(int(presets.size()), bank->size());
+  for (int i = 0; i < bank->size(); ++i) {
+    expectSame(presets[size_t(i)], bank->preset(i));
+  }
+}
+
+TEST(PresetBank, TextColumnsGoByTheHeader) {
+  // Reordered, osc_tune deleted and a column this version doesn't know.
+  const juce::TemporaryFile file(".txt");
+  ASSERT_TRUE(file.getFile().replaceWithText("name\tosc_engine\tfuture_knob\tosc_mix\n"
+                                             "Moved\t1\t42\t0.25\n"));
+
+  std::vector<Preset> presets;
+  juce::String error;
+  ASSERT_TRUE(PresetBank::readText(file.getFile(), presets, error)) << error;
+  ASSERT_EQ(presets.size(), 1u);
+  EXPECT_STREQ(presets[0].name, "Moved");
+  EXPECT_EQ(presets[0].param[Preset::OSC_ENGINE], 1.0f);
+  EXPECT_EQ(presets[0].param[Preset::OSC_MIX], 0.25f);
+  EXPECT_EQ(presets[0].param[Preset::OSC_TUNE], 0.0f);
+}
+
+TEST(PresetBank, TextWithACellThatIsntANumberIsAnError) {
+  for (const char* cell : { "", "abc", "1,5", "2x" }) {
+    const juce::TemporaryFile file(".txt");
+    ASSERT_TRUE(file.getFile().replaceWithText(juce::String("name\tosc_mix\tosc_tune\n")
+                                               + "Fine\t1\t2\n"
+                                               + "Broken\t1\t" + cell + "\n"));
+
+    std::vector<Preset> presets;
+    juce::String error;
+    EXPECT_FALSE(PresetBank::readText(file.getFile(), presets, error)) << cell;
+    EXPECT_TRUE(error.contains(file.getFile().getFileName() + ":3:")) << error;
+  }
+}
+}  // namespace audio_plugin_test
@@ -0,0 +1,110 @@
+#include <CX11Synth/PresetLibrary.h>
+#include <gtest/gtest.h>
+
+#include "LibraryDirectory.h"
+
+namespace audio_plugin_test {
+namespace {
+  Preset preset(const char* name, float osc_mix, float octave) {
+    Preset preset;
+    preset.setName(name);
+    preset.param[0] = osc_mix;
+    preset.param[22] = octave;
+    return preset;
+  }
+}
+
+TEST(PresetLibrary, ScansBanksBelowTheDirectories) {
+  const LibraryDirectory directory;
+  directory.write("Bass/Analog.cx11bank", { preset("Squelch Bass", 100.0f, -1.0f), preset("Sub [ZF]", 0.0f, -2.0f) });
+  directory.write("Leads.cx11bank", { preset("Square Lead", 50.0f, 1.0f) });
+
+  PresetLibrary library(directory.root.getChildFile("library.index"));
+  library.setDirectories({ directory.root });
+  ASSERT_TRUE(library.waitForScan(5000));
+
+  const auto snapshot = library.snapshot();
+  ASSERT_EQ(snapshot->size(), 3);
+
+  // Sorted by name.
+  EXPECT_EQ((*snapshot)[0].name, "Square Lead");
+  EXPECT_EQ((*snapshot)[1].name, "Squelch Bass");
+  EXPECT_EQ((*snapshot)[2].name, "Sub [ZF]");
+
+  EXPECT_TRUE(snapshot->findPrefix("squ") == std::vector<int>({ 0, 1 }));
+  EXPECT_TRUE(snapshot->findPrefix("SQUE") == std::vector<int>({ 1 }));
+  EXPECT_TRUE(snapshot->findPrefix("pad").empty());
+
+  EXPECT_TRUE(snapshot->findTag("bass") == std::vector<int>({ 1, 2 }));
+  EXPECT_TRUE(snapshot->findTag("Analog") == std::vector<int>({ 1, 2 }));
+  EXPECT_TRUE(snapshot->findTag("ZF") == std::vector<int>({ 2 }));
+
+  // Octave counts as much as the oscillator mix although its range is much smaller.
+  const float query[NUM_PARAMS] = { 90.0f, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1.0f };
+  EXPECT_TRUE(snapshot->findSimilar(query, 2) == std::vector<int>({ 0, 1 }));
+
+  Preset loaded;
+  juce::String error;
+  ASSERT_TRUE(snapshot->load(2, loaded, error)) << error;
+  EXPECT_STREQ(loaded.name, "Sub [ZF]");
+  EXPECT_EQ(loaded.param[22], -2.0f);
+}
+
+TEST(PresetLibrary, RescanPicksUpChanges) {
+  const LibraryDirectory directory;
+  directory.write("One.cx11bank", { preset("First", 0.0f, 0.0f) });
+  const juce::File two = directory.write("Two.cx11bank", { preset("Second", 0.0f, 0.0f) });
+
+  PresetLibrary library(directory.root.getChildFile("library.index"));
+  library.setDirectories({ directory.root });
+  ASSERT_TRUE(library.waitForScan(5000));
+  ASSERT_EQ(library.snapshot()->size(), 2);
+
+  ASSERT_TRUE(two.deleteFile());
+  directory.write("Three.cx11bank", { preset("Third", 0.0f, 0.0f), preset("Fourth", 0.0f, 0.0f) });
+  library.rescan();
+  ASSERT_TRUE(library.waitForScan(5000));
+
+  auto snapshot = library.snapshot();
+  ASSERT_EQ(snapshot->size(), 3);
+  EXPECT_TRUE(snapshot->findPrefix("Second").empty());
+  EXPECT_EQ(snapshot->findPrefix("Fourth").size(), 1u);
+
+  // A bank rewritten in place. The library goes by size and modification time, and the time
+  // may not have moved on a coarse file system, so the new bank holds a different number of
+  // presets.
+  directory.write("One.cx11bank", { preset("Fifth", 0.0f, 0.0f), preset("Sixth", 0.0f, 0.0f) });
+  library.rescan();
+  ASSERT_TRUE(library.waitForScan(5000));
+
+  snapshot = library.snapshot();
+  ASSERT_EQ(snapshot->size(), 4);
+  EXPECT_TRUE(snapshot->findPrefix("First").empty());
+  EXPECT_EQ(snapshot->findPrefix("Fifth").size(), 1u);
+  EXPECT_EQ(snapshot->findPrefix("Sixth").size(), 1u);
+}
+
+TEST(PresetLibrary, StartsFromTheIndexOfTheLastRun) {
+  const LibraryDirectory directory;
+  directory.write("Bank.cx11bank", { preset("Kept", 0.0f, 0.0f) });
+  const juce::File index = directory.root.getChildFile("library.index");
+
+  {
+    PresetLibrary library(index);
+    library.setDirectories({ directory.root });
+    ASSERT_TRUE(library.waitForScan(5000));
+  }
+  ASSERT_TRUE(index.existsAsFile());
+
+  // No directories and no scan, everything comes from the index.
+  PresetLibrary library(index);
+  for (int i = 0; i < 500 && library.snapshot()->size() == 0; ++i) {
+    juce::Thread::sleep(10);
+  }
+
+  const auto snapshot = library.snapshot();
+  ASSERT_EQ(snapshot->size(), 1);
+  EXPECT_EQ((*snapshot)[0].name, "Kept");
+  EXPECT_TRUE((*snapshot)[0].tags.contains("Bank"));
+}
+}  // namespace audio_plugin_test
@@ -0,0 +1,109 @@
+#include <CX11Synth/PresetMorph.h>
+#include <gtest/gtest.h>
+
+#include <cmath>
+
+namespace audio_plugin_test {
+namespace {
+  constexpr float sampleRate = 48000.0f;
+
+  // Far apart on everything that's blended: short and long envelopes, no resonance and a lot,
+  // mono and poly, an octave down and one up.
+  const Preset first("First", 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 10.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 10.0f, 0.0f,
+                     10.0f, 0.0f, 20.0f, 100.0f, 30.0f, 0.3f, 0.0f, 0.0f, -1.0f, 0.0f, 0.0f, 1.0f, 0.0f);
+  const Preset second("Second", 100.0f, 12.0f, 0.0f, 2.0f, 50.0f, 0.0f, 90.0f, 100.0f, 50.0f, 0.0f, 0.0f, 0.0f, 60.0f,
+                      50.0f, 60.0f, 80.0f, 80.0f, 50.0f, 40.0f, 0.8f, 40.0f, 50.0f, 1.0f, 0.0f, -6.0f, 0.0f, 1.0f);
+  const Preset third("Third", 50.0f, -12.0f, 0.0f, 0.0f, 0.0f, 0.0f, 50.0f, 50.0f, 0.0f, 0.0f, 0.0f, 0.0f, 30.0f,
+                     30.0f, 30.0f, 10.0f, 50.0f, 70.0f, 20.0f, 0.5f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f);
+
+  SynthParameters derived(const Preset& preset) {
+    SynthParameters params;
+    params.update(preset.param, 0xFFFFFFFF, sampleRate);
+    return params;
+  }
+
+  void expectSame(const SynthParameters& actual, const SynthParameters& expected) {
+    EXPECT_EQ(actual.env_attack, expected.env_attack);
+    EXPECT_EQ(actual.env_release, expected.env_release);
+    EXPECT_EQ(actual.filter_q, expected.filter_q);
+    EXPECT_EQ(actual.tune, expected.tune);
+    EXPECT_EQ(actual.lfo_inc, expected.lfo_inc);
+    EXPECT_EQ(actual.osc_mix, expected.osc_mix);
+    EXPECT_EQ(actual.poly, expected.poly);
+    EXPECT_EQ(actual.osc_engine, expected.osc_engine);
+  }
+
+  PresetMorph morphOf(std::initializer_list<Preset> presets) {
+    const std::vector<Preset> list(presets);
+    PresetMorph morph;
+    morph.setPresets(list.data(), int(list.size()));
+    morph.prepare(sampleRate);
+    return morph;
+  }
+}
+
+TEST(PresetMorph, EndsAreThePresetsThemselves) {
+  const PresetMorph morph = morphOf({ first, second });
+  ASSERT_EQ(morph.size(), 2);
+
+  SynthParameters params;
+  morph.evaluate(0.0f, params);
+  expectSame(params, derived(first));
+  morph.evaluate(1.0f, params);
+  expectSame(params, derived(second));
+
+  // Clamped to the presets there are.
+  morph.evaluate(-3.0f, params);
+  expectSame(params, derived(first));
+  morph.evaluate(7.5f, params);
+  expectSame(params, derived(second));
+}
+
+TEST(PresetMorph, BlendsEachSettingInItsOwnDomain) {
+  const PresetMorph morph = morphOf({ first, second });
+  const SynthParameters a = derived(first);
+  const SynthParameters b = derived(second);
+
+  SynthParameters half;
+  morph.evaluate(0.5f, half);
+
+  // Ratios halfway in log, which is the geometric mean.
+  EXPECT_NEAR(half.filter_q, std::sqrt(a.filter_q * b.filter_q), 1e-4f);
+  EXPECT_NEAR(half.tune, std::sqrt(a.tune * b.tune), 1e-2f);
+  EXPECT_NEAR(half.lfo_inc, std::sqrt(a.lfo_inc * b.lfo_inc), 1e-7f);
+
+  // Envelopes halfway in the log of their time.
+  const float rate = std::sqrt(std::log(a.env_attack) * std::log(b.env_attack));
+  EXPECT_NEAR(std::log(half.env_attack), -rate, rate * 1e-3f);
+
+  // The rest straight.
+  EXPECT_FLOAT_EQ(half.env_sustain, 0.5f * (a.env_sustain + b.env_sustain));
+  EXPECT_FLOAT_EQ(half.osc_mix, 0.5f * (a.osc_mix + b.osc_mix));
+
+  // Switches flip halfway.
+  SynthParameters params;
+  morph.evaluate(0.49f, params);
+  EXPECT_TRUE(params.poly);
+  EXPECT_EQ(params.osc_engine, 0);
+  morph.evaluate(0.51f, params);
+  EXPECT_FALSE(params.poly);
+  EXPECT_EQ(params.osc_engine, 1);
+}
+
+TEST(PresetMorph, BlendsTheTwoPresetsAroundThePosition) {
+  const PresetMorph morph = morphOf({ first, second, third });
+  const SynthParameters b = derived(second);
+  const SynthParameters c = derived(third);
+
+  SynthParameters params;
+  morph.evaluate(1.0f, params);
+  expectSame(params, b);
+
+  morph.evaluate(1.5f, params);
+  EXPECT_NEAR(params.filter_q, std::sqrt(b.filter_q * c.filter_q), 1e-4f);
+  EXPECT_FLOAT_EQ(params.env_sustain, 0.5f * (b.env_sustain + c.env_sustain));
+
+  morph.evaluate(2.0f, params);
+  expectSame(params, c);
+}
+}  // namespace audio_plugin_test
@@ -0,0 +1,77 @@
+#include <CX11Synth/Profiler.h>
+#include <gtest/gtest.h>
+#include <juce_core/juce_core.h>
+
+#include <memory>
+#include <sstream>
+#include <vector>
+
+namespace audio_plugin_test {
+TEST(Profiler, DrainsZonesInTheOrderTheyWerePushed) {
+  auto log = std::make_unique<Profiler::ThreadLog>(1);
+  log->push({10, 20, Profiler::FILTER});
+  log->push({5, 30, Profiler::RENDER});
+
+  std::vector<Profiler::Event> events;
+  log->drain([&events](const Profiler::Event& event) { events.push_back(event); });
+
+  ASSERT_EQ(events.size(), 2u);
+  EXPECT_EQ(events[0].zone, Profiler::FILTER);
+  EXPECT_EQ(events[1].zone, Profiler::RENDER);
+  EXPECT_EQ(events[1].start, 5u);
+  EXPECT_EQ(events[1].end, 30u);
+
+  // Drained zones are gone.
+  int count = 0;
+  log->drain([&count](const Profiler::Event&) { ++count; });
+  EXPECT_EQ(count, 0);
+}
+
+TEST(Profiler, DropsZonesWhenTheLogIsFull) {
+  auto log = std::make_unique<Profiler::ThreadLog>(1);
+  for (uint32_t i = 0; i < Profiler::ThreadLog::CAPACITY + 3; ++i) {
+    log->push({i, i + 1, Profiler::OSCILLATOR});
+  }
+  EXPECT_EQ(log->dropped(), 3u);
+
+  // The oldest zones are kept, and draining makes room again.
+  uint64_t first = 1;
+  uint32_t count = 0;
+  log->drain([&](const Profiler::Event& event) {
+    first = count == 0 ? event.start : first;
+    ++count;
+  });
+  EXPECT_EQ(first, 0u);
+  EXPECT_EQ(count, Profiler::ThreadLog::CAPACITY);
+
+  log->push({0, 1, Profiler::MIDI});
+  EXPECT_EQ(log->dropped(), 3u);
+}
+
+TEST(Profiler, WritesAChromeTrace) {
+  {
+    CX11_PROFILE_ZONE(RENDER);
+  }
+
+  std::ostringstream stream;
+  Profiler::writeChromeTrace(stream);
+
+  const juce::var trace = juce::JSON::parse(juce::String(stream.str()));
+  ASSERT_TRUE(trace.isObject());
+  const juce::var* events = trace.getDynamicObject()->getProperties().getVarPointer("traceEvents");
+  ASSERT_NE(events, nullptr);
+  ASSERT_TRUE(events->isArray());
+
+  int render_zones = 0;
+  for (const juce::var& event : *events->getArray()) {
+    EXPECT_EQ(event["ph"].toString(), "X");
+    render_zones += event["name"].toString() == "render" ? 1 : 0;
+  }
+
+  if (Profiler::ENABLED) {
+    EXPECT_GE(render_zones, 1);
+  } else {
+    EXPECT_EQ(events->size(), 0);
+  }
+}
+}  // namespace audio_plugin_test
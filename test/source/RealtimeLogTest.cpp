@@ -0,0 +1,101 @@
+#include <CX11Synth/RealtimeLog.h>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace audio_plugin_test {
+namespace {
+std::vector<std::string> drainAll(RealtimeLog& log) {
+  std::vector<std::string> messages;
+  log.drain([&messages](const char* text) { messages.emplace_back(text); });
+  return messages;
+}
+}  // namespace
+
+TEST(RealtimeLog, FormatsMessagesIntoRecords) {
+  auto log = std::make_unique<RealtimeLog>();
+  EXPECT_TRUE(log->post("Learned a MIDI cc: '%d'", 74));
+  EXPECT_TRUE(log->post("CC7 volume %.3f", 0.5));
+
+  const auto messages = drainAll(*log);
+  ASSERT_EQ(messages.size(), 2u);
+  EXPECT_EQ(messages[0], "Learned a MIDI cc: '74'");
+  EXPECT_EQ(messages[1], "CC7 volume 0.500");
+  EXPECT_TRUE(drainAll(*log).empty());
+}
+
+TEST(RealtimeLog, CutsLongMessages) {
+  auto log = std::make_unique<RealtimeLog>();
+  const std::string long_message(RealtimeLog::MAX_LENGTH * 2, 'x');
+  log->post("%s", long_message.c_str());
+
+  const auto messages = drainAll(*log);
+  ASSERT_EQ(messages.size(), 1u);
+  EXPECT_EQ(messages[0].size(), size_t(RealtimeLog::MAX_LENGTH - 1));
+}
+
+TEST(RealtimeLog, DropsMessagesWhenFull) {
+  auto log = std::make_unique<RealtimeLog>();
+  for (int i = 0; i < RealtimeLog::CAPACITY + 5; ++i) {
+    log->post("%d", i);
+  }
+  EXPECT_EQ(log->dropped(), 5u);
+
+  auto messages = drainAll(*log);
+  ASSERT_EQ(messages.size(), size_t(RealtimeLog::CAPACITY));
+  EXPECT_EQ(messages.front(), "0");
+
+  // Room again once it's drained, and the ring wraps around.
+  EXPECT_TRUE(log->post("after"));
+  messages = drainAll(*log);
+  ASSERT_EQ(messages.size(), 1u);
+  EXPECT_EQ(messages[0], "after");
+}
+
+TEST(RealtimeLog, TakesMessagesFromSeveralThreads) {
+  auto log = std::make_unique<RealtimeLog>();
+  constexpr int THREADS = 4;
+  constexpr int MESSAGES = 1000;
+
+  std::vector<std::string> messages;
+  std::atomic<int> finished{0};
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < THREADS; ++t) {
+    threads.emplace_back([&log, &finished, t] {
+      for (int i = 0; i < MESSAGES; ++i) {
+        while (!log->post("%d %d", t, i)) {
+          std::this_thread::yield();
+        }
+      }
+      ++finished;
+    });
+  }
+
+  const auto collect = [&messages](const char* text) { messages.emplace_back(text); };
+  for (;;) {
+    const bool done = finished == THREADS;
+    if (log->drain(collect) == 0 && done) {
+      break;
+    }
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  ASSERT_EQ(messages.size(), size_t(THREADS * MESSAGES));
+
+  // Each thread's messages come out in the order it posted them.
+  std::vector<int> next(THREADS, 0);
+  for (const std::string& message : messages) {
+    int t = 0, i = 0;
+    ASSERT_EQ(std::sscanf(message.c_str(), "%d %d", &t, &i), 2);
+    EXPECT_EQ(i, next[size_t(t)]++);
+  }
+}
+}  // namespace audio_plugin_test
@@ -0,0 +1,59 @@
+#include <CX11Synth/TripleBuffer.h>
+#include <gtest/gtest.h>
+
+#include <thread>
+
+namespace audio_plugin_test {
+TEST(TripleBuffer, NothingToReadUntilPublished) {
+  TripleBuffer<int> buffer;
+  EXPECT_EQ(buffer.read(), nullptr);
+
+  buffer.publish(1);
+  const int* value = buffer.read();
+  ASSERT_NE(value, nullptr);
+  EXPECT_EQ(*value, 1);
+
+  EXPECT_EQ(buffer.read(), nullptr);
+}
+
+TEST(TripleBuffer, ReaderGetsTheNewestValue) {
+  TripleBuffer<int> buffer;
+  buffer.publish(1);
+  buffer.publish(2);
+  buffer.publish(3);
+
+  const int* value = buffer.read();
+  ASSERT_NE(value, nullptr);
+  EXPECT_EQ(*value, 3);
+}
+
+TEST(TripleBuffer, ReaderNeverSeesAHalfWrittenValue) {
+  struct Snapshot {
+    int a = 0;
+    int b = 0;
+  };
+
+  constexpr int COUNT = 100000;
+  TripleBuffer<Snapshot> buffer;
+
+  std::thread writer([&buffer] {
+    for (int i = 1; i <= COUNT; ++i) {
+      Snapshot& slot = buffer.writeSlot();
+      slot.a = i;
+      slot.b = -i;
+      buffer.publish();
+    }
+  });
+
+  int last = 0;
+  while (last < COUNT) {
+    if (const Snapshot* snapshot = buffer.read()) {
+      ASSERT_EQ(snapshot->a, -snapshot->b);
+      ASSERT_GT(snapshot->a, last);
+      last = snapshot->a;
+    }
+  }
+
+  writer.join();
+}
+}  // namespace audio_plugin_test